@@ -0,0 +1,67 @@
+/*
+ *  AllocationCounter.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long> allocations(0);
+
+/* not inlined, otherwise gcc pairs the free with the operator new */
+/* of the caller and warns about a mismatched new and delete.      */
+__attribute__((noinline)) static void release(void *p) {
+    free(p);
+}
+
+void *operator new(size_t sz) {
+    allocations++;
+    void *p = malloc(sz ? sz : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void *operator new[](size_t sz) {
+    return operator new(sz);
+}
+
+void operator delete(void *p) noexcept {
+    release(p);
+}
+
+void operator delete[](void *p) noexcept {
+    release(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    release(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    release(p);
+}
+
+unsigned long get_allocations() {
+    return allocations;
+}
@@ -0,0 +1,29 @@
+/*
+ *  AllocationCounter.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ALLOCATIONCOUNTER_HPP_
+#define _ALLOCATIONCOUNTER_HPP_
+
+/* the benchmarks replace the global operator new and delete with */
+/* the ones in AllocationCounter.cpp, which count every allocation */
+/* of the process.                                                 */
+unsigned long get_allocations();
+
+#endif // _ALLOCATIONCOUNTER_HPP_
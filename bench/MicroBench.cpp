@@ -0,0 +1,425 @@
+/*
+ *  MicroBench.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* microbenchmarks for the hot primitives of libcircada and the text
+ * helpers of the frontend. every benchmark reports the time per
+ * operation and the heap allocations per operation (allocs/op).
+ * usage: micro_bench [google benchmark options]
+ *        micro_bench --benchmark_filter=Parse
+ */
+
+#include "AllocationCounter.hpp"
+#include "UTF8.hpp"
+#include "Utils.hpp"
+
+#include <Circada/Circada.hpp>
+#include <Circada/Flags.hpp>
+#include <Circada/Highlighter.hpp>
+#include <Circada/LineFetcher.hpp>
+#include <Circada/Message.hpp>
+#include <Circada/Recoder.hpp>
+#include <Circada/TokenBucket.hpp>
+#include <Circada/Window.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace Circada;
+
+/* counts the allocations between construction and report() */
+class AllocCounter {
+public:
+    AllocCounter() : start(get_allocations()) { }
+
+    void report(benchmark::State& state) {
+        state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(get_allocations() - start),
+            benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    unsigned long start;
+};
+
+/**************************************************************************
+ * corpora
+ **************************************************************************/
+static const char *server_lines[] = {
+    ":alice!~alice@host-12-34.example.net PRIVMSG #circada :hi all, anyone here who knows how to set up a bouncer?",
+    ":bob!bob@2001:db8::42 PRIVMSG #circada :I think the problem is in the config, try /set dcc_timeout 60 and reconnect.",
+    ":Mallory!~m@unaffiliated/mallory PRIVMSG #circada :lol",
+    ":trent!trent@trent.users.example.org NOTICE #circada :Ünïcödé tëxt wïth ümläüts ånd ∑ymbols → ok",
+    ":peggy_!~peggy@10.0.0.7 JOIN :#circada",
+    ":carol!~carol@host.example.com QUIT :hub.example.net leaf.example.net",
+    ":dave!dave@example.com PART #circada :bye",
+    ":irc.example.net 353 bench = #circada :@alice +bob Mallory trent peggy_ carol dave erin frank",
+    ":ChanServ!ChanServ@services. MODE #circada +ov alice bob",
+    ":alice!~alice@host-12-34.example.net PRIVMSG bench :\001VERSION\001",
+    ":irc.example.net 005 bench CHANTYPES=# PREFIX=(ov)@+ NETWORK=Example :are supported by this server",
+    "PING :irc.example.net",
+    0
+};
+
+static const char *chat_texts[] = {
+    "hi all, anyone here who knows how to set up a bouncer?",
+    "bench: did you see the new release?",
+    "I think the problem is in the config, try /set dcc_timeout 60 and reconnect.",
+    "here's a longer line that will wrap on narrow terminals because it just keeps going and going with words",
+    "ok bench, thanks",
+    0
+};
+
+static const char *quit_messages[] = {
+    "*.net *.split",
+    "hub.example.net leaf.example.net",
+    "Quit: leaving",
+    "Ping timeout: 240 seconds",
+    "Remote host closed the connection",
+    0
+};
+
+static const char *utf8_text = "Ünïcödé tëxt wïth ümläüts ånd ∑ymbols → ok, 日本語のテキスト, plain ascii as well";
+
+static std::vector<std::string> make_corpus(const char **lines) {
+    std::vector<std::string> corpus;
+    while (*lines) {
+        corpus.push_back(*lines++);
+    }
+
+    return corpus;
+}
+
+static std::string make_nick(int i) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "user%05d", (i * 7919) % 100000);
+    return buffer;
+}
+
+class BenchNickPrefix : public ServerNickPrefix {
+public:
+    BenchNickPrefix() : chars("ov"), symbols("@+") { }
+
+    virtual const std::string& get_nick_chars() const { return chars; }
+    virtual const std::string& get_nick_symbols() const { return symbols; }
+
+private:
+    std::string chars;
+    std::string symbols;
+};
+
+/**************************************************************************
+ * libcircada
+ **************************************************************************/
+static void BM_MessageParse(benchmark::State& state) {
+    std::vector<std::string> corpus = make_corpus(server_lines);
+    size_t sz = corpus.size();
+    size_t i = 0;
+    Message m;
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        m.parse(0, corpus[i], 0);
+        benchmark::DoNotOptimize(m.command);
+        if (++i == sz) i = 0;
+    }
+    ac.report(state);
+}
+BENCHMARK(BM_MessageParse);
+
+static void BM_MessageParseRecoded(benchmark::State& state) {
+    std::vector<std::string> corpus = make_corpus(server_lines);
+    Encodings encodings;
+    encodings.push_back("UTF-8");
+    Recoder recoder(encodings);
+    size_t sz = corpus.size();
+    size_t i = 0;
+    Message m;
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        m.parse(0, corpus[i], &recoder);
+        benchmark::DoNotOptimize(m.command);
+        if (++i == sz) i = 0;
+    }
+    ac.report(state);
+}
+BENCHMARK(BM_MessageParseRecoded);
+
+/* a block of server lines is written into a socket pair and fetched
+ * until all lines arrived, the argument is the number of lines. */
+static void BM_LineFetcherFetch(benchmark::State& state) {
+    std::vector<std::string> corpus = make_corpus(server_lines);
+    std::string block;
+    for (int i = 0; i < state.range(0); i++) {
+        block += corpus[i % corpus.size()] + "\r\n";
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+    Socket socket;
+    socket.attach(fds[0]);
+    LineFetcher fetcher;
+    LineFetcher::Lines lines;
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        if (write(fds[1], block.data(), block.length()) != static_cast<ssize_t>(block.length())) {
+            state.SkipWithError("write failed");
+            break;
+        }
+        size_t got = 0;
+        while (got < static_cast<size_t>(state.range(0))) {
+            got += fetcher.fetch(socket, lines);
+        }
+        lines.clear();
+    }
+    ac.report(state);
+    state.SetBytesProcessed(state.iterations() * block.length());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    close(fds[1]);
+}
+BENCHMARK(BM_LineFetcherFetch)->Arg(1)->Arg(64);
+
+/* the first encoding fails on latin1 input, the second one matches */
+static void BM_RecoderRecode(benchmark::State& state) {
+    Encodings encodings;
+    encodings.push_back("UTF-8");
+    encodings.push_back("ISO-8859-1");
+    Recoder recoder(encodings);
+    std::string source = state.range(0) ? "gr\xfc\xdf""e aus M\xfcnchen, sch\xf6ne Gr\xfc\xdf""e" : utf8_text;
+    std::string text;
+    text.reserve(1024);
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        text.assign(source);
+        recoder.recode(text);
+        benchmark::DoNotOptimize(text.data());
+    }
+    ac.report(state);
+}
+BENCHMARK(BM_RecoderRecode)->ArgName("latin1")->Arg(0)->Arg(1);
+
+/* the nick plus n extra highlight words, one pass per line */
+static void BM_HighlighterMatch(benchmark::State& state) {
+    std::vector<std::string> corpus = make_corpus(chat_texts);
+    std::string words;
+    char buffer[32];
+    for (int i = 0; i < state.range(0); i++) {
+        sprintf(buffer, "word%d ", i);
+        words += buffer;
+    }
+    Highlighter highlighter;
+    highlighter.set_nick("bench");
+    highlighter.set_words(words);
+    size_t sz = corpus.size();
+    size_t i = 0;
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(highlighter.is_highlighted(corpus[i]));
+        if (++i == sz) i = 0;
+    }
+    ac.report(state);
+}
+BENCHMARK(BM_HighlighterMatch)->ArgName("words")->Arg(0)->Arg(16)->Arg(256);
+
+static void BM_IsNetsplit(benchmark::State& state) {
+    std::vector<std::string> corpus = make_corpus(quit_messages);
+    size_t sz = corpus.size();
+    size_t i = 0;
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(is_netsplit(corpus[i]));
+        if (++i == sz) i = 0;
+    }
+    ac.report(state);
+}
+BENCHMARK(BM_IsNetsplit);
+
+static void BM_Tokenize(benchmark::State& state) {
+    std::string line("#circada +ov alice bob :and a trailing text");
+    TokenizedParams params;
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        params.clear();
+        benchmark::DoNotOptimize(tokenize(3, line, params));
+    }
+    ac.report(state);
+}
+BENCHMARK(BM_Tokenize);
+
+static void BM_FlagsSetFlags(benchmark::State& state) {
+    Flags flags;
+    std::string set("+ntk"), unset("-k+l");
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        flags.set_flags(set);
+        flags.set_flags(unset);
+        benchmark::DoNotOptimize(&flags);
+    }
+    ac.report(state);
+}
+BENCHMARK(BM_FlagsSetFlags);
+
+/* the argument is the number of nicks in the channel */
+static void BM_SessionWindowAddNick(benchmark::State& state) {
+    BenchNickPrefix snp;
+    std::vector<std::string> nicks;
+    for (int i = 0; i < state.range(0); i++) {
+        nicks.push_back(make_nick(i));
+    }
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        SessionWindow w(0, WindowTypeChannel, "#circada", &snp);
+        for (size_t i = 0; i < nicks.size(); i++) {
+            w.add_nick(nicks[i], false);
+        }
+    }
+    ac.report(state);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SessionWindowAddNick)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+/* the names reply path: add unsorted, sort once */
+static void BM_SessionWindowSortNicks(benchmark::State& state) {
+    BenchNickPrefix snp;
+    std::vector<std::string> nicks;
+    for (int i = 0; i < state.range(0); i++) {
+        nicks.push_back((i % 10 ? "" : "@") + make_nick(i));
+    }
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        SessionWindow w(0, WindowTypeChannel, "#circada", &snp);
+        for (size_t i = 0; i < nicks.size(); i++) {
+            w.add_nick(nicks[i], true);
+        }
+        w.sort_nicks();
+    }
+    ac.report(state);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SessionWindowSortNicks)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+static void BM_SessionWindowChangeNick(benchmark::State& state) {
+    BenchNickPrefix snp;
+    SessionWindow w(0, WindowTypeChannel, "#circada", &snp);
+    for (int i = 0; i < state.range(0); i++) {
+        w.add_nick(make_nick(i), true);
+    }
+    w.sort_nicks();
+    std::string from = make_nick(state.range(0) / 2);
+    std::string to = from + "_away";
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        w.change_nick(from, to);
+        std::swap(from, to);
+    }
+    ac.report(state);
+}
+BENCHMARK(BM_SessionWindowChangeNick)->Arg(1000)->Arg(10000);
+
+/**************************************************************************
+ * dcc bandwidth scheduler
+ **************************************************************************/
+/* a bulk transfer alone under a global limit, 10 simulated seconds.
+ * it must get the limit minus its reserve, even at low rates. */
+static void BM_DCCBulkGrant(benchmark::State& state) {
+    u64 rate = static_cast<u64>(state.range(0));
+    u64 sent = 0;
+    long wakeups = 0;
+
+    for (auto _ : state) {
+        TokenBucket global;
+        global.set_rate(rate);
+        TokenBucket *buckets[] = { &global };
+        u64 reserve = DCCManager::get_bulk_reserve(global.get_burst());
+        sent = 0;
+        wakeups = 0;
+        long now = 0;
+        while (now < 10000) {
+            long ready_at;
+            u64 granted = DCCManager::get_grant(buckets, 1, reserve, 1048576, now, ready_at);
+            global.consume(granted);
+            sent += granted;
+            now = (ready_at > now ? ready_at : now + 1);
+            wakeups++;
+        }
+    }
+    if (!sent) {
+        state.SkipWithError("bulk transfer starved");
+        return;
+    }
+    state.counters["bytes/s"] = static_cast<double>(sent) / 10;
+    state.counters["wakeups"] = static_cast<double>(wakeups);
+}
+BENCHMARK(BM_DCCBulkGrant)->ArgName("rate")->Arg(4096)->Arg(16384)->Arg(20000)->Arg(32768)->Arg(1048576);
+
+/**************************************************************************
+ * frontend text helpers
+ **************************************************************************/
+static void BM_UTF8Iterate(benchmark::State& state) {
+    std::string text(utf8_text);
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        unsigned int sum = 0;
+        for (UTF8Iterator it = text.begin(); it != text.end(); ++it) {
+            sum += *it;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    ac.report(state);
+    state.SetBytesProcessed(state.iterations() * text.length());
+}
+BENCHMARK(BM_UTF8Iterate);
+
+static void BM_GetDisplayWidth(benchmark::State& state) {
+    std::string text(utf8_text);
+
+    AllocCounter ac;
+    for (auto _ : state) {
+        int width = 0;
+        for (UTF8Iterator it = text.begin(); it != text.end(); ++it) {
+            width += get_display_width(it.get_sequence());
+        }
+        benchmark::DoNotOptimize(width);
+    }
+    ac.report(state);
+    state.SetBytesProcessed(state.iterations() * text.length());
+}
+BENCHMARK(BM_GetDisplayWidth);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,371 @@
+/*
+ *  ReplayBench.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* replays irc traffic from a fake server on the loopback into a real
+ * session and reports lines per second, the time per line, the heap
+ * allocations per line and the peak rss.
+ * usage: replay_bench <join|netsplit|privmsg|ctcp> [count]
+ *        replay_bench file <recorded server lines>
+ */
+
+#include "AllocationCounter.hpp"
+
+#include <Circada/Circada.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+using namespace Circada;
+
+static long long get_nanoseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static const char *BenchNick = "bench";
+static const char *BenchChannel = "#bench";
+
+/* a channel with the given amount of users and the bench in it */
+static int add_names(std::string& out, int users) {
+    char buf[64];
+    int lines = 0;
+    out += std::string(":") + BenchNick + "!u@localhost JOIN :" + BenchChannel + "\r\n";
+    out += std::string(":srv 332 ") + BenchNick + " " + BenchChannel + " :replayed traffic\r\n";
+    lines += 2;
+    for (int i = 0; i < users; i += 40) {
+        out += std::string(":srv 353 ") + BenchNick + " = " + BenchChannel + " :";
+        for (int j = i; j < users && j < i + 40; j++) {
+            snprintf(buf, sizeof(buf), "%suser%d ", (j % 50 == 0 ? "@" : (j % 7 == 0 ? "+" : "")), j);
+            out += buf;
+        }
+        out += "\r\n";
+        lines++;
+    }
+    out += std::string(":srv 366 ") + BenchNick + " " + BenchChannel + " :End of /NAMES list.\r\n";
+
+    return lines + 1;
+}
+
+static int add_netsplit(std::string& out, int users) {
+    char buf[128];
+    for (int i = 0; i < users; i += 2) {
+        snprintf(buf, sizeof(buf), ":user%d!u@host%d QUIT :hub.example.net leaf.example.net\r\n", i, i);
+        out += buf;
+    }
+    for (int i = 0; i < users; i += 2) {
+        snprintf(buf, sizeof(buf), ":user%d!u@host%d JOIN :%s\r\n", i, i, BenchChannel);
+        out += buf;
+    }
+
+    return (users + 1) / 2 * 2;
+}
+
+static int add_privmsgs(std::string& out, int count, int users) {
+    static const char *texts[] = {
+        "hi all, anyone here who knows how to set up a bouncer?",
+        "I think the problem is in the config, try /set dcc_timeout 60 and reconnect.",
+        "lol",
+        "bench: here's a longer line that mentions you and keeps going and going with words",
+        "\x01" "ACTION waves\x01",
+        0
+    };
+    int ntexts = 0;
+    while (texts[ntexts]) ntexts++;
+
+    char buf[256];
+    for (int i = 0; i < count; i++) {
+        int u = i % users;
+        snprintf(buf, sizeof(buf), ":user%d!u@host%d PRIVMSG %s :%s\r\n", u, u, BenchChannel, texts[i % ntexts]);
+        out += buf;
+    }
+
+    return count;
+}
+
+static int add_ctcps(std::string& out, int count, int users) {
+    static const char *requests[] = { "VERSION", "PING 1234567890", "TIME", "CLIENTINFO", 0 };
+    char buf[128];
+    for (int i = 0; i < count; i++) {
+        int u = i % users;
+        snprintf(buf, sizeof(buf), ":user%d!u@host%d PRIVMSG %s :\x01%s\x01\r\n", u, u, BenchNick, requests[i % 4]);
+        out += buf;
+    }
+
+    return count;
+}
+
+static int add_file(std::string& out, const char *filename) {
+    std::ifstream f(filename);
+    if (!f) {
+        return -1;
+    }
+
+    int lines = 0;
+    std::string line;
+    while (std::getline(f, line)) {
+        while (line.length() && (line[line.length() - 1] == '\r' || line[line.length() - 1] == '\n')) {
+            line.erase(line.length() - 1);
+        }
+        if (line.length()) {
+            out += line + "\r\n";
+            lines++;
+        }
+    }
+
+    return lines;
+}
+
+/* the server side of the loopback connection */
+class FakeServer {
+public:
+    FakeServer() : listen_fd(-1), fd(-1), port(0), running(true) {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(listen_fd, reinterpret_cast<struct sockaddr *>(&addr), len) || listen(listen_fd, 1)
+            || getsockname(listen_fd, reinterpret_cast<struct sockaddr *>(&addr), &len))
+        {
+            perror("listen");
+            exit(1);
+        }
+        port = ntohs(addr.sin_port);
+        in.reserve(65536);
+    }
+
+    ~FakeServer() {
+        running = false;
+        if (fd >= 0) {
+            shutdown(fd, SHUT_RDWR);
+        }
+        if (drain.joinable()) {
+            drain.join();
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        close(listen_fd);
+    }
+
+    unsigned short get_port() const {
+        return port;
+    }
+
+    void accept_client() {
+        fd = accept(listen_fd, 0, 0);
+        if (fd < 0) {
+            perror("accept");
+            exit(1);
+        }
+        drain = std::thread(&FakeServer::drain_client, this);
+    }
+
+    void send_all(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.length()) {
+            ssize_t rv = ::send(fd, data.data() + sent, data.length() - sent, MSG_NOSIGNAL);
+            if (rv <= 0) {
+                perror("send");
+                exit(1);
+            }
+            sent += rv;
+        }
+    }
+
+    void wait_for_login() {
+        while (!logged_in) {
+            usleep(1000);
+        }
+    }
+
+    /* all lines before the ping are processed, when the pong arrives */
+    void sync(int token) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "PING :sync%d\r\n", token);
+        send_all(buf);
+        while (pong < token) {
+            usleep(100);
+        }
+    }
+
+private:
+    int listen_fd;
+    int fd;
+    unsigned short port;
+    std::thread drain;
+    std::string in;
+    std::atomic<bool> running;
+    std::atomic<bool> logged_in{false};
+    std::atomic<int> pong{0};
+
+    /* reads everything the client sends, replies of ctcps too */
+    void drain_client() {
+        char buf[16384];
+        while (running) {
+            ssize_t rv = recv(fd, buf, sizeof(buf), 0);
+            if (rv <= 0) {
+                break;
+            }
+            in.append(buf, rv);
+            size_t pos;
+            while ((pos = in.find("\r\n")) != std::string::npos) {
+                if (!in.compare(0, 5, "USER ")) {
+                    logged_in = true;
+                } else if (!in.compare(0, 10, "PONG :sync")) {
+                    pong = atoi(in.c_str() + 10);
+                }
+                in.erase(0, pos + 2);
+            }
+        }
+    }
+};
+
+/* records, when each line was done */
+class BenchClient : public IrcClient {
+public:
+    BenchClient(Configuration& config) : IrcClient(config), recording(false), processed(0) { }
+
+    std::atomic<bool> recording;
+    std::atomic<size_t> processed;
+    std::vector<long long> done_at;
+
+    virtual void line_processed(Session *s, const Message& m) {
+        if (recording) {
+            size_t n = processed;
+            if (n < done_at.size()) {
+                done_at[n] = get_nanoseconds();
+                processed = n + 1;
+            }
+        }
+    }
+};
+
+int main(int argc, char *argv[]) {
+    std::string scenario = (argc > 1 ? argv[1] : "privmsg");
+    std::string setup, traffic;
+    int lines = 0;
+    if (scenario == "join") {
+        lines = add_names(traffic, (argc > 2 ? atoi(argv[2]) : 10000));
+    } else if (scenario == "netsplit") {
+        int users = (argc > 2 ? atoi(argv[2]) : 10000);
+        add_names(setup, users);
+        lines = add_netsplit(traffic, users);
+    } else if (scenario == "privmsg") {
+        add_names(setup, 200);
+        lines = add_privmsgs(traffic, (argc > 2 ? atoi(argv[2]) : 200000), 200);
+    } else if (scenario == "ctcp") {
+        add_names(setup, 200);
+        lines = add_ctcps(traffic, (argc > 2 ? atoi(argv[2]) : 50000), 200);
+    } else if (scenario == "file" && argc > 2) {
+        lines = add_file(traffic, argv[2]);
+        if (lines < 0) {
+            perror(argv[2]);
+            return 1;
+        }
+    } else {
+        fprintf(stderr, "usage: %s <join|netsplit|privmsg|ctcp> [count]\n", argv[0]);
+        fprintf(stderr, "       %s file <recorded server lines>\n", argv[0]);
+        return 1;
+    }
+
+    /* keep the configuration away from the real one */
+    char tmpdir[] = "/tmp/circada-bench-XXXXXX";
+    if (!mkdtemp(tmpdir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    setenv("HOME", tmpdir, 1);
+
+    FakeServer server;
+    Configuration config(".circada");
+    BenchClient client(config);
+    client.done_at.resize(lines);
+
+    SessionOptions options;
+    options.server = "127.0.0.1";
+    options.port = server.get_port();
+    options.nick = BenchNick;
+    options.alternative_nick = std::string(BenchNick) + "_";
+    options.user = BenchNick;
+    options.real_name = BenchNick;
+    Session *s = client.create_session(options);
+    s->connect();
+
+    server.accept_client();
+    server.wait_for_login();
+    server.send_all(std::string(":srv 001 ") + BenchNick + " :Welcome to the replay\r\n"
+        ":srv 005 " + BenchNick + " PREFIX=(ov)@+ CHANTYPES=# NICKLEN=30 :are supported by this server\r\n");
+    server.send_all(setup);
+    server.sync(1);
+
+    /* measured part */
+    unsigned long allocations_before = get_allocations();
+    client.recording = true;
+    long long start = get_nanoseconds();
+    server.send_all(traffic);
+    server.sync(2);
+    client.recording = false;
+    unsigned long allocations_used = get_allocations() - allocations_before;
+
+    size_t processed = client.processed;
+    double elapsed = (processed ? client.done_at[processed - 1] - start : 0) / 1e9;
+    std::vector<long long> per_line;
+    per_line.reserve(processed);
+    for (size_t i = 0; i < processed; i++) {
+        per_line.push_back(client.done_at[i] - (i ? client.done_at[i - 1] : start));
+    }
+    std::sort(per_line.begin(), per_line.end());
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("scenario:      %s\n", scenario.c_str());
+    printf("lines:         %zu of %d\n", processed, lines);
+    printf("elapsed:       %.3f s\n", elapsed);
+    printf("lines/s:       %.1f\n", (elapsed > 0 ? processed / elapsed : 0));
+    if (processed) {
+        printf("p50 per line:  %.2f us\n", per_line[processed / 2] / 1000.0);
+        printf("p99 per line:  %.2f us\n", per_line[processed * 99 / 100] / 1000.0);
+        printf("max per line:  %.2f us\n", per_line[processed - 1] / 1000.0);
+        printf("allocs/line:   %.2f\n", static_cast<double>(allocations_used) / processed);
+    }
+    printf("peak rss:      %ld kB\n", usage.ru_maxrss);
+
+    s->disconnect();
+    client.destroy_session(s);
+
+    return 0;
+}
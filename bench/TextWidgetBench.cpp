@@ -0,0 +1,409 @@
+/*
+ *  TextWidgetBench.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* renders the widgets of the main screen into a fake terminal, the way
+ * Application lays them out and locks them, and reports per scenario the
+ * frames per second, the bytes sent to the terminal and how long the draw
+ * mutex was held.
+ * usage: text_widget_bench [scenario] [lines] [frames] [cols] [rows]
+ * scenarios: redraw, flood, nicklist, status, resize, format, all (default)
+ */
+
+#include "TextWidget.hpp"
+#include "StatusWidget.hpp"
+#include "NicklistWidget.hpp"
+#include "ScreenWindow.hpp"
+#include "Formatter.hpp"
+
+#include <Circada/Circada.hpp>
+#include <Circada/Mutex.hpp>
+#include <Circada/Window.hpp>
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <clocale>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace Circada;
+
+static double get_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *nicks[] = { "freanux", "alice", "bob", "Mallory", "trent", "peggy_", 0 };
+static const char *texts[] = {
+    "hi all, anyone here who knows how to set up a bouncer?",
+    "I think the problem is in the config, try /set dcc_timeout 60 and reconnect.",
+    "lol",
+    "here's a longer line that will wrap on narrow terminals because it just keeps going and going with words",
+    "Ünïcödé tëxt wïth ümläüts ånd ∑ymbols → ok",
+    0
+};
+
+/* raw server lines for the flood, every formatter path without numerics */
+static const char *flood_lines[] = {
+    ":alice!~alice@example.net PRIVMSG #circada :hi all, anyone here who knows how to set up a bouncer?",
+    ":bob!bob@example.org PRIVMSG #circada :\001ACTION waves\001",
+    ":trent!trent@example.org NOTICE #circada :Ünïcödé tëxt wïth ümläüts ånd ∑ymbols → ok",
+    ":peggy_!~peggy@10.0.0.7 JOIN :#circada",
+    ":dave!dave@example.com PART #circada :bye",
+    ":carol!~carol@example.com QUIT :Ping timeout: 240 seconds",
+    ":ChanServ!ChanServ@services. MODE #circada +o alice",
+    ":Mallory!~m@example.net PRIVMSG #circada :here's a longer line that will wrap on narrow terminals because it just keeps going and going with words",
+    0
+};
+
+static const int NicklistWidth = 16;
+static const int ChannelCount = 20;
+
+class BenchNickPrefix : public ServerNickPrefix {
+public:
+    BenchNickPrefix() : chars("ov"), symbols("@+") { }
+
+    virtual const std::string& get_nick_chars() const { return chars; }
+    virtual const std::string& get_nick_symbols() const { return symbols; }
+
+private:
+    std::string chars;
+    std::string symbols;
+};
+
+struct Result {
+    Result() : frames(0), elapsed(0), bytes(0), held(0), held_max(0) { }
+
+    int frames;
+    double elapsed;
+    long bytes;
+    double held;
+    double held_max;
+};
+
+/* locks the draw mutex like Application does and accounts the time it is held */
+class DrawLock {
+public:
+    DrawLock(Mutex& mtx, Result& result) : lock(&mtx), result(result), start(get_seconds()) { }
+
+    ~DrawLock() {
+        double held = get_seconds() - start;
+        result.held += held;
+        if (held > result.held_max) {
+            result.held_max = held;
+        }
+    }
+
+private:
+    ScopeMutex lock;
+    Result& result;
+    double start;
+};
+
+/* the main screen without topic, treeview and entry */
+class Screen {
+public:
+    Screen(Configuration& config, int nlines, int nnicks)
+        : status_widget(windows), text_widget(status_widget)
+    {
+        for (int i = 0; i < ChannelCount; i++) {
+            char name[32];
+            sprintf(name, "#circada%d", i);
+            SessionWindow *cw = new SessionWindow(0, WindowTypeChannel, name, &snp);
+            channels.push_back(cw);
+            windows.push_back(new ScreenWindow(config, i, 0, cw));
+        }
+        selected = windows[0];
+
+        /* fill scrollback with regular privmsgs */
+        int nnick_names = 0, ntexts = 0;
+        while (nicks[nnick_names]) nnick_names++;
+        while (texts[ntexts]) ntexts++;
+        for (int i = 0; i < nlines; i++) {
+            Message m;
+            m.session = 0;
+            m.pc = 2;
+            m.injected = false;
+            m.its_me = false;
+            m.to_me = (i % 17 == 0);
+            m.unhandled_ctcp_dcc = false;
+            m.timestamp = "12:34";
+            m.command = "PRIVMSG";
+            m.nick = nicks[i % nnick_names];
+            m.params.push_back("#circada");
+            m.params.push_back(texts[i % ntexts]);
+            selected->add_line(fmt, m);
+        }
+
+        /* a big channel, every tenth nick is an operator */
+        for (int i = 0; i < nnicks; i++) {
+            char nick[32];
+            sprintf(nick, "%suser%05d", (i % 10 ? "" : "@"), (i * 7919) % 100000);
+            channels[0]->add_nick(nick, true);
+        }
+        channels[0]->sort_nicks();
+        text_widget.select_window(selected);
+        nicklist_widget.select_window(selected);
+    }
+
+    ~Screen() {
+        for (ScreenWindow::List::iterator it = windows.begin(); it != windows.end(); it++) {
+            delete *it;
+        }
+        for (SessionWindow::List::iterator it = channels.begin(); it != channels.end(); it++) {
+            delete *it;
+        }
+    }
+
+    /* see Application::configure() */
+    void configure(Result& result) {
+        int height, width;
+        getmaxyx(stdscr, height, width);
+        {
+            DrawLock lock(draw_mtx, result);
+            nicklist_widget.configure(1, width - NicklistWidth, NicklistWidth, height - 3);
+            text_widget.configure(height - 2, width - NicklistWidth, 0);
+            status_widget.configure(height - 2, width);
+        }
+        refresh();
+        draw(result);
+    }
+
+    /* see Application::draw() */
+    void draw(Result& result) {
+        DrawLock lock(draw_mtx, result);
+        text_widget.draw();
+        nicklist_widget.draw(selected);
+        status_widget.draw();
+    }
+
+    Mutex draw_mtx;
+    Formatter fmt;
+    BenchNickPrefix snp;
+    SessionWindow::List channels;
+    ScreenWindow::List windows;
+    ScreenWindow *selected;
+    StatusWidget status_widget;
+    TextWidget text_widget;
+    NicklistWidget nicklist_widget;
+};
+
+/* alternate between scrolling and full redraws */
+static void run_redraw(Screen& screen, int frames, Result& result) {
+    for (int i = 0; i < frames; i++) {
+        if (i % 4 == 3) {
+            DrawLock lock(screen.draw_mtx, result);
+            screen.text_widget.scroll_down();
+        } else if (i % 2) {
+            DrawLock lock(screen.draw_mtx, result);
+            screen.text_widget.scroll_up();
+        } else {
+            screen.text_widget.select_window(screen.selected);
+            screen.draw(result);
+        }
+    }
+}
+
+/* incoming lines, see Application::message_router() */
+static void run_flood(Screen& screen, int frames, Result& result) {
+    int nlines = 0;
+    while (flood_lines[nlines]) nlines++;
+    Message m;
+    for (int i = 0; i < frames; i++) {
+        m.parse(0, flood_lines[i % nlines]);
+        DrawLock lock(screen.draw_mtx, result);
+        const std::string& line = screen.selected->add_line(screen.fmt, m);
+        screen.text_widget.draw_line(screen.selected, line);
+        screen.text_widget.refresh(screen.selected);
+    }
+}
+
+/* nicks join and part at the top of the list, sometimes it is scrolled */
+static void run_nicklist(Screen& screen, int frames, Result& result) {
+    SessionWindow *cw = screen.channels[0];
+    for (int i = 0; i < frames; i++) {
+        char nick[32];
+        sprintf(nick, "aa%03d", (i / 2) % 1000);
+        DrawLock lock(screen.draw_mtx, result);
+        if (i % 16 == 15) {
+            screen.nicklist_widget.scroll_down();
+        } else if (i % 16 == 7) {
+            screen.nicklist_widget.scroll_up();
+        } else if (i % 2) {
+            cw->remove_nick(nick);
+        } else {
+            cw->add_nick(nick, false);
+        }
+        screen.nicklist_widget.draw(screen.selected);
+    }
+}
+
+/* lag updates and window activities */
+static void run_status(Screen& screen, int frames, Result& result) {
+    for (int i = 0; i < frames; i++) {
+        DrawLock lock(screen.draw_mtx, result);
+        SessionWindow *cw = screen.channels[1 + i % (ChannelCount - 1)];
+        if (cw->get_action() == WindowActionNone) {
+            cw->set_action(i % 3 ? WindowActionNoise : WindowActionChat);
+        } else {
+            cw->reset_action();
+        }
+        screen.status_widget.set_lag((i % 100) / 100.0);
+        screen.status_widget.set_nick_count(screen.channels[0]->get_nicks().size());
+        screen.status_widget.draw();
+    }
+}
+
+/* the terminal shrinks and grows again */
+static void run_resize(Screen& screen, int frames, Result& result, int cols, int rows) {
+    for (int i = 0; i < frames; i++) {
+        if (i % 2) {
+            resizeterm(rows, cols);
+        } else {
+            resizeterm(rows * 3 / 4, cols * 3 / 4);
+        }
+        screen.configure(result);
+    }
+    resizeterm(rows, cols);
+    screen.configure(result);
+}
+
+/* Formatter::parse() alone, the terminal is not touched */
+static void run_format(Screen& screen, int frames, Result& result) {
+    int nlines = 0;
+    while (flood_lines[nlines]) nlines++;
+    std::vector<Message> msgs(nlines);
+    for (int i = 0; i < nlines; i++) {
+        msgs[i].parse(0, flood_lines[i]);
+    }
+    std::string line;
+    for (int i = 0; i < frames; i++) {
+        screen.fmt.parse(msgs[i % nlines], line, 0);
+    }
+}
+
+static void print_result(const char *scenario, const Result& r) {
+    printf("%-9s %8d %9.3f %11.1f %11.1f %10.1f %10.1f\n", scenario, r.frames, r.elapsed,
+        (r.elapsed > 0 ? r.frames / r.elapsed : 0),
+        (r.frames ? static_cast<double>(r.bytes) / r.frames : 0),
+        (r.frames ? r.held / r.frames * 1e6 : 0), r.held_max * 1e6);
+}
+
+int main(int argc, char *argv[]) {
+    const char *scenario = "all";
+    int arg = 1;
+    if (argc > arg && !isdigit(argv[arg][0])) {
+        scenario = argv[arg++];
+    }
+    int nlines = (argc > arg ? atoi(argv[arg]) : 10000);
+    int frames = (argc > arg + 1 ? atoi(argv[arg + 1]) : 500);
+    int cols = (argc > arg + 2 ? atoi(argv[arg + 2]) : 160);
+    int rows = (argc > arg + 3 ? atoi(argv[arg + 3]) : 50);
+
+    /* keep the configuration away from the real one */
+    char tmpdir[] = "/tmp/circada-bench-XXXXXX";
+    if (!mkdtemp(tmpdir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    setenv("HOME", tmpdir, 1);
+    setlocale(LC_ALL, "");
+
+    /* fake terminal */
+    FILE *out = tmpfile();
+    FILE *in = fopen("/dev/null", "r");
+    if (!out || !in) {
+        perror("fopen");
+        return 1;
+    }
+    SCREEN *scr = newterm("xterm-256color", out, in);
+    if (!scr) {
+        fprintf(stderr, "cannot create terminal.\n");
+        return 1;
+    }
+    resizeterm(rows, cols);
+    start_color();
+    use_default_colors();
+    for (int i = 0; i < 256; i++) {
+        int fg = i & 0x0f;
+        int bg = i >> 4;
+        if (!bg) bg = -1;
+        init_pair(i, fg, bg);
+    }
+
+    static const char *scenarios[] = { "redraw", "flood", "nicklist", "status", "resize", "format", 0 };
+    bool all = !strcmp(scenario, "all");
+    bool known = all;
+    for (int i = 0; scenarios[i]; i++) {
+        if (!strcmp(scenario, scenarios[i])) known = true;
+    }
+    if (!known) {
+        endwin();
+        delscreen(scr);
+        fprintf(stderr, "unknown scenario: %s\n", scenario);
+        return 1;
+    }
+
+    Result results[sizeof(scenarios) / sizeof(scenarios[0])];
+    {
+        Configuration config(".circada");
+        Screen screen(config, nlines, 1000);
+        Result dummy;
+        screen.configure(dummy);
+
+        for (int i = 0; scenarios[i]; i++) {
+            if (!all && strcmp(scenario, scenarios[i])) continue;
+            Result& r = results[i];
+            fflush(out);
+            long start_bytes = ftell(out);
+            double start = get_seconds();
+            switch (i) {
+                case 0: run_redraw(screen, r.frames = frames, r); break;
+                case 1: run_flood(screen, r.frames = frames * 20, r); break;
+                case 2: run_nicklist(screen, r.frames = frames * 4, r); break;
+                case 3: run_status(screen, r.frames = frames * 4, r); break;
+                case 4: run_resize(screen, r.frames = frames / 5, r, cols, rows); break;
+                case 5: run_format(screen, r.frames = frames * 200, r); break;
+            }
+            fflush(out);
+            r.elapsed = get_seconds() - start;
+            r.bytes = ftell(out) - start_bytes;
+        }
+    }
+
+    endwin();
+    delscreen(scr);
+    fclose(in);
+    fclose(out);
+
+    printf("lines:    %d\n", nlines);
+    printf("terminal: %dx%d\n", cols, rows);
+    printf("%-9s %8s %9s %11s %11s %10s %10s\n", "scenario", "frames", "elapsed", "frames/s", "bytes/frame", "held us", "max us");
+    for (int i = 0; scenarios[i]; i++) {
+        if (!all && strcmp(scenario, scenarios[i])) continue;
+        print_result(scenarios[i], results[i]);
+    }
+
+    return 0;
+}
@@ -19,7 +19,9 @@
  */
 
 #include "Application.hpp"
+#include "LuaFFI.hpp"
 #include "UTF8.hpp"
+#include "Utils.hpp"
 
 #include <unistd.h>
 #include <cstdlib>
@@ -27,6 +29,44 @@
 
 namespace {
 
+    struct LuaHook {
+        LuaEvent::Type type;
+        const char *event;
+        const char *legacy;
+    };
+
+    const LuaHook LuaHooks[] = {
+        { LuaEvent::TypeConnectionLost,     "connection_lost",  "on_connection_lost" },
+        { LuaEvent::TypeMessageArrived,     "message",          "on_message_arrived" },
+        { LuaEvent::TypeMessages,           "messages",         "on_messages" },
+        { LuaEvent::TypeMyModeChanged,      "my_mode",          "on_my_mode_changed" },
+        { LuaEvent::TypeWindowOpened,       "window_opened",    "on_window_opened" },
+        { LuaEvent::TypeWindowClosing,      "window_closing",   "on_window_closing" },
+        { LuaEvent::TypeTopicChanged,       "topic",            "on_topic_changed" },
+        { LuaEvent::TypeNameChanged,        "name",             "on_name_changed" },
+        { LuaEvent::TypeChannelModeChanged, "channel_mode",     "on_channel_mode_changed" },
+        { LuaEvent::TypeNewNicklist,        "new_nicklist",     "on_new_nicklist" },
+        { LuaEvent::TypeNickAdded,          "nick_added",       "on_nick_added" },
+        { LuaEvent::TypeNickRemoved,        "nick_removed",     "on_nick_removed" },
+        { LuaEvent::TypeNickChanged,        "nick_changed",     "on_nick_changed" }
+    };
+
+    const size_t LuaHookCount = sizeof(LuaHooks) / sizeof(LuaHook);
+
+    std::string format_location(const char *src, int line) {
+        const char *name = strrchr(src, '/');
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), ":%d", line);
+
+        return std::string(name ? name + 1 : src) + buffer;
+    }
+
+    /* the budget is checked every LuaHookInterval instructions */
+    const int LuaHookInterval = 1000;
+
+    /* the budget hook finds the application here */
+    const char *LuaRegistryApplication = "circada.application";
+
     void fill_opt(const Configuration& config, const std::string& category, const std::string& key, std::string& into) {
         const std::string& value = config.get_value(category, key);
         if (value.length()) {
@@ -39,14 +79,70 @@ namespace {
         }
     }
 
+    /* rates are given in bytes per second with an optional k, m or g suffix */
+    bool parse_rate(const std::string& str, u64& rate) {
+        char *end = 0;
+        rate = strtoull(str.c_str(), &end, 10);
+        if (end == str.c_str()) {
+            return false;
+        }
+        switch (*end) {
+            case 'k': case 'K': rate *= 1024; end++; break;
+            case 'm': case 'M': rate *= 1024 * 1024; end++; break;
+            case 'g': case 'G': rate *= 1024 * 1024 * 1024; end++; break;
+        }
+
+        return (*end == 0);
+    }
+
+    std::string format_rate(u64 rate) {
+        char buffer[32];
+        if (!rate) {
+            return "unlimited";
+        }
+        if (rate >= 1024 * 1024 && !(rate % (1024 * 1024))) {
+            sprintf(buffer, "%llu MiB/s", static_cast<unsigned long long>(rate / (1024 * 1024)));
+        } else if (rate >= 1024 && !(rate % 1024)) {
+            sprintf(buffer, "%llu KiB/s", static_cast<unsigned long long>(rate / 1024));
+        } else {
+            sprintf(buffer, "%llu bytes/s", static_cast<unsigned long long>(rate));
+        }
+
+        return buffer;
+    }
+
+    bool parse_limit_scope(const std::string& str, DCCLimitScope& scope) {
+        if (is_equal(str, "global")) {
+            scope = DCCLimitGlobal;
+        } else if (is_equal(str, "nick")) {
+            scope = DCCLimitNick;
+        } else if (is_equal(str, "transfer")) {
+            scope = DCCLimitTransfer;
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
 }
 
 Application::Application(Configuration& config)
     : IrcClient(config), config(config), nicklist_width(0), selected_window(0),
       entry_widget(draw_mtx), number_widget(draw_mtx), status_widget(windows),
       text_widget(status_widget), window_sequence(0), input_numbers(false),
-      number_input_sign("%"), windowbar_separator("│"), nicklist_visible(true),
-      treeview_visible(true), highlightwindow_visible(false)
+      number_input_sign("%"), windowbar_separator("│"), nicklist_dirty(false),
+      nicklist_drawn_at(0), nicklist_timer(*this), nicklist_visible(true),
+      treeview_visible(true), highlightwindow_visible(false), stats_time(get_monotonic_us()), lua_profile(0),
+      lua_call_started(0), lua_call_instructions(0), lua_call_allocations(0),
+      lua_call_aborted(false), lua_budget_hooked(false), lua_allocations(0), lua_budget_ms(config, "", "lua_budget", "0"),
+      lua_budget_instructions(config, "", "lua_budget_instructions", "0"),
+      lua_call_time(get_metrics().histogram("circada_lua_call_seconds", "Time spent in lua calls.")),
+      lua_aborted_calls(get_metrics().counter("circada_lua_aborted_total", "Lua calls aborted over budget.")),
+      lua(lua_create_state()), lua_subscription_id(0),
+      lua_subscriptions_dirty(false), lua_hooked(0), lua_executor(*this),
+      script_file(config.get_value("", "script")), config_reload_pending(false),
+      script_reload_pending(false), file_watcher(*this), settings_listener(*this)
 {
     /* set to system default locale. ensure,       */
     /* that you have UTF-8 as globallocale set up. */
@@ -85,9 +181,22 @@ Application::Application(Configuration& config)
     /* create application window */
     create_application_window(get_project_name(), get_project_name());
 
+    /* react to /set */
+    config.add_listener(&settings_listener);
+
+    std::string metrics_error = get_metrics_error();
+    if (metrics_error.length()) {
+        print(get_window(get_application_window()), metrics_error);
+    }
 }
 
 Application::~Application() {
+    nicklist_timer.stop();
+    lua_executor.stop();
+    lua_clear_subscriptions();
+    lua_clear_timers();
+    file_watcher.stop();
+    config.remove_listener(&settings_listener);
     endwin();
     for (ScreenWindow::List::iterator it = windows.begin(); it != windows.end(); it++) {
         delete *it;
@@ -96,22 +205,29 @@ Application::~Application() {
 
 void Application::run() {
     /* startup script lua */
-    try {
-        std::string lua_file = config.get_value("", "script");
-        if (lua_file.length()) {
-            lua.safe_script_file(lua_file);
-        }
-    } catch (const sol::error& e) {
-        lua_error(e);
-    }
+    nicklist_timer.start();
+    lua_executor.start();
+    LuaEvent evt(LuaEvent::TypeLoad, 0, 0);
+    evt.a = script_file;
+    lua_executor.post(evt);
+
+    /* watch config and script for changes */
+    start_file_watcher();
 
     /* loop */
     time_t old_time = 0;
     running = true;
     while (running) {
+        if (config_reload_pending.exchange(false)) {
+            reload_config();
+        }
+        if (script_reload_pending.exchange(false)) {
+            reload_script();
+        }
         time_t new_time = time(0);
         if (new_time != old_time) {
             old_time = new_time;
+            flush_logs();
             ScopeMutex lock(&draw_mtx);
             status_widget.draw_time(new_time);
             status_widget.refresh();
@@ -559,7 +675,116 @@ void Application::execute(const std::string& line) {
         execute_netsplits(params);
     } else if (is_equal(command.c_str(), "lua")) {
         execute_lua(params);
-    }
+    } else if (is_equal(command.c_str(), "search")) {
+        execute_search(params);
+    } else if (is_equal(command.c_str(), "jump")) {
+        execute_jump(params);
+    } else if (is_equal(command.c_str(), "stats")) {
+        execute_stats(params);
+    }
+}
+
+void Application::search_nolock(const std::string& query, ScreenWindow::Hits& hits) {
+    /* /search [-nick <nick>] [-window <name>] [-since <n>[smhd]] [-max <n>] [--] <words> */
+    Params p;
+    split(query, p);
+
+    std::string nick;
+    std::string window_name;
+    time_t since = 0;
+    size_t max_hits = 50;
+    std::string text;
+
+    size_t sz = p.size();
+    bool options = true;
+    for (size_t i = 0; i < sz; i++) {
+        const std::string& param = p[i];
+        if (options && param == "--") {
+            /* the rest are words, even if they start with a dash */
+            options = false;
+        } else if (options && param.length() > 1 && param[0] == '-' && i + 1 < sz) {
+            const std::string& value = p[++i];
+            if (is_equal(param.c_str(), "-nick")) {
+                nick = value;
+            } else if (is_equal(param.c_str(), "-window")) {
+                window_name = value;
+            } else if (is_equal(param.c_str(), "-since")) {
+                char *end;
+                long amount = strtol(value.c_str(), &end, 10);
+                bool valid = (end != value.c_str() && amount >= 0);
+                long unit = 60;
+                if (*end) {
+                    switch (*end++) {
+                        case 's': unit = 1; break;
+                        case 'm': unit = 60; break;
+                        case 'h': unit = 3600; break;
+                        case 'd': unit = 86400; break;
+                        default: valid = false; break;
+                    }
+                }
+                if (!valid || *end) {
+                    throw ApplicationException("Invalid -since value, use a number with s, m, h or d: " + value);
+                }
+                since = time(0) - amount * unit;
+            } else if (is_equal(param.c_str(), "-max")) {
+                char *end;
+                long amount = strtol(value.c_str(), &end, 10);
+                if (end == value.c_str() || *end || amount < 1) {
+                    throw ApplicationException("Invalid -max value, use a number from 1: " + value);
+                }
+                max_hits = static_cast<size_t>(amount);
+            } else {
+                throw ApplicationException("Unknown search option: " + param);
+            }
+        } else {
+            text += param + " ";
+        }
+    }
+
+    SearchIndex::Words words;
+    SearchIndex::get_words(text, words);
+    if (!words.size()) {
+        throw ApplicationException("Usage: /search [-nick <nick>] [-window <name>] [-since <n>[smhd]] [-max <n>] [--] <words>");
+    }
+
+    hits.clear();
+    for (ScreenWindow::List::iterator it = windows.begin(); it != windows.end(); it++) {
+        ScreenWindow *sw = *it;
+        Window *w = sw->get_circada_window();
+        /* skip our own output, search results are printed there */
+        if (w->get_window_type() == WindowTypeApplication) {
+            continue;
+        }
+        if (window_name.length() && !is_equal(w->get_name(), window_name)) {
+            continue;
+        }
+        sw->search(words, nick, since, max_hits, hits);
+    }
+
+    /* newest first */
+    std::stable_sort(hits.begin(), hits.end(), ScreenWindowHitComparer());
+    if (hits.size() > max_hits) {
+        hits.resize(max_hits);
+    }
+}
+
+void Application::jump_to_hit(const ScreenWindow::Hit& hit) {
+    ScreenWindow *sw;
+    {
+        ScopeMutex lock(&draw_mtx);
+        sw = get_window_by_sequence_nolock(hit.sequence);
+    }
+    if (!sw) {
+        throw ApplicationException("The window of this hit is closed.");
+    }
+    select_window(sw);
+
+    ScopeMutex lock(&draw_mtx);
+    int index = sw->get_line_index(hit.id);
+    if (index < 0) {
+        throw ApplicationException("This line is not in the scrollback anymore.");
+    }
+    text_widget.show_line(index);
 }
 
 void Application::split(const std::string& from, Params& into, int max_params) {
@@ -721,20 +946,28 @@ void Application::execute_dcc(const std::string& params) {
                 fmt.append_format(" (", fmt.fmt_dcc_info, line);
                 fmt.append_format(xfer.get_filename(), fmt.fmt_dcc_bold, line);
 
-                sprintf(buffer, "%u bytes", xfer.get_filesize());
+                sprintf(buffer, "%llu bytes", static_cast<unsigned long long>(xfer.get_filesize()));
                 fmt.append_format(", ", fmt.fmt_dcc_info, line);
                 fmt.append_format(buffer, fmt.fmt_dcc_info, line);
 
                 if (handle.is_running()) {
-                    sprintf(buffer, "%u bytes transferred", xfer.get_transferred_bytes());
+                    sprintf(buffer, "%llu bytes transferred", static_cast<unsigned long long>(xfer.get_transferred_bytes()));
                     fmt.append_format(", ", fmt.fmt_dcc_info, line);
                     fmt.append_format(buffer, fmt.fmt_dcc_info, line);
                 }
 
                 fmt.append_format(")", fmt.fmt_dcc_info, line);
             }
+            std::string state = (handle.is_running() ? (handle.is_connected() ? "RUNNING" : "WAIT") : "HELD");
+            if (handle.get_type() == DCCTypeXfer) {
+                size_t position = get_xfer_handle(handle).get_queue_position();
+                if (position) {
+                    sprintf(buffer, "QUEUED #%lu", static_cast<unsigned long>(position));
+                    state = buffer;
+                }
+            }
             fmt.append_format(" - ", fmt.fmt_dcc_info, line);
-            fmt.append_format((handle.is_running() ? (handle.is_connected() ? "RUNNING" : "WAIT") : "HELD"), fmt.fmt_dcc_bold, line);
+            fmt.append_format(state, fmt.fmt_dcc_bold, line);
             print_line(into, timestamp, line);
         }
         print_line(into, timestamp, "End of list", fmt.fmt_text_normal);
@@ -803,6 +1036,72 @@ void Application::execute_dcc(const std::string& params) {
         }
         text_widget.refresh(into);
         set_cursor();
+    } else if (is_equal(p[0], "limit") && p.size() == 1) {
+        print_line(into, timestamp, "DCC bandwidth limits:", fmt.fmt_text_bold);
+        print_line(into, timestamp, " global: " + format_rate(dcc_get_limit(DCCLimitGlobal)), fmt.fmt_dcc_info);
+        print_line(into, timestamp, " per nick: " + format_rate(dcc_get_limit(DCCLimitNick)), fmt.fmt_dcc_info);
+        print_line(into, timestamp, " per transfer: " + format_rate(dcc_get_limit(DCCLimitTransfer)), fmt.fmt_dcc_info);
+        text_widget.refresh(into);
+        set_cursor();
+    } else if (is_equal(p[0], "limit") && p.size() == 3) {
+        DCCLimitScope scope;
+        u64 rate;
+        if (!parse_rate(p[2], rate)) {
+            print_line(into, timestamp, "Invalid rate, use bytes per second with an optional k, m or g suffix.", fmt.fmt_dcc_fail);
+        } else if (parse_limit_scope(p[1], scope)) {
+            dcc_set_limit(scope, rate);
+            print_line(into, timestamp, "DCC " + p[1] + " limit set to " + format_rate(rate) + ".", fmt.fmt_dcc_info);
+        } else {
+            int index = atoi(p[1].c_str()) - 1;
+            if (index < 0 || index >= static_cast<int>(into->dcc_handles.size())) {
+                print_line(into, timestamp, "Invalid DCC selected.", fmt.fmt_text_normal);
+            } else {
+                DCCHandle dcc = into->dcc_handles[index];
+                try {
+                    dcc_set_transfer_limit(dcc, rate);
+                    print_line(into, timestamp, "DCC transfer limit set to " + format_rate(rate) + ".", fmt.fmt_dcc_info);
+                } catch (const Exception& e) {
+                    print_line(into, timestamp, e.what(), fmt.fmt_dcc_fail);
+                }
+            }
+        }
+        text_widget.refresh(into);
+        set_cursor();
+    } else if (is_equal(p[0], "slots") && p.size() == 1) {
+        print_line(into, timestamp, "DCC transfer slots:", fmt.fmt_text_bold);
+        sprintf(buffer, " global: %u, per nick: %u (0 is unlimited)", dcc_get_slots(DCCLimitGlobal), dcc_get_slots(DCCLimitNick));
+        print_line(into, timestamp, buffer, fmt.fmt_dcc_info);
+        text_widget.refresh(into);
+        set_cursor();
+    } else if (is_equal(p[0], "slots") && p.size() == 3) {
+        DCCLimitScope scope;
+        if (!parse_limit_scope(p[1], scope) || scope == DCCLimitTransfer) {
+            print_line(into, timestamp, "Slots are either global or per nick.", fmt.fmt_dcc_fail);
+        } else {
+            unsigned int slots = static_cast<unsigned int>(atoi(p[2].c_str()));
+            dcc_set_slots(scope, slots);
+            sprintf(buffer, "DCC %s slots set to %u.", p[1].c_str(), slots);
+            print_line(into, timestamp, buffer, fmt.fmt_dcc_info);
+        }
+        text_widget.refresh(into);
+        set_cursor();
+    } else if (is_equal(p[0], "priority") && p.size() == 3) {
+        int index = atoi(p[1].c_str()) - 1;
+        if (index < 0 || index >= static_cast<int>(into->dcc_handles.size())) {
+            print_line(into, timestamp, "Invalid DCC selected.", fmt.fmt_text_normal);
+        } else if (!is_equal(p[2], "normal") && !is_equal(p[2], "bulk")) {
+            print_line(into, timestamp, "Priority must be normal or bulk.", fmt.fmt_dcc_fail);
+        } else {
+            DCCHandle dcc = into->dcc_handles[index];
+            try {
+                dcc_set_priority(dcc, (is_equal(p[2], "bulk") ? DCCPriorityBulk : DCCPriorityNormal));
+                print_line(into, timestamp, "DCC priority set to " + p[2] + ".", fmt.fmt_dcc_info);
+            } catch (const Exception& e) {
+                print_line(into, timestamp, e.what(), fmt.fmt_dcc_fail);
+            }
+        }
+        text_widget.refresh(into);
+        set_cursor();
     } else if (is_equal(p[0], "chat") && p.size() == 2) {
         if (!s) {
             print(into, "Change into running connection.");
@@ -830,13 +1129,13 @@ void Application::execute_dcc(const std::string& params) {
             try {
                 DCCXferHandle dcc = s->dcc_file_offer(p[1], p[2]);
                 std::string info;
-                fmt.append_format("You offered a ", fmt.fmt_dcc, info);
+                fmt.append_format((dcc.is_queued() ? "You queued a " : "You offered a "), fmt.fmt_dcc, info);
                 fmt.append_format("DCC XFER", fmt.fmt_dcc_bold, info);
                 fmt.append_format(" request to ", fmt.fmt_dcc, info);
                 fmt.append_format(dcc.get_his_nick(), fmt.fmt_dcc_bold, info);
                 fmt.append_format(" (", fmt.fmt_dcc, info);
                 fmt.append_format(dcc.get_filename(), fmt.fmt_dcc_bold, info);
-                sprintf(buffer, "%u bytes", dcc.get_filesize());
+                sprintf(buffer, "%llu bytes", static_cast<unsigned long long>(dcc.get_filesize()));
                 fmt.append_format(", ", fmt.fmt_dcc_info, info);
                 fmt.append_format(buffer, fmt.fmt_dcc_info, info);
                 fmt.append_format(")", fmt.fmt_dcc, info);
@@ -893,11 +1192,11 @@ void Application::execute_save(const std::string& params) {
 }
 
 void Application::execute_set(const std::string& params) {
-    ScopeMutex lock(&draw_mtx);
-    ScreenWindow *sw = get_window_nolock(get_application_window());
     Params p;
     split(params, p, 2);
 
+    /* listeners of the configuration take the draw lock themselves */
+    std::string result("Insufficient parameters.");
     size_t sz = p.size();
     if (sz) {
         try {
@@ -915,17 +1214,111 @@ void Application::execute_set(const std::string& params) {
             }
 
             config.set_value(category, key, value);
-            print_line(sw, get_now(), p[0] + "="  + value, fmt.fmt_info_normal);
+            result = p[0] + "=" + value;
         } catch (const Exception& e) {
-            print_line(sw, get_now(), e.what(), fmt.fmt_info_normal);
+            result = e.what();
         }
-    } else {
-        print_line(sw, get_now(), "Insufficient parameters.", fmt.fmt_info_normal);
     }
+
+    ScopeMutex lock(&draw_mtx);
+    ScreenWindow *sw = get_window_nolock(get_application_window());
+    print_line(sw, get_now(), result, fmt.fmt_info_normal);
     text_widget.refresh(sw);
     set_cursor();
 }
 
+void Application::SettingsListener::configuration_changed(const std::string& category, const std::string& key, const std::string& value) {
+    app.setting_changed(category, key, value);
+}
+
+void Application::setting_changed(const std::string& category, const std::string& key, const std::string& value) {
+    if (!category.length() && key == "script") {
+        /* the listener runs on the main loop, like the reload */
+        if (value != script_file) {
+            watch_script(value);
+            script_reload_pending = true;
+        }
+    } else if (!category.length() && key == "highlight_regex") {
+        try {
+            Highlighter::check_regex(value);
+        } catch (const HighlighterException& e) {
+            print(get_window(get_application_window()), e.what());
+        }
+    } else if (!category.length() && key == "metrics_socket") {
+        /* the exporter is told first and keeps, why it failed */
+        std::string metrics_error = get_metrics_error();
+        if (metrics_error.length()) {
+            print(get_window(get_application_window()), metrics_error);
+        }
+    } else if (!category.length() && key == "window_max_entries") {
+        /* apply a lowered limit now, not with the next line */
+        ScopeMutex lock(&draw_mtx);
+        for (ScreenWindow::List::iterator it = windows.begin(); it != windows.end(); it++) {
+            (*it)->cleanup();
+        }
+        if (selected_window) {
+            text_widget.refresh(selected_window);
+            set_cursor();
+        }
+    }
+}
+
+void Application::file_changed(const std::string& filename) {
+    /* called on the watcher thread */
+    if (filename == config.get_filename()) {
+        config_reload_pending = true;
+    } else {
+        script_reload_pending = true;
+    }
+}
+
+void Application::start_file_watcher() {
+    try {
+        file_watcher.watch(config.get_filename());
+        if (script_file.length()) {
+            file_watcher.watch(script_file);
+        }
+        file_watcher.start();
+    } catch (const FileWatcherException& e) {
+        print(get_window(get_application_window()), "Hot reload is disabled: " + std::string(e.what()));
+    }
+}
+
+void Application::watch_script(const std::string& filename) {
+    if (script_file.length()) {
+        file_watcher.unwatch(script_file);
+    }
+    script_file = filename;
+    if (script_file.length()) {
+        try {
+            file_watcher.watch(script_file);
+        } catch (const FileWatcherException& e) {
+            print(get_window(get_application_window()), e.what());
+        }
+    }
+}
+
+void Application::reload_config() {
+    ScreenWindow *sw = get_window(get_application_window());
+    try {
+        /* only changed keys are applied, the listeners do the rest. */
+        /* saving our own configuration triggers this too.           */
+        if (config.reload()) {
+            print(sw, "Configuration reloaded.");
+        }
+    } catch (const Exception& e) {
+        /* a listener may fail, too */
+        print(sw, "Configuration not reloaded: " + std::string(e.what()));
+    }
+}
+
+void Application::reload_script() {
+    /* a fresh state, globals of the old script are gone */
+    LuaEvent evt(LuaEvent::TypeReload, 0, 0);
+    evt.a = script_file;
+    lua_executor.post(evt);
+}
+
 void Application::execute_get(const std::string& params) {
     ScopeMutex lock(&draw_mtx);
     ScreenWindow *sw = get_window_nolock(get_application_window());
@@ -987,15 +1380,133 @@ void Application::execute_netsplits(const std::string& params) {
     set_cursor();
 }
 
-void Application::execute_lua(const std::string& params) {
+void Application::execute_search(const std::string& params) {
+    ScopeMutex lock(&draw_mtx);
+    ScreenWindow *sw = get_window_nolock(get_application_window());
+    std::string timestamp(get_now());
     try {
-        lua.script(params);
-    } catch (const sol::error& e) {
-        lua_error(e);
+        search_nolock(params, search_hits);
+        char buffer[32];
+        size_t sz = search_hits.size();
+        for (size_t i = 0; i < sz; i++) {
+            const ScreenWindow::Hit& hit = search_hits[i];
+            sprintf(buffer, "[%d] ", static_cast<int>(i + 1));
+            print_line(sw, timestamp, buffer + hit.window + ": " + hit.text, fmt.fmt_info_normal);
+        }
+        sprintf(buffer, "%d", static_cast<int>(sz));
+        print_line(sw, timestamp, "--- " + std::string(buffer) + " hits, use /jump <nr> ---", fmt.fmt_info_normal);
+    } catch (const Exception& e) {
+        print_line(sw, timestamp, e.what(), fmt.fmt_info_normal);
+    }
+    text_widget.refresh(sw);
+    set_cursor();
+}
+
+void Application::execute_jump(const std::string& params) {
+    try {
+        int nbr = atoi(params.c_str());
+        ScreenWindow::Hit hit;
+        {
+            ScopeMutex lock(&draw_mtx);
+            if (nbr < 1 || nbr > static_cast<int>(search_hits.size())) {
+                throw ApplicationException("No such search hit.");
+            }
+            hit = search_hits[nbr - 1];
+        }
+        jump_to_hit(hit);
+    } catch (const Exception& e) {
+        ScopeMutex lock(&draw_mtx);
+        ScreenWindow *sw = get_window_nolock(get_application_window());
+        print_line(sw, get_now(), e.what(), fmt.fmt_info_normal);
+        text_widget.refresh(sw);
     }
     set_cursor();
 }
 
+void Application::execute_stats(const std::string& params) {
+    /* with parameters, it is the stats query of the irc server */
+    if (params.length()) {
+        Session *s = selected_window->get_circada_session();
+        ScopeMutex lock(&draw_mtx);
+        try {
+            if (!s) {
+                throw ApplicationException("Change into a running connection.");
+            }
+            s->send("STATS " + params);
+        } catch (const Exception& e) {
+            print_line(selected_window, get_now(), e.what(), fmt.fmt_info_normal);
+            text_widget.refresh(selected_window);
+        }
+        set_cursor();
+        return;
+    }
+
+    ScopeMutex lock(&draw_mtx);
+    ScreenWindow *sw = get_window_nolock(get_application_window());
+    std::string timestamp(get_now());
+    long now = get_monotonic_us();
+    double elapsed = (now - stats_time) / 1e6;
+    stats_time = now;
+
+    char buffer[256];
+    const Metrics::Entries& entries = get_metrics().get_entries();
+    for (Metrics::Entries::const_iterator it = entries.begin(); it != entries.end(); it++) {
+        const Metrics::Entry& e = *it;
+        std::string line = e.name.substr(e.name.compare(0, 8, "circada_") ? 0 : 8);
+        if (e.labels.length()) {
+            line += "{" + e.labels + "}";
+        }
+        switch (e.type) {
+            case MetricTypeCounter:
+            {
+                u64 value = e.counter->get();
+                u64& last = stats_values[e.name + e.labels];
+                snprintf(buffer, sizeof(buffer), ": %llu (%.1f/s)", static_cast<unsigned long long>(value),
+                    (elapsed > 0 ? (value - last) / elapsed : 0));
+                last = value;
+                break;
+            }
+
+            case MetricTypeGauge:
+                snprintf(buffer, sizeof(buffer), ": %lld", static_cast<long long>(e.gauge->get()));
+                break;
+
+            case MetricTypeHistogram:
+            {
+                u64 count = e.histogram->get_count();
+                snprintf(buffer, sizeof(buffer), ": %llu, avg %.3f ms, p50 <= %.3f ms, p99 <= %.3f ms",
+                    static_cast<unsigned long long>(count), (count ? e.histogram->get_sum() / 1000.0 / count : 0),
+                    e.histogram->get_quantile(0.5) / 1000.0, e.histogram->get_quantile(0.99) / 1000.0);
+                break;
+            }
+        }
+        print_line(sw, timestamp, line + buffer, fmt.fmt_info_normal);
+    }
+    print_line(sw, timestamp, "--- end of stats ---", fmt.fmt_info_normal);
+    text_widget.refresh(sw);
+    set_cursor();
+}
+
+void Application::execute_lua(const std::string& params) {
+    /* "stats" alone is no valid lua statement */
+    Params p;
+    split(params, p);
+    if (p.size() && p.size() <= 2 && p[0] == "stats") {
+        LuaEvent evt(LuaEvent::TypeStats, 0, 0);
+        if (p.size() > 1) {
+            evt.a = p[1];
+        }
+        lua_executor.post(evt);
+        set_cursor();
+        return;
+    }
+
+    LuaEvent evt(LuaEvent::TypeExecute, 0, 0);
+    evt.a = params;
+    lua_executor.post(evt);
+    set_cursor();
+}
+
 void Application::print_line(ScreenWindow *w, const std::string& timestamp, const std::string& what, Format& format) {
     std::string line;
     std::string temp;
@@ -1140,160 +1651,810 @@ std::string Application::make_tree_nr(ScreenWindow::List::iterator& it) {
 
 /* ---------------------------------------------------------------------------------- */
 
-Session *Application::lua_find_session_throw(Session *s) {
-    if (!find_session(s)) {
+void Application::lua_cmd_raw(const LuaSession& s, const std::string& params) {
+    /* only queued, the sender thread of the session writes it */
+    if (!send_to_session(s.id, params)) {
         throw sol::error("Session not found");
     }
-
-    return s;
-}
-
-void Application::lua_cmd_raw(Session *s, const std::string& params) {
-    lua_find_session_throw(s)->send(params);
 }
 
-void Application::lua_cmd_join(Session *s, const std::string& params) {
+void Application::lua_cmd_join(const LuaSession& s, const std::string& params) {
     lua_cmd_raw(s, "JOIN " + params);
 }
 
-void Application::lua_cmd_part(Session *s, const std::string& params) {
+void Application::lua_cmd_part(const LuaSession& s, const std::string& params) {
     lua_cmd_raw(s, "PART " + params);
 }
 
-void Application::lua_cmd_privmsg(Session *s, const std::string& dest, const std::string& msg) {
+void Application::lua_cmd_privmsg(const LuaSession& s, const std::string& dest, const std::string& msg) {
     lua_cmd_raw(s, "PRIVMSG " + dest + " :" + msg);
 }
 
-void Application::lua_cmd_notice(Session *s, const std::string& dest, const std::string& msg) {
+void Application::lua_cmd_notice(const LuaSession& s, const std::string& dest, const std::string& msg) {
     lua_cmd_raw(s, "NOTICE " + dest + " :" + msg);
 }
 
-void Application::lua_cmd_me(Session *s, const std::string& dest, const std::string& msg) {
+void Application::lua_cmd_me(const LuaSession& s, const std::string& dest, const std::string& msg) {
     lua_cmd_raw(s, "PRIVMSG " + dest + " :\x01" + "ACTION " + msg + "\x01");
 }
 
-void Application::lua_cmd_mode(Session *s, const std::string& dest, const std::string& params) {
+void Application::lua_cmd_mode(const LuaSession& s, const std::string& dest, const std::string& params) {
     lua_cmd_raw(s, "MODE " + dest + " " + params);
 }
 
 /* ---------------------------------------------------------------------------------- */
 
-sol::table Application::make_table_from_message(const Message& msg) {
-    sol::table t = lua.create_table("Message");
-
-    t["timestamp"] = msg.timestamp;
-    t["line"] = msg.line;
-    t["nick_with_prefix"] = msg.nick_with_prefix;
-    t["user_and_host"] = msg.user_and_host;
-    t["user"] = msg.user;
-    t["host"] = msg.host;
-    t["command"] = msg.command;
-    t["ctcp"] = msg.ctcp;
-    t["op_notices"] = msg.op_notices;
-
-    return t;
-}
-
 void Application::lua_on_connection_lost(Session *s, const std::string& reason) {
-    try {
-        lua["on_connection_lost"](s, reason);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeConnectionLost)) {
+        return;
     }
+
+    LuaEvent evt(LuaEvent::TypeConnectionLost, s, 0);
+    evt.a = reason;
+    lua_executor.post(evt);
 }
 
 void Application::lua_on_message_arrived(Session *s, Window *w, const Message& msg) {
-    try {
-        lua["on_message_arrived"](s, w, msg);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeMessageArrived)) {
+        return;
     }
+
+    LuaEvent evt(LuaEvent::TypeMessageArrived, s, w);
+    evt.msg = std::make_shared<Message>(msg);
+    lua_executor.post(evt);
 }
 
 void Application::lua_on_my_mode_changed(Session *s, const std::string& mode) {
-    try {
-        lua["on_my_mode_changed"](s, mode);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeMyModeChanged)) {
+        return;
     }
+
+    LuaEvent evt(LuaEvent::TypeMyModeChanged, s, 0);
+    evt.a = mode;
+    lua_executor.post(evt);
 }
 
 void Application::lua_on_window_opened(Session *s, Window *w) {
-    try {
-        lua["on_window_opened"](s, w);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeWindowOpened)) {
+        return;
     }
+
+    lua_executor.post(LuaEvent(LuaEvent::TypeWindowOpened, s, w));
 }
 
 void Application::lua_on_window_closing(Session *s, Window *w) {
-    try {
-        lua["on_window_closing"](s, w);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeWindowClosing)) {
+        return;
     }
+
+    /* the window is gone, when the hook runs. keep its name. */
+    LuaEvent evt(LuaEvent::TypeWindowClosing, s, w);
+    evt.a = w->get_name();
+    lua_executor.post(evt);
 }
 
 void Application::lua_on_topic_changed(Session *s, Window *w, const std::string& topic) {
-    try {
-        lua["on_topic_changed"](s, w, topic);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeTopicChanged)) {
+        return;
     }
+
+    LuaEvent evt(LuaEvent::TypeTopicChanged, s, w);
+    evt.a = topic;
+    lua_executor.post(evt);
 }
 
 void Application::lua_on_name_changed(Session *s, Window *w, const std::string& old_name, const std::string& new_name) {
-    try {
-        lua["on_name_changed"](s, w, old_name, new_name);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeNameChanged)) {
+        return;
     }
+
+    LuaEvent evt(LuaEvent::TypeNameChanged, s, w);
+    evt.a = old_name;
+    evt.b = new_name;
+    lua_executor.post(evt);
 }
 
 void Application::lua_on_channel_mode_changed(Session *s, Window *w, const std::string& mode) {
-    try {
-        lua["on_channel_mode_changed"](s, w, mode);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeChannelModeChanged)) {
+        return;
     }
+
+    LuaEvent evt(LuaEvent::TypeChannelModeChanged, s, w);
+    evt.a = mode;
+    lua_executor.post(evt);
 }
 
 void Application::lua_on_new_nicklist(Session *s, Window *w) {
-    try {
-        lua["on_new_nicklist"](s, w);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeNewNicklist)) {
+        return;
     }
+
+    lua_executor.post(LuaEvent(LuaEvent::TypeNewNicklist, s, w));
 }
 
 void Application::lua_on_nick_added(Session *s, Window *w, const std::string& nick) {
-    try {
-        lua["on_nick_added"](s, w, nick);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeNickAdded)) {
+        return;
     }
+
+    LuaEvent evt(LuaEvent::TypeNickAdded, s, w);
+    evt.a = nick;
+    lua_executor.post(evt);
 }
 
 void Application::lua_on_nick_removed(Session *s, Window *w, const std::string& nick) {
-    try {
-        lua["on_nick_removed"](s, w, nick);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeNickRemoved)) {
+        return;
     }
+
+    LuaEvent evt(LuaEvent::TypeNickRemoved, s, w);
+    evt.a = nick;
+    lua_executor.post(evt);
 }
 
 void Application::lua_on_nick_changed(Session *s, Window *w, const std::string& old_nick, const std::string& new_nick) {
-    try {
-        lua["on_nick_changed"](s, w, old_nick, new_nick);
-    } catch (const sol::error& e)  {
-        lua_error(e);
+    if (!lua_is_hooked(LuaEvent::TypeNickChanged)) {
+        return;
     }
+
+    LuaEvent evt(LuaEvent::TypeNickChanged, s, w);
+    evt.a = old_nick;
+    evt.b = new_nick;
+    lua_executor.post(evt);
 }
 
 /* ---------------------------------------------------------------------------------- */
 
+bool Application::lua_is_hooked(LuaEvent::Type type) const {
+    return (lua_hooked.load(std::memory_order_relaxed) & (1UL << type)) != 0;
+}
+
+void Application::lua_dispatch(LuaEvent::List& events) {
+    size_t sz = events.size();
+    std::vector<bool> valid(sz, false);
+    size_t run_start = 0;
+
+    for (size_t i = 0; i < sz; i++) {
+        LuaEvent& evt = events[i];
+        valid[i] = lua_check_event(evt);
+        if (valid[i]) {
+            lua_dispatch_event(evt);
+        }
+
+        /* batch subscribers get a run of messages at its end */
+        if (evt.type == LuaEvent::TypeMessageArrived) {
+            if (i == 0 || events[i - 1].type != LuaEvent::TypeMessageArrived) {
+                run_start = i;
+            }
+            if (i + 1 == sz || events[i + 1].type != LuaEvent::TypeMessageArrived) {
+                lua_dispatch_messages(events, valid, run_start, i + 1);
+            }
+        }
+
+        if (lua_subscriptions_dirty) {
+            lua_cleanup_subscriptions();
+        }
+    }
+}
+
+void Application::lua_dispatch_event(LuaEvent& evt) {
+    switch (evt.type) {
+        case LuaEvent::TypeLoad:
+        case LuaEvent::TypeReload:
+        case LuaEvent::TypeExecute:
+            lua_begin_call(lua_get_profile(evt.type == LuaEvent::TypeExecute ? "/lua" : "script"));
+            try {
+                if (evt.type == LuaEvent::TypeReload) {
+                    lua_clear_subscriptions();
+                    lua_clear_timers();
+                    lua = lua_create_state();
+                    lua_setup();
+                }
+                if (evt.type == LuaEvent::TypeExecute) {
+                    lua.script(evt.a);
+                } else if (evt.a.length()) {
+                    lua.safe_script_file(evt.a);
+                }
+                lua_end_call();
+            } catch (const sol::error& e) {
+                lua_end_call();
+                lua_error(e);
+            }
+            lua_bind_legacy_hooks();
+            if (evt.type == LuaEvent::TypeReload) {
+                lua_print("Script reloaded.");
+            }
+            break;
+
+        case LuaEvent::TypeStats:
+            lua_print_stats(evt.a == "reset");
+            break;
+
+        default:
+        {
+            if (evt.type == LuaEvent::TypeMessageArrived && lua_waiters.size()) {
+                lua_resume_waiters(evt);
+            }
+
+            /* subscriptions made meanwhile wait for the next event */
+            LuaSubscriptions& subs = lua_subscriptions[evt.type];
+            size_t sz = subs.size();
+            for (size_t i = 0; i < sz; i++) {
+                LuaSubscription *sub = subs[i];
+                if (sub->active && sub->filter.matches(evt)) {
+                    lua_begin_call(sub->profile);
+                    sol::protected_function_result result = lua_call_hook(sub->fn, evt);
+                    lua_end_call();
+                    lua_check_result(result);
+                }
+            }
+            break;
+        }
+    }
+}
+
+void Application::lua_dispatch_messages(LuaEvent::List& events, const std::vector<bool>& valid, size_t from, size_t to) {
+    LuaSubscriptions& subs = lua_subscriptions[LuaEvent::TypeMessages];
+    size_t sz = subs.size();
+    for (size_t i = 0; i < sz; i++) {
+        LuaSubscription *sub = subs[i];
+        if (!sub->active) {
+            continue;
+        }
+        sol::table list;
+        int n = 0;
+        for (size_t j = from; j < to; j++) {
+            const LuaEvent& evt = events[j];
+            if (valid[j] && sub->filter.matches(evt)) {
+                if (!n) {
+                    list = lua.create_table();
+                }
+                list[++n] = lua.create_table_with("session", lua_session_object(evt.s), "window", lua_window_object(evt.w),
+                    "message", LuaMessage(evt.msg));
+            }
+        }
+        if (n) {
+            lua_begin_call(sub->profile);
+            sol::protected_function_result result = sub->fn(list);
+            lua_end_call();
+            lua_check_result(result);
+        }
+    }
+}
+
+sol::protected_function_result Application::lua_call_hook(sol::main_protected_function& fn, const LuaEvent& evt) {
+    switch (evt.type) {
+        case LuaEvent::TypeConnectionLost:
+        case LuaEvent::TypeMyModeChanged:
+            return fn(lua_session_object(evt.s), evt.a);
+
+        case LuaEvent::TypeMessageArrived:
+            return fn(lua_session_object(evt.s), lua_window_object(evt.w), LuaMessage(evt.msg));
+
+        case LuaEvent::TypeWindowClosing:
+        case LuaEvent::TypeTopicChanged:
+        case LuaEvent::TypeChannelModeChanged:
+        case LuaEvent::TypeNickAdded:
+        case LuaEvent::TypeNickRemoved:
+            return fn(lua_session_object(evt.s), lua_window_object(evt.w), evt.a);
+
+        case LuaEvent::TypeNameChanged:
+        case LuaEvent::TypeNickChanged:
+            return fn(lua_session_object(evt.s), lua_window_object(evt.w), evt.a, evt.b);
+
+        default:
+            return fn(lua_session_object(evt.s), lua_window_object(evt.w));
+    }
+}
+
+sol::object Application::lua_session_object(const LuaSession& s) {
+    if (!s.id) {
+        return sol::make_object(lua, sol::lua_nil);
+    }
+
+    return sol::make_object(lua, s);
+}
+
+sol::object Application::lua_window_object(const LuaWindow& w) {
+    if (!w.id) {
+        return sol::make_object(lua, sol::lua_nil);
+    }
+
+    return sol::make_object(lua, w);
+}
+
+void Application::lua_check_result(const sol::protected_function_result& result) {
+    if (!result.valid()) {
+        sol::error e = result;
+        lua_error(e);
+    }
+}
+
+bool Application::lua_check_event(LuaEvent& evt) {
+    /* a live window implies a live session. a new session is */
+    /* not listed yet, while its first window opens.          */
+    if (evt.w.id && is_window_listed(evt.w.id)) {
+        return true;
+    }
+    evt.w = LuaWindow();
+
+    /* drop events of closed sessions, but tell about closing windows */
+    if (evt.s.id && !is_session_listed(evt.s.id)) {
+        if (evt.type != LuaEvent::TypeWindowClosing) {
+            return false;
+        }
+        evt.s = LuaSession();
+    }
+
+    return true;
+}
+
+void Application::lua_get_commands(const sol::object& obj, LuaFilter::Commands& commands) {
+    /* numerics may be given as numbers */
+    switch (obj.get_type()) {
+        case sol::type::number:
+        {
+            char buffer[16];
+            snprintf(buffer, sizeof(buffer), "%03d", obj.as<int>());
+            commands.push_back(buffer);
+            break;
+        }
+
+        case sol::type::string:
+            commands.push_back(obj.as<std::string>());
+            break;
+
+        case sol::type::table:
+        {
+            sol::table t = obj.as<sol::table>();
+            for (size_t i = 1; i <= t.size(); i++) {
+                lua_get_commands(t[i], commands);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+int Application::lua_subscribe(const std::string& event, sol::main_protected_function fn, sol::optional<sol::table> filter, bool legacy) {
+    const LuaHook *hook = 0;
+    for (size_t i = 0; i < LuaHookCount; i++) {
+        if (event == LuaHooks[i].event) {
+            hook = &LuaHooks[i];
+            break;
+        }
+    }
+    if (!hook) {
+        throw sol::error("Unknown event: " + event);
+    }
+
+    LuaSubscription *sub = new LuaSubscription;
+    if (filter) {
+        sol::table& t = *filter;
+        lua_get_commands(t["command"], sub->filter.commands);
+        sub->filter.window_type = t.get_or("window_type", -1);
+        sub->filter.nick = t.get_or<std::string>("nick", "");
+        sol::object session = t["session"];
+        if (session.is<LuaSession>()) {
+            sub->filter.session_id = session.as<LuaSession&>().id;
+        }
+    }
+    sub->id = ++lua_subscription_id;
+    sub->legacy = legacy;
+    sub->fn = fn;
+    sub->profile = lua_get_profile(legacy ? std::string(hook->legacy) : event + " " + lua_get_location(sub->fn));
+    lua_subscriptions[hook->type].push_back(sub);
+    lua_subscriptions_dirty = true;
+
+    return sub->id;
+}
+
+bool Application::lua_unsubscribe(int id) {
+    for (size_t i = 0; i <= LuaEvent::TypeMessages; i++) {
+        LuaSubscriptions& subs = lua_subscriptions[i];
+        for (LuaSubscriptions::iterator it = subs.begin(); it != subs.end(); it++) {
+            LuaSubscription *sub = *it;
+            if (sub->id == id && sub->active) {
+                sub->active = false;
+                lua_subscriptions_dirty = true;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void Application::lua_bind_legacy_hooks() {
+    /* global on_... functions are subscriptions without a filter */
+    for (size_t i = 0; i <= LuaEvent::TypeMessages; i++) {
+        LuaSubscriptions& subs = lua_subscriptions[i];
+        for (LuaSubscriptions::iterator it = subs.begin(); it != subs.end(); it++) {
+            if ((*it)->legacy) {
+                (*it)->active = false;
+            }
+        }
+    }
+
+    /* on_messages takes the messages instead of on_message_arrived */
+    bool batched = (lua["on_messages"].get_type() == sol::type::function);
+    for (size_t i = 0; i < LuaHookCount; i++) {
+        const LuaHook& hook = LuaHooks[i];
+        if (hook.type == LuaEvent::TypeMessageArrived && batched) {
+            continue;
+        }
+        sol::object fn = lua[hook.legacy];
+        if (fn.get_type() == sol::type::function) {
+            lua_subscribe(hook.event, fn.as<sol::main_protected_function>(), sol::nullopt, true);
+        }
+    }
+    lua_cleanup_subscriptions();
+}
+
+void Application::lua_clear_subscriptions() {
+    for (size_t i = 0; i <= LuaEvent::TypeMessages; i++) {
+        LuaSubscriptions& subs = lua_subscriptions[i];
+        for (LuaSubscriptions::iterator it = subs.begin(); it != subs.end(); it++) {
+            delete *it;
+        }
+        subs.clear();
+    }
+    lua_subscriptions_dirty = false;
+    lua_update_hooked();
+}
+
+void Application::lua_cleanup_subscriptions() {
+    for (size_t i = 0; i <= LuaEvent::TypeMessages; i++) {
+        LuaSubscriptions& subs = lua_subscriptions[i];
+        LuaSubscriptions::iterator it = subs.begin();
+        while (it != subs.end()) {
+            if (!(*it)->active) {
+                delete *it;
+                it = subs.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+    lua_subscriptions_dirty = false;
+    lua_update_hooked();
+}
+
+void Application::lua_update_hooked() {
+    unsigned long hooked = 0;
+    for (size_t i = 0; i <= LuaEvent::TypeMessages; i++) {
+        if (lua_subscriptions[i].size()) {
+            hooked |= 1UL << i;
+        }
+    }
+
+    /* batch subscribers and waiting coroutines need the single messages */
+    if ((hooked & (1UL << LuaEvent::TypeMessages)) || lua_waiters.size()) {
+        hooked |= 1UL << LuaEvent::TypeMessageArrived;
+    }
+    lua_hooked = hooked;
+}
+
+TimerWheel::Id Application::lua_add_timer(long delay, long interval, sol::main_protected_function fn) {
+    if (delay < 0 || interval < 0) {
+        throw sol::error("Invalid delay.");
+    }
+
+    TimerWheel::Id id = lua_executor.add_timer(delay);
+    LuaTimer& timer = lua_timers[id];
+    timer.interval = interval;
+    timer.fn = fn;
+    timer.profile = lua_get_profile((interval ? "every " : "after ") + lua_get_location(timer.fn));
+
+    return id;
+}
+
+bool Application::lua_cancel_timer(TimerWheel::Id id) {
+    LuaTimers::iterator it = lua_timers.find(id);
+    if (it == lua_timers.end()) {
+        return false;
+    }
+    lua_executor.cancel_timer(id);
+    lua_timers.erase(it);
+
+    return true;
+}
+
+void Application::lua_timers_expired(const TimerWheel::Ids& ids) {
+    for (TimerWheel::Ids::const_iterator it = ids.begin(); it != ids.end(); it++) {
+        TimerWheel::Id id = *it;
+        LuaTimers::iterator tit = lua_timers.find(id);
+        if (tit != lua_timers.end()) {
+            /* the callback may cancel its own timer */
+            sol::main_protected_function fn = tit->second.fn;
+            long interval = tit->second.interval;
+            LuaProfile *profile = tit->second.profile;
+            if (interval) {
+                lua_executor.rearm_timer(id, interval);
+            } else {
+                lua_timers.erase(tit);
+            }
+            lua_begin_call(profile);
+            sol::protected_function_result result = fn();
+            lua_end_call();
+            if (!result.valid()) {
+                /* a failing repetition would flood the window */
+                lua_cancel_timer(id);
+                lua_check_result(result);
+            }
+            continue;
+        }
+
+        LuaWaiters::iterator wit = lua_waiters.find(id);
+        if (wit != lua_waiters.end()) {
+            LuaWaiter waiter = wit->second;
+            lua_waiters.erase(wit);
+            lua_update_hooked();
+            lua_resume_waiter(waiter, MessagePtr());
+        }
+    }
+
+    if (lua_subscriptions_dirty) {
+        lua_cleanup_subscriptions();
+    }
+}
+
+void Application::lua_clear_timers() {
+    for (LuaWaiters::iterator it = lua_waiters.begin(); it != lua_waiters.end(); it++) {
+        luaL_unref(lua.lua_state(), LUA_REGISTRYINDEX, it->second.ref);
+    }
+    lua_waiters.clear();
+    lua_timers.clear();
+    lua_executor.clear_timers();
+    lua_update_hooked();
+}
+
+void Application::lua_await_reply(lua_State *thread, const LuaSession& s, const sol::object& replies, long timeout) {
+    if (!lua_isyieldable(thread)) {
+        throw sol::error("await_reply must run in a coroutine, see async.");
+    }
+    if (timeout <= 0) {
+        throw sol::error("Invalid timeout.");
+    }
+
+    LuaWaiter waiter;
+    waiter.thread = thread;
+    waiter.profile = lua_get_profile("await_reply " + lua_get_location(thread, 2));
+    waiter.filter.session_id = s.id;
+    lua_get_commands(replies, waiter.filter.commands);
+    if (waiter.filter.commands.empty()) {
+        throw sol::error("No replies to wait for.");
+    }
+
+    /* keep the coroutine alive, until it is resumed */
+    lua_pushthread(thread);
+    waiter.ref = luaL_ref(thread, LUA_REGISTRYINDEX);
+    lua_waiters[lua_executor.add_timer(timeout)] = waiter;
+    lua_update_hooked();
+}
+
+void Application::lua_resume_waiters(const LuaEvent& evt) {
+    std::vector<LuaWaiter> ready;
+    LuaWaiters::iterator it = lua_waiters.begin();
+    while (it != lua_waiters.end()) {
+        if (it->second.filter.matches(evt)) {
+            ready.push_back(it->second);
+            lua_executor.cancel_timer(it->first);
+            lua_waiters.erase(it++);
+        } else {
+            it++;
+        }
+    }
+
+    if (ready.size()) {
+        lua_update_hooked();
+        for (std::vector<LuaWaiter>::iterator it = ready.begin(); it != ready.end(); it++) {
+            lua_resume_waiter(*it, evt.msg);
+        }
+    }
+}
+
+void Application::lua_resume_waiter(const LuaWaiter& waiter, const MessagePtr& msg) {
+    /* await_reply returns the message or nil after the timeout */
+    lua_State *thread = waiter.thread;
+    push_lua_message(thread, LuaMessage(msg));
+
+    int results = 0;
+    lua_begin_call(waiter.profile);
+    int rv = compat_lua_resume(thread, lua.lua_state(), 1, &results);
+    lua_end_call();
+    if (rv == LUA_OK || rv == LUA_YIELD) {
+        lua_pop(thread, results);
+    } else {
+        const char *err = lua_tostring(thread, -1);
+        lua_error(err ? err : "Coroutine failed.");
+        lua_pop(thread, 1);
+    }
+    luaL_unref(lua.lua_state(), LUA_REGISTRYINDEX, waiter.ref);
+}
+
+Application::LuaProfile *Application::lua_get_profile(const std::string& name) {
+    /* profiles are never erased, the pointers stay valid */
+    return &lua_profiles[name];
+}
+
+std::string Application::lua_get_location(sol::main_protected_function& fn) {
+    lua_State *L = lua.lua_state();
+    lua_Debug ar;
+    fn.push(L);
+    lua_getinfo(L, ">S", &ar);
+
+    return format_location(ar.short_src, ar.linedefined);
+}
+
+std::string Application::lua_get_location(lua_State *thread, int level) {
+    lua_Debug ar;
+    if (!lua_getstack(thread, level, &ar)) {
+        return "?";
+    }
+    lua_getinfo(thread, "Sl", &ar);
+
+    return format_location(ar.short_src, ar.currentline);
+}
+
+void Application::lua_update_budget_hook() {
+    /* a count hook slows down every instruction, so it is */
+    /* only installed, while a budget is set. coroutines   */
+    /* take the hook, that is set when they are created.   */
+    bool budget = (lua_budget_ms.get() > 0 || lua_budget_instructions.get() > 0);
+    if (budget != lua_budget_hooked) {
+        if (budget) {
+            lua_sethook(lua.lua_state(), &Application::lua_budget_hook, LUA_MASKCOUNT, LuaHookInterval);
+        } else {
+            lua_sethook(lua.lua_state(), 0, 0, 0);
+        }
+#ifdef LUAJIT_VERSION
+        /* compiled code never calls the hook */
+        luaJIT_setmode(lua.lua_state(), 0, LUAJIT_MODE_ENGINE | (budget ? LUAJIT_MODE_OFF : LUAJIT_MODE_ON));
+#endif
+        lua_budget_hooked = budget;
+    }
+}
+
+void Application::lua_begin_call(LuaProfile *profile) {
+    lua_update_budget_hook();
+    lua_profile = profile;
+    lua_call_instructions = 0;
+    lua_call_allocations = lua_allocations;
+    lua_call_aborted = false;
+    lua_call_started = get_monotonic_us();
+}
+
+void Application::lua_end_call() {
+    u64 elapsed = static_cast<u64>(get_monotonic_us() - lua_call_started);
+    LuaProfile *profile = lua_profile;
+    lua_profile = 0;
+    lua_call_time.observe(elapsed);
+    if (lua_call_aborted) {
+        lua_aborted_calls.add(1);
+    }
+    if (profile) {
+        profile->calls++;
+        profile->total += elapsed;
+        if (elapsed > profile->max) {
+            profile->max = elapsed;
+        }
+        profile->instructions += lua_call_instructions;
+        profile->allocations += lua_allocations - lua_call_allocations;
+        if (lua_call_aborted) {
+            profile->aborted++;
+        }
+    }
+}
+
+void Application::lua_print_stats(bool reset) {
+    if (reset) {
+        for (LuaProfiles::iterator it = lua_profiles.begin(); it != lua_profiles.end(); it++) {
+            it->second = LuaProfile();
+        }
+        lua_print("Lua statistics reset.");
+        return;
+    }
+
+    /* the most expensive first */
+    typedef std::vector<LuaProfiles::const_iterator> Sorted;
+    Sorted sorted;
+    for (LuaProfiles::const_iterator it = lua_profiles.begin(); it != lua_profiles.end(); it++) {
+        if (it->second.calls) {
+            sorted.push_back(it);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](LuaProfiles::const_iterator a, LuaProfiles::const_iterator b) {
+        return a->second.total > b->second.total;
+    });
+
+    if (sorted.empty()) {
+        lua_print("No lua calls yet.");
+        return;
+    }
+
+    char buffer[512];
+    for (Sorted::const_iterator it = sorted.begin(); it != sorted.end(); it++) {
+        const LuaProfile& p = (*it)->second;
+        std::string line = (*it)->first;
+        snprintf(buffer, sizeof(buffer), ": %llu calls, %.3f ms total, %.3f ms max",
+            static_cast<unsigned long long>(p.calls), p.total / 1000.0, p.max / 1000.0);
+        line += buffer;
+#ifndef LUAJIT_VERSION
+        snprintf(buffer, sizeof(buffer), ", %llu allocations", static_cast<unsigned long long>(p.allocations));
+        line += buffer;
+#endif
+
+        /* instructions are only counted, while a budget is set */
+        if (p.instructions) {
+            snprintf(buffer, sizeof(buffer), ", %lluk instructions", static_cast<unsigned long long>(p.instructions / 1000));
+            line += buffer;
+        }
+        if (p.aborted) {
+            snprintf(buffer, sizeof(buffer), ", %llu aborted", static_cast<unsigned long long>(p.aborted));
+            line += buffer;
+        }
+        lua_print(line.c_str());
+    }
+}
+
+sol::state Application::lua_create_state() {
+#ifdef LUAJIT_VERSION
+    /* luajit's own allocator is faster and the only one, that every */
+    /* build accepts. allocations are not counted then.               */
+    return sol::state();
+#else
+    return sol::state(sol::default_at_panic, &Application::lua_allocate, this);
+#endif
+}
+
+void *Application::lua_allocate(void *ud, void *ptr, size_t osize, size_t nsize) {
+    if (!nsize) {
+        free(ptr);
+        return 0;
+    }
+    if (!ptr) {
+        static_cast<Application *>(ud)->lua_allocations++;
+    }
+
+    return realloc(ptr, nsize);
+}
+
+void Application::lua_budget_hook(lua_State *L, lua_Debug *ar) {
+    lua_getfield(L, LUA_REGISTRYINDEX, LuaRegistryApplication);
+    Application *app = static_cast<Application *>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+    app->lua_call_instructions += LuaHookInterval;
+
+    /* raised again on every check, so pcall cannot keep it running */
+    int budget_ms = app->lua_budget_ms.get();
+    u64 budget_instructions = app->lua_budget_instructions.get();
+    bool exceeded = (budget_instructions && app->lua_call_instructions > budget_instructions);
+    if (!exceeded && budget_ms > 0) {
+        exceeded = (get_monotonic_us() - app->lua_call_started > static_cast<long>(budget_ms) * 1000);
+    }
+    if (exceeded) {
+        app->lua_call_aborted = true;
+        luaL_error(L, "Lua budget exceeded, the call was aborted.");
+    }
+}
+
 void Application::lua_setup() {
-    lua.open_libraries(sol::lib::base, sol::lib::package, sol::lib::string, sol::lib::utf8, sol::lib::table, sol::lib::math);
+    lua_pushlightuserdata(lua.lua_state(), this);
+    lua_setfield(lua.lua_state(), LUA_REGISTRYINDEX, LuaRegistryApplication);
+
+    /* sol skips ffi and jit, unless it runs on luajit */
+    lua.open_libraries(sol::lib::base, sol::lib::package, sol::lib::coroutine, sol::lib::string, sol::lib::utf8, sol::lib::table, sol::lib::math,
+        sol::lib::ffi, sol::lib::jit);
+#ifdef LUAJIT_VERSION
+    lua["ffi"]["cdef"](LuaFFIDeclarations);
+#endif
+
+    /* after the jit library, which turns the compiler on */
+    lua_budget_hooked = false;
+    lua_update_budget_hook();
 
     // setup functions
     lua["__prn"] = [&](const std::string& s) {
@@ -1303,13 +2464,66 @@ void Application::lua_setup() {
         window_action(0, w);
     };
 
-    lua["raw"]          = [&](Session *s, const std::string& a) { lua_cmd_raw(s, a); };
-    lua["join"]         = [&](Session *s, const std::string& a) { lua_cmd_join(s, a); };
-    lua["part"]         = [&](Session *s, const std::string& a) { lua_cmd_part(s, a); };
-    lua["msg"]          = [&](Session *s, const std::string& a, const std::string& b) { lua_cmd_privmsg(s, a, b); };
-    lua["notice"]       = [&](Session *s, const std::string& a, const std::string& b) { lua_cmd_notice(s, a, b); };
-    lua["me"]           = [&](Session *s, const std::string& a, const std::string& b) { lua_cmd_me(s, a, b); };
-    lua["mode"]         = [&](Session *s, const std::string& a, const std::string& b) { lua_cmd_mode(s, a, b); };
+    lua["raw"]          = [&](const LuaSession& s, const std::string& a) { lua_cmd_raw(s, a); };
+    lua["join"]         = [&](const LuaSession& s, const std::string& a) { lua_cmd_join(s, a); };
+    lua["part"]         = [&](const LuaSession& s, const std::string& a) { lua_cmd_part(s, a); };
+    lua["msg"]          = [&](const LuaSession& s, const std::string& a, const std::string& b) { lua_cmd_privmsg(s, a, b); };
+    lua["notice"]       = [&](const LuaSession& s, const std::string& a, const std::string& b) { lua_cmd_notice(s, a, b); };
+    lua["me"]           = [&](const LuaSession& s, const std::string& a, const std::string& b) { lua_cmd_me(s, a, b); };
+    lua["mode"]         = [&](const LuaSession& s, const std::string& a, const std::string& b) { lua_cmd_mode(s, a, b); };
+
+    lua["subscribe"] = [&](const std::string& event, sol::main_protected_function fn, sol::optional<sol::table> filter) {
+        return lua_subscribe(event, fn, filter, false);
+    };
+    lua["unsubscribe"] = [&](int id) { return lua_unsubscribe(id); };
+
+    lua["after"]  = [&](long ms, sol::main_protected_function fn) { return lua_add_timer(ms, 0, fn); };
+    lua["every"]  = [&](long ms, sol::main_protected_function fn) {
+        if (ms <= 0) {
+            throw sol::error("Invalid interval.");
+        }
+        return lua_add_timer(ms, ms, fn);
+    };
+    lua["cancel"] = [&](TimerWheel::Id id) { return lua_cancel_timer(id); };
+
+    lua["__await_reply"] = [&](sol::this_state ts, const LuaSession& s, sol::object replies, long timeout) {
+        lua_await_reply(ts, s, replies, timeout);
+    };
+
+    lua["dcc_set_limit"] = [&](const std::string& scope, u64 rate) {
+        DCCLimitScope limit_scope;
+        if (!parse_limit_scope(scope, limit_scope)) {
+            throw sol::error("Unknown limit scope: " + scope);
+        }
+        dcc_set_limit(limit_scope, rate);
+    };
+
+    lua["dcc_get_limit"] = [&](const std::string& scope) {
+        DCCLimitScope limit_scope;
+        if (!parse_limit_scope(scope, limit_scope)) {
+            throw sol::error("Unknown limit scope: " + scope);
+        }
+        return dcc_get_limit(limit_scope);
+    };
+
+    lua["search"] = [&](const std::string& query) {
+        ScreenWindow::Hits hits;
+        try {
+            ScopeMutex lock(&draw_mtx);
+            search_nolock(query, hits);
+        } catch (const Exception& e) {
+            throw sol::error(e.what());
+        }
+        return sol::as_table(std::move(hits));
+    };
+
+    lua["jump"] = [&](const ScreenWindow::Hit& hit) {
+        try {
+            jump_to_hit(hit);
+        } catch (const Exception& e) {
+            throw sol::error(e.what());
+        }
+    };
 
     // override print(...)
     lua.script(R"(
@@ -1321,41 +2535,53 @@ void Application::lua_setup() {
             end
             __prn(s)
         end
+
+        function async(fn, ...)
+            local co = coroutine.create(fn)
+            local ok, err = coroutine.resume(co, ...)
+            if not ok then
+                error(err, 0)
+            end
+        end
+
+        function await_reply(session, replies, timeout)
+            __await_reply(session, replies, timeout)
+            return coroutine.yield()
+        end
     )");
 
     // register types
-    lua.new_usertype<Message>("Message", sol::no_constructor,
-        "timestamp",        sol::readonly(&Message::timestamp),
-        "line",             sol::readonly(&Message::line),
-        "nick_with_prefix", sol::readonly(&Message::nick_with_prefix),
-        "user_and_host",    sol::readonly(&Message::user_and_host),
-        "user",             sol::readonly(&Message::user),
-        "host",             sol::readonly(&Message::host),
-        "command",          sol::readonly(&Message::command),
-        "ctcp",             sol::readonly(&Message::ctcp),
-        "op_notices",       sol::readonly(&Message::op_notices)
-    );
-
-    lua.new_usertype<Session>("Session", sol::no_constructor,
-        "is_that_me",       &Session::is_that_me,
-        "is_channel",       &Session::is_channel,
-        "get_flags",        &Session::get_flags,
-        "get_nick",         &Session::get_nick,
-        "get_server",       &Session::get_server,
-        "am_i_away",        &Session::am_i_away,
-        "get_nicklen",      &Session::get_nicklen,
-        "get_lag",          &Session::get_lag
+    register_lua_message(lua.lua_state());
+
+    lua.new_usertype<LuaSession>("Session", sol::no_constructor,
+        "is_that_me",       &LuaSession::is_that_me,
+        "is_channel",       &LuaSession::is_channel,
+        "get_flags",        [](const LuaSession& s) { return s.flags; },
+        "get_nick",         [](const LuaSession& s) { return s.nick; },
+        "get_server",       [](const LuaSession& s) { return s.server; },
+        "am_i_away",        [](const LuaSession& s) { return s.away; },
+        "get_nicklen",      [](const LuaSession& s) { return s.nicklen; },
+        "get_lag",          [](const LuaSession& s) { return s.lag; }
     );
 
     lua.new_enum("WindowType", "APPLICATION", 0, "SERVER", 1, "CHANNEL", 2, "PRIVATE", 3, "DCC", 4, "ALERTS", 5);
     lua.new_enum("WindowAction", "NONE", 0, "NOISE", 1, "CHAT", 2, "ALERT", 3);
 
-    lua.new_usertype<Window>("Window", sol::no_constructor,
-        "get_window_type",  &Window::get_window_type,
-        "get_name",         &Window::get_name,
-        "get_topic",        &Window::get_topic,
-        "get_flags",        &Window::get_flags,
-        "get_action",       &Window::get_action
+    lua.new_usertype<LuaWindow>("Window", sol::no_constructor,
+        "get_window_type",  [](const LuaWindow& w) { return w.window_type; },
+        "get_name",         [](const LuaWindow& w) { return w.name; },
+        "get_topic",        [](const LuaWindow& w) { return w.topic; },
+        "get_flags",        [](const LuaWindow& w) { return w.flags; },
+        "get_action",       [](const LuaWindow& w) { return w.action; },
+        "pointer",          [](LuaWindow& w) { return static_cast<void *>(&w); }
+    );
+
+    lua.new_usertype<ScreenWindow::Hit>("SearchHit", sol::no_constructor,
+        "window",           sol::readonly(&ScreenWindow::Hit::window),
+        "sequence",         sol::readonly(&ScreenWindow::Hit::sequence),
+        "when",             sol::readonly(&ScreenWindow::Hit::when),
+        "nick",             sol::readonly(&ScreenWindow::Hit::nick),
+        "text",             sol::readonly(&ScreenWindow::Hit::text)
     );
 }
 
@@ -416,6 +416,11 @@ void Application::dcc_xfer_ended(Window *w, const DCCXferHandle dcc) {
     fmt.append_format(dcc.get_filename(), fmt.fmt_dcc_bold, info);
     fmt.append_format(" successfully transferred.", fmt.fmt_dcc, info);
 
+    char buffer[32];
+    sprintf(buffer, "%08x", dcc.get_checksum());
+    fmt.append_format(" CRC32C ", fmt.fmt_dcc, info);
+    fmt.append_format(buffer, fmt.fmt_dcc_bold, info);
+
     print_line(sw, get_now(), info);
 
     text_widget.refresh(sw);
@@ -454,7 +459,8 @@ void Application::dcc_send_progress(Window *w, const DCCXferHandle dcc) {
         ScopeMutex lock(&draw_mtx);
         char buffer[128];
         ScreenWindow *sw = get_window_nolock(w);
-        sprintf(buffer, "%d/%d", dcc.get_transferred_bytes(), dcc.get_filesize());
+        sprintf(buffer, "%llu/%llu", static_cast<unsigned long long>(dcc.get_transferred_bytes()),
+            static_cast<unsigned long long>(dcc.get_filesize()));
         std::string info("Sending " + dcc.get_filename() +", ");
         info += buffer;
         print_line(sw, get_now(), info, fmt.fmt_dcc_info);
@@ -468,7 +474,8 @@ void Application::dcc_receive_progress(Window *w, const DCCXferHandle dcc) {
         ScopeMutex lock(&draw_mtx);
         char buffer[128];
         ScreenWindow *sw = get_window_nolock(w);
-        sprintf(buffer, "%d/%d", dcc.get_transferred_bytes(), dcc.get_filesize());
+        sprintf(buffer, "%llu/%llu", static_cast<unsigned long long>(dcc.get_transferred_bytes()),
+            static_cast<unsigned long long>(dcc.get_filesize()));
         std::string info("Receiving " + dcc.get_filename() +", ");
         info += buffer;
         print_line(sw, get_now(), info, fmt.fmt_dcc_info);
@@ -19,17 +19,96 @@
  */
 
 #include "Application.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+
+const long NicklistFrameInterval = 40; /* ms */
 
 ScreenWindow *Application::create_window(Session *s, Window *w) {
     ScopeMutex lock(&draw_mtx);
     ScreenWindow *sw = new ScreenWindow(config, window_sequence++, s, w);
     windows.push_back(sw);
+    if (s && config.is_true(config.get_value("", "log", "0"))) {
+        open_log_nolock(sw);
+    }
     //std::sort(windows.begin(), windows.end(), ScreenWindowComparer());
     update_input_infobar();
 
     return sw;
 }
 
+void Application::open_log_nolock(ScreenWindow *sw) {
+    Session *s = sw->get_circada_session();
+    Window *w = sw->get_circada_window();
+    switch (w->get_window_type()) {
+        case WindowTypeServer:
+        case WindowTypeChannel:
+        case WindowTypePrivate:
+            break;
+
+        default:
+            return;
+    }
+
+    /* <working directory>/logs/<server>/<window>.log */
+    std::string server = s->get_server();
+    std::string name = w->get_name();
+    to_lower(server);
+    to_lower(name);
+    std::replace(server.begin(), server.end(), '/', '_');
+    std::replace(name.begin(), name.end(), '/', '_');
+    try {
+        std::string directory = config.get_working_directory() + "/logs";
+        create_directory(directory);
+        directory += "/" + server;
+        create_directory(directory);
+        sw->set_log(get_log_nolock(directory + "/" + name + ".log"));
+        sw->load_history(atoi(config.get_value("", "log_replay", "100").c_str()));
+    } catch (const Exception& e) {
+        ScreenWindow *aw = get_window_nolock(get_application_window());
+        if (aw) {
+            print_line(aw, get_now(), e.what(), fmt.fmt_info_normal);
+        }
+    }
+}
+
+ScreenWindow::LogPtr Application::get_log_nolock(const std::string& filename) {
+    /* forget the logs of closed windows */
+    Logs::iterator it = logs.begin();
+    while (it != logs.end()) {
+        if (it->second.expired()) {
+            logs.erase(it++);
+        } else {
+            it++;
+        }
+    }
+
+    ScreenWindow::LogPtr log = logs[filename].lock();
+    if (!log) {
+        log = std::make_shared<LogStore>(filename);
+        logs[filename] = log;
+    }
+
+    return log;
+}
+
+void Application::flush_logs() {
+    ScopeMutex lock(&draw_mtx);
+    for (ScreenWindow::List::iterator it = windows.begin(); it != windows.end(); it++) {
+        ScreenWindow *sw = *it;
+        try {
+            sw->flush_log();
+        } catch (const Exception& e) {
+            sw->set_log(ScreenWindow::LogPtr());
+            ScreenWindow *aw = get_window_nolock(get_application_window());
+            if (aw) {
+                print_line(aw, get_now(), e.what(), fmt.fmt_info_normal);
+            }
+        }
+    }
+}
+
 ScreenWindow *Application::get_server_window(Session *s) {
     ScopeMutex lock(&draw_mtx);
     return get_server_window_nolock(s);
@@ -62,6 +141,28 @@ ScreenWindow *Application::get_window_nolock(Window *w) {
     return 0;
 }
 
+ScreenWindow *Application::get_window_by_sequence_nolock(int sequence) {
+    for (ScreenWindow::List::iterator it = windows.begin(); it != windows.end(); it++) {
+        ScreenWindow *sw = *it;
+        if (sw->get_sequence() == sequence) {
+            return sw;
+        }
+    }
+
+    return 0;
+}
+
+bool Application::is_window_listed(unsigned long id) {
+    ScopeMutex lock(&draw_mtx);
+    for (ScreenWindow::List::iterator it = windows.begin(); it != windows.end(); it++) {
+        if ((*it)->get_circada_window()->get_id() == id) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void Application::destroy_window(Window *w) {
     ScopeMutex lock(&draw_mtx);
     for (ScreenWindow::List::iterator it = windows.begin(); it != windows.end(); it++) {
@@ -159,14 +260,39 @@ void Application::changes_in_nicklist(Window *w) {
     ScreenWindow *sw = get_window_nolock(w);
     if (sw && sw == selected_window) {
         if (w->get_window_type() == WindowTypeChannel) {
-            status_widget.set_nick_count(w->get_nicks().size());
-            status_widget.draw();
-            nicklist_widget.draw(sw);
-            set_cursor();
+            /* joins, parts and netsplits come in bursts, repaint at most
+             * once per frame. the timer draws what is left at the end. */
+            nicklist_dirty = true;
+            flush_nicklist_nolock(false);
+            if (nicklist_dirty) {
+                nicklist_timer.arm(NicklistFrameInterval - (get_monotonic_ms() - nicklist_drawn_at));
+            }
+        }
+    }
+}
+
+void Application::flush_nicklist_nolock(bool force) {
+    if (nicklist_dirty && selected_window) {
+        long now = get_monotonic_ms();
+        if (force || now - nicklist_drawn_at >= NicklistFrameInterval) {
+            nicklist_dirty = false;
+            nicklist_drawn_at = now;
+            Window *w = selected_window->get_circada_window();
+            if (w && w->get_window_type() == WindowTypeChannel) {
+                status_widget.set_nick_count(w->get_nicks().size());
+                status_widget.draw();
+                nicklist_widget.draw(selected_window);
+                set_cursor();
+            }
         }
     }
 }
 
+void Application::repaint_timer_expired() {
+    ScopeMutex lock(&draw_mtx);
+    flush_nicklist_nolock(true);
+}
+
 void Application::select_window(ScreenWindow *w) {
     if (selected_window != w) {
         {
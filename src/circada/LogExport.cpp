@@ -0,0 +1,65 @@
+/*
+ *  LogExport.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* circada-logexport: prints a binary window log as plain text.
+ * usage: circada-logexport <logfile> [<since unix time>]
+ */
+
+#include "SearchIndex.hpp"
+
+#include <Circada/LogStore.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <logfile> [<since unix time>]\n", argv[0]);
+        return 1;
+    }
+
+    try {
+        Circada::LogStore log(argv[1], true);
+        size_t nbr = (argc > 2 ? log.find(atol(argv[2])) : 0);
+        size_t sz = log.get_record_count();
+        Circada::LogRecords records;
+        char date[32];
+        while (nbr < sz) {
+            records.clear();
+            size_t read = log.get_records(nbr, 1024, records);
+            if (!read) {
+                break;
+            }
+            for (Circada::LogRecords::iterator it = records.begin(); it != records.end(); it++) {
+                struct tm tm;
+                localtime_r(&it->when, &tm);
+                strftime(date, sizeof(date), "%Y-%m-%d", &tm);
+                printf("%s %s\n", date, SearchIndex::get_plaintext(it->text).c_str());
+            }
+            nbr += read;
+        }
+    } catch (const Circada::Exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ *  LuaExecutor.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LuaExecutor.hpp"
+#include "Utils.hpp"
+
+#include <fnmatch.h>
+
+LuaExecutor::LuaExecutor(LuaEventHandler& handler)
+    : handler(handler), running(false), started(false) { }
+
+LuaExecutor::~LuaExecutor() {
+    stop();
+}
+
+void LuaExecutor::start() {
+    if (!started) {
+        running = true;
+        if (!thread_start()) {
+            running = false;
+            throw LuaExecutorException("Starting lua executor failed.");
+        }
+        started = true;
+    }
+}
+
+void LuaExecutor::stop() {
+    if (started) {
+        {
+            ScopeMutex lock(&mtx);
+            running = false;
+        }
+        io_sync_signal_event();
+        thread_join();
+        started = false;
+    }
+}
+
+void LuaExecutor::post(const LuaEvent& evt) {
+    ScopeMutex lock(&mtx);
+    queue.push_back(evt);
+
+    /* one signal per batch, the thread takes the whole queue */
+    if (queue.size() == 1) {
+        io_sync_signal_event();
+    }
+}
+
+TimerWheel::Id LuaExecutor::add_timer(long delay) {
+    return timers.add(get_monotonic_ms(), delay);
+}
+
+void LuaExecutor::rearm_timer(TimerWheel::Id id, long delay) {
+    timers.rearm(id, get_monotonic_ms(), delay);
+}
+
+bool LuaExecutor::cancel_timer(TimerWheel::Id id) {
+    return timers.cancel(id);
+}
+
+void LuaExecutor::clear_timers() {
+    timers.clear();
+}
+
+void LuaExecutor::thread() {
+    LuaEvent::List events;
+    TimerWheel::Ids expired;
+
+    while (true) {
+        try {
+            io_sync_wait_for_event(static_cast<int>(timers.get_timeout(get_monotonic_ms())));
+        } catch (const IOSyncException&) {
+            break;
+        }
+
+        {
+            ScopeMutex lock(&mtx);
+            if (!running) {
+                break;
+            }
+            events.swap(queue);
+        }
+
+        if (events.size()) {
+            handler.lua_dispatch(events);
+            events.clear();
+        }
+
+        timers.advance(get_monotonic_ms(), expired);
+        if (expired.size()) {
+            handler.lua_timers_expired(expired);
+            expired.clear();
+        }
+    }
+}
+
+LuaSession::LuaSession(Session *s)
+    : id(s->get_id()), server(s->get_server()), nick(s->get_nick()), flags(s->get_flags()),
+      channel_prefixes(s->get_channel_prefixes()), away(s->am_i_away()), nicklen(s->get_nicklen()),
+      lag(s->get_lag()) { }
+
+bool LuaSession::is_that_me(const std::string& nick) const {
+    return is_equal(this->nick, nick);
+}
+
+bool LuaSession::is_channel(const std::string& name) const {
+    return (name.length() && channel_prefixes.find(name[0]) != std::string::npos);
+}
+
+LuaWindow::LuaWindow(Window *w)
+    : id(w->get_id()), window_type(w->get_window_type()), name(w->get_name()), topic(w->get_topic()),
+      flags(w->get_flags()), action(w->get_action()) { }
+
+bool LuaFilter::matches(const LuaEvent& evt) const {
+    if (session_id && evt.s.id != session_id) {
+        return false;
+    }
+
+    if (window_type >= 0 && (!evt.w.id || evt.w.window_type != window_type)) {
+        return false;
+    }
+
+    if (commands.size()) {
+        if (evt.type != LuaEvent::TypeMessageArrived) {
+            return false;
+        }
+        bool found = false;
+        for (Commands::const_iterator it = commands.begin(); it != commands.end(); it++) {
+            if (is_equal(*it, evt.msg->command)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+
+    if (nick.length()) {
+        const std::string *evt_nick = 0;
+        switch (evt.type) {
+            case LuaEvent::TypeMessageArrived:
+                evt_nick = &evt.msg->nick;
+                break;
+
+            case LuaEvent::TypeNickAdded:
+            case LuaEvent::TypeNickRemoved:
+            case LuaEvent::TypeNickChanged:
+                evt_nick = &evt.a;
+                break;
+
+            default:
+                break;
+        }
+        if (!evt_nick || fnmatch(nick.c_str(), evt_nick->c_str(), FNM_CASEFOLD)) {
+            return false;
+        }
+    }
+
+    return true;
+}
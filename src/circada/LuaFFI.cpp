@@ -0,0 +1,88 @@
+/*
+ *  LuaFFI.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LuaFFI.hpp"
+#include "LuaMessage.hpp"
+
+const char *LuaFFIDeclarations =
+    "typedef struct circada_message circada_message;\n"
+    "typedef struct circada_window circada_window;\n"
+    "enum {\n"
+    "    CIRCADA_TIMESTAMP = 1, CIRCADA_LINE, CIRCADA_NICK, CIRCADA_NICK_WITH_PREFIX,\n"
+    "    CIRCADA_USER_AND_HOST, CIRCADA_USER, CIRCADA_HOST, CIRCADA_COMMAND,\n"
+    "    CIRCADA_CTCP, CIRCADA_OP_NOTICES\n"
+    "};\n"
+    "const char *circada_message_field(const circada_message *msg, int field, size_t *len);\n"
+    "int circada_message_param_count(const circada_message *msg);\n"
+    "const char *circada_message_param(const circada_message *msg, int i, size_t *len);\n"
+    "int circada_window_type(const circada_window *w);\n"
+    "const char *circada_window_name(const circada_window *w, size_t *len);\n"
+    "const char *circada_window_topic(const circada_window *w, size_t *len);\n";
+
+namespace {
+
+    const char *to_ffi(const std::string& s, size_t *len) {
+        if (len) {
+            *len = s.length();
+        }
+
+        return s.c_str();
+    }
+
+}
+
+const char *circada_message_field(const Message *msg, int field, size_t *len) {
+    const std::string *value = get_lua_message_field(*msg, field);
+    if (!value) {
+        if (len) {
+            *len = 0;
+        }
+        return 0;
+    }
+
+    return to_ffi(*value, len);
+}
+
+int circada_message_param_count(const Message *msg) {
+    return static_cast<int>(msg->params.size());
+}
+
+const char *circada_message_param(const Message *msg, int i, size_t *len) {
+    if (i < 1 || i > static_cast<int>(msg->params.size())) {
+        if (len) {
+            *len = 0;
+        }
+        return 0;
+    }
+
+    return to_ffi(msg->params[i - 1], len);
+}
+
+int circada_window_type(const LuaWindow *w) {
+    return static_cast<int>(w->window_type);
+}
+
+const char *circada_window_name(const LuaWindow *w, size_t *len) {
+    return to_ffi(w->name, len);
+}
+
+const char *circada_window_topic(const LuaWindow *w, size_t *len) {
+    return to_ffi(w->topic, len);
+}
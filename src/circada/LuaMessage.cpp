@@ -0,0 +1,169 @@
+/*
+ *  LuaMessage.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LuaMessage.hpp"
+
+#include <new>
+
+namespace {
+
+    const char *LuaMessageMetatable = "Message";
+
+    /* the order is part of the ffi api, see LuaFFI.cpp */
+    struct Field {
+        const char *name;
+        const std::string Message::*member;
+    };
+
+    const Field Fields[] = {
+        { "timestamp",          &Message::timestamp },
+        { "line",               &Message::line },
+        { "nick",               &Message::nick },
+        { "nick_with_prefix",   &Message::nick_with_prefix },
+        { "user_and_host",      &Message::user_and_host },
+        { "user",               &Message::user },
+        { "host",               &Message::host },
+        { "command",            &Message::command },
+        { "ctcp",               &Message::ctcp },
+        { "op_notices",         &Message::op_notices }
+    };
+
+    const int FieldCount = sizeof(Fields) / sizeof(Field);
+
+    /* user value slots: one per field, then the params table */
+    const int ParamsSlot = FieldCount + 1;
+
+    const Message& check_message(lua_State *L) {
+        return *static_cast<LuaMessage *>(luaL_checkudata(L, 1, LuaMessageMetatable))->msg;
+    }
+
+    int message_param(lua_State *L) {
+        const Message& msg = check_message(L);
+        lua_Integer i = luaL_checkinteger(L, 2);
+        if (i < 1 || i > static_cast<lua_Integer>(msg.params.size())) {
+            lua_pushnil(L);
+        } else {
+            const std::string& param = msg.params[i - 1];
+            lua_pushlstring(L, param.data(), param.length());
+        }
+
+        return 1;
+    }
+
+    int message_pointer(lua_State *L) {
+        lua_pushlightuserdata(L, const_cast<Message *>(&check_message(L)));
+
+        return 1;
+    }
+
+    int message_index(lua_State *L) {
+        const Message& msg = check_message(L);
+
+        /* the upvalue maps names to slots or methods */
+        lua_pushvalue(L, 2);
+        lua_rawget(L, lua_upvalueindex(1));
+        if (lua_type(L, -1) != LUA_TNUMBER) {
+            return 1;
+        }
+        int slot = static_cast<int>(lua_tointeger(L, -1));
+        lua_pop(L, 1);
+
+        if (compat_lua_getuservalue(L, 1, slot) != LUA_TNIL) {
+            return 1;
+        }
+        lua_pop(L, 1);
+
+        if (slot == ParamsSlot) {
+            size_t sz = msg.params.size();
+            lua_createtable(L, static_cast<int>(sz), 0);
+            for (size_t i = 0; i < sz; i++) {
+                lua_pushlstring(L, msg.params[i].data(), msg.params[i].length());
+                lua_rawseti(L, -2, static_cast<int>(i + 1));
+            }
+        } else {
+            const std::string& value = msg.*Fields[slot - 1].member;
+            lua_pushlstring(L, value.data(), value.length());
+        }
+        lua_pushvalue(L, -1);
+        compat_lua_setuservalue(L, 1, slot);
+
+        return 1;
+    }
+
+    int message_tostring(lua_State *L) {
+        const std::string& line = check_message(L).line;
+        lua_pushlstring(L, line.data(), line.length());
+
+        return 1;
+    }
+
+    int message_gc(lua_State *L) {
+        static_cast<LuaMessage *>(luaL_checkudata(L, 1, LuaMessageMetatable))->~LuaMessage();
+
+        return 0;
+    }
+
+}
+
+void register_lua_message(lua_State *L) {
+    luaL_newmetatable(L, LuaMessageMetatable);
+
+    lua_createtable(L, 0, FieldCount + 3);
+    for (int i = 0; i < FieldCount; i++) {
+        lua_pushinteger(L, i + 1);
+        lua_setfield(L, -2, Fields[i].name);
+    }
+    lua_pushinteger(L, ParamsSlot);
+    lua_setfield(L, -2, "params");
+    lua_pushcfunction(L, message_param);
+    lua_setfield(L, -2, "param");
+    lua_pushcfunction(L, message_pointer);
+    lua_setfield(L, -2, "pointer");
+    lua_pushcclosure(L, message_index, 1);
+    lua_setfield(L, -2, "__index");
+
+    lua_pushcfunction(L, message_tostring);
+    lua_setfield(L, -2, "__tostring");
+    lua_pushcfunction(L, message_gc);
+    lua_setfield(L, -2, "__gc");
+
+    lua_pop(L, 1);
+}
+
+int push_lua_message(lua_State *L, const LuaMessage& msg) {
+    if (!msg.msg) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    void *mem = compat_lua_newuserdata(L, sizeof(LuaMessage), ParamsSlot);
+    new (mem) LuaMessage(msg);
+    luaL_setmetatable(L, LuaMessageMetatable);
+
+    return 1;
+}
+
+const std::string *get_lua_message_field(const Message& msg, int field) {
+    if (field < 1 || field > FieldCount) {
+        return 0;
+    }
+
+    return &(msg.*Fields[field - 1].member);
+}
@@ -24,7 +24,8 @@
 #include <time.h>
 
 NicklistWidget::NicklistWidget()
-    : configured(false), current_window(0), nicklist_delimiter("│") { }
+    : configured(false), current_window(0), nicklist_delimiter("│"),
+      width(0), height(0), rows_valid(false) { }
 
 NicklistWidget::~NicklistWidget() {
     delete_ncurses_object();
@@ -37,6 +38,8 @@ void NicklistWidget::configure(int posy, int posx, int width, int height) {
     delete_ncurses_object();
     win_nicklist = newwin(height, width, posy, posx);
     scrollok(win_nicklist, FALSE);
+    configured = true;
+    rows_valid = false;
 }
 
 void NicklistWidget::draw(ScreenWindow *w) {
@@ -59,24 +62,52 @@ void NicklistWidget::draw(ScreenWindow *w) {
             w->nicklist_top = curpos;
         }
 
-        for (int y = 0; y < height; y++) {
-            wcolor_set(win_nicklist, Formatter::get_color_code(FormatterColorDarkWhite, FormatterColorDarkBlack), 0);
-            mvwaddstr(win_nicklist, y, 0, nicklist_delimiter.c_str());
-            if (w && list && curpos < sz) {
-                Circada::Nick& nick = (*list)[curpos];
-                std::string nick_with_symbol;
-                nick_with_symbol += nick.get_flag();
-                nick_with_symbol += nick.get_nick();
-                if (nick.get_flag() != ' ') {
-                    wcolor_set(win_nicklist, Formatter::get_color_code(FormatterColorBrightYellow, FormatterColorDarkBlack), 0);
-                } else {
-                    wcolor_set(win_nicklist, Formatter::get_color_code(FormatterColorBrightWhite, FormatterColorDarkBlack), 0);
+        /* only the visible part of the list is materialized */
+        Rows new_rows(height);
+        for (int y = 0; y < height && list && curpos < sz; y++, curpos++) {
+            Circada::Nick& nick = (*list)[curpos];
+            new_rows[y] = Row(nick.get_flag(), nick.get_nick());
+        }
+
+        if (!rows_valid || static_cast<int>(rows.size()) != height) {
+            /* full repaint */
+            for (int y = 0; y < height; y++) {
+                draw_row(y, new_rows[y]);
+            }
+        } else {
+            /* find the first changed row */
+            int first = 0;
+            while (first < height && rows[first] == new_rows[first]) {
+                first++;
+            }
+            if (first == height) {
+                /* nothing changed */
+                return;
+            }
+
+            /* a single inserted or deleted nick shifts the rest of the list
+             * by one row. let ncurses move the lines instead of repainting. */
+            bool inserted = true;
+            bool deleted = true;
+            for (int y = first + 1; y < height && (inserted || deleted); y++) {
+                if (new_rows[y] != rows[y - 1]) inserted = false;
+                if (new_rows[y - 1] != rows[y]) deleted = false;
+            }
+
+            if (first < height - 1 && inserted) {
+                insert_row(first, new_rows[first]);
+            } else if (first < height - 1 && deleted) {
+                delete_row(first, new_rows[height - 1]);
+            } else {
+                for (int y = first; y < height; y++) {
+                    if (new_rows[y] != rows[y]) {
+                        draw_row(y, new_rows[y]);
+                    }
                 }
-                waddstr(win_nicklist, nick_with_symbol.c_str());
-                curpos++;
             }
-            wclrtoeol(win_nicklist);
         }
+        rows.swap(new_rows);
+        rows_valid = true;
         wrefresh(win_nicklist);
     }
 }
@@ -124,6 +155,7 @@ void NicklistWidget::set_nicklist_delimiter(const std::string& delimiter) {
 
 void NicklistWidget::select_window(ScreenWindow *w) {
     current_window = w;
+    rows_valid = false;
 }
 
 void NicklistWidget::delete_ncurses_object() {
@@ -133,3 +165,32 @@ void NicklistWidget::delete_ncurses_object() {
     }
 }
 
+
+void NicklistWidget::draw_row(int y, const Row& row) {
+    wcolor_set(win_nicklist, Formatter::get_color_code(FormatterColorDarkWhite, FormatterColorDarkBlack), 0);
+    mvwaddstr(win_nicklist, y, 0, nicklist_delimiter.c_str());
+    if (row.flag) {
+        if (row.flag != ' ') {
+            wcolor_set(win_nicklist, Formatter::get_color_code(FormatterColorBrightYellow, FormatterColorDarkBlack), 0);
+        } else {
+            wcolor_set(win_nicklist, Formatter::get_color_code(FormatterColorBrightWhite, FormatterColorDarkBlack), 0);
+        }
+        waddch(win_nicklist, row.flag);
+        waddstr(win_nicklist, row.nick.c_str());
+    }
+    wclrtoeol(win_nicklist);
+}
+
+void NicklistWidget::insert_row(int y, const Row& row) {
+    /* shifts all rows below y down, the last row falls out */
+    wmove(win_nicklist, y, 0);
+    winsdelln(win_nicklist, 1);
+    draw_row(y, row);
+}
+
+void NicklistWidget::delete_row(int y, const Row& last_row) {
+    /* shifts all rows below y up, the last row is new */
+    wmove(win_nicklist, y, 0);
+    winsdelln(win_nicklist, -1);
+    draw_row(height - 1, last_row);
+}
@@ -0,0 +1,101 @@
+/*
+ *  RepaintTimer.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RepaintTimer.hpp"
+#include "Utils.hpp"
+
+RepaintTimer::RepaintTimer(RepaintTimerHandler& handler)
+    : handler(handler), running(false), started(false), deadline(0) { }
+
+RepaintTimer::~RepaintTimer() {
+    stop();
+}
+
+void RepaintTimer::start() {
+    if (!started) {
+        running = true;
+        if (!thread_start()) {
+            running = false;
+            throw RepaintTimerException("Starting repaint timer failed.");
+        }
+        started = true;
+    }
+}
+
+void RepaintTimer::stop() {
+    if (started) {
+        {
+            ScopeMutex lock(&mtx);
+            running = false;
+        }
+        io_sync_signal_event();
+        thread_join();
+        started = false;
+    }
+}
+
+void RepaintTimer::arm(long delay) {
+    ScopeMutex lock(&mtx);
+    if (!deadline) {
+        deadline = get_monotonic_ms() + (delay > 0 ? delay : 0);
+        io_sync_signal_event();
+    }
+}
+
+void RepaintTimer::thread() {
+    while (true) {
+        long timeout = -1;
+        {
+            ScopeMutex lock(&mtx);
+            if (!running) {
+                break;
+            }
+            if (deadline) {
+                timeout = deadline - get_monotonic_ms();
+                if (timeout < 0) {
+                    timeout = 0;
+                }
+            }
+        }
+
+        try {
+            io_sync_wait_for_event(static_cast<int>(timeout));
+        } catch (const IOSyncException&) {
+            break;
+        }
+
+        bool expired = false;
+        {
+            ScopeMutex lock(&mtx);
+            if (!running) {
+                break;
+            }
+            if (deadline && get_monotonic_ms() >= deadline) {
+                deadline = 0;
+                expired = true;
+            }
+        }
+
+        /* outside the lock, the handler may arm again */
+        if (expired) {
+            handler.repaint_timer_expired();
+        }
+    }
+}
@@ -24,15 +24,22 @@
 #include <cstring>
 #include <algorithm>
 
+/* ids of live lines count up from here, ids of lines from the log down */
+static const SearchIndex::Id FirstLineId = 1UL << 30;
+
 template<class T> static bool erase_last_viewed(const T& elem) {
     return (elem.type == ScreenWindow::Line::TypeLastViewed);
 }
 
 ScreenWindow::ScreenWindow(Circada::Configuration& config, int sequence, Circada::Session *s, Circada::Window *w)
     : line_at_bottom(0), rows_in_last_line(0), following(true), nicklist_top(0),
-      sequence(sequence), config(config), session(s), window(w) { }
+      sequence(sequence), config(config), max_entries(config, "", "window_max_entries", "10000"),
+      session(s), window(w), next_id(FirstLineId),
+      prev_id(FirstLineId), log_first_record(0), logged_lines(0), history_lines(0) { }
 
-ScreenWindow::~ScreenWindow() { }
+ScreenWindow::~ScreenWindow() {
+    set_log(LogPtr());
+}
 
 Circada::Session *ScreenWindow::get_circada_session() {
     return session;
@@ -45,14 +52,12 @@ Circada::Window *ScreenWindow::get_circada_window() {
 const std::string& ScreenWindow::add_line(Formatter& fmt, const Circada::Message& m, const char *from) {
     std::string line;
     fmt.parse(m, line, from);
-    lines.push_back(Line(line));
-    cleanup();
+    append_line(Line(line, m.nick));
     return lines[lines.size() - 1].text;
 }
 
 void ScreenWindow::add_formatted_line(const std::string& line) {
-    lines.push_back(line);
-    cleanup();
+    append_line(Line(line));
 }
 
 void ScreenWindow::set_last_viewed(Formatter& fmt) {
@@ -66,8 +71,7 @@ void ScreenWindow::set_last_viewed(Formatter& fmt) {
     m.to_me = false;
     std::string line;
     fmt.parse(m, line, 0);
-    lines.push_back(Line(Line::TypeLastViewed, line));
-    cleanup();
+    append_line(Line(Line::TypeLastViewed, line));
 }
 
 ScreenWindow::Lines& ScreenWindow::get_lines() {
@@ -78,6 +82,132 @@ int ScreenWindow::get_sequence() {
     return sequence;
 }
 
+void ScreenWindow::search(const SearchIndex::Words& words, const std::string& nick, time_t since, size_t max_hits, Hits& hits) {
+    SearchIndex::Ids ids;
+    index.find(words, ids);
+
+    /* newest first */
+    size_t found = 0;
+    for (SearchIndex::Ids::reverse_iterator it = ids.rbegin(); it != ids.rend() && found < max_hits; it++) {
+        int i = get_line_index(*it);
+        if (i < 0) {
+            continue;
+        }
+        const Line& line = lines[i];
+        if (since && line.when < since) {
+            break;
+        }
+        if (nick.length() && !Circada::is_equal(line.nick, nick)) {
+            continue;
+        }
+        Hit hit;
+        hit.sequence = sequence;
+        hit.window = window->get_name();
+        hit.id = line.id;
+        hit.when = line.when;
+        hit.nick = line.nick;
+        hit.text = SearchIndex::get_plaintext(line.text);
+        hits.push_back(hit);
+        found++;
+    }
+}
+
+int ScreenWindow::get_line_index(SearchIndex::Id id) {
+    /* ids are ascending */
+    int lo = 0;
+    int hi = static_cast<int>(lines.size()) - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (lines[mid].id == id) {
+            return mid;
+        } else if (lines[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    return -1;
+}
+
+void ScreenWindow::set_log(const LogPtr& log) {
+    this->log = log;
+    logged_lines = 0;
+    history_lines = 0;
+}
+
+Circada::LogStore *ScreenWindow::get_log() {
+    return log.get();
+}
+
+void ScreenWindow::flush_log() {
+    if (log) {
+        log->flush();
+    }
+}
+
+int ScreenWindow::load_history(int max_lines) {
+    if (!log || max_lines <= 0) {
+        return 0;
+    }
+
+    if (!logged_lines) {
+        log_first_record = log->get_record_count();
+    }
+    size_t from = (log_first_record > static_cast<size_t>(max_lines) ? log_first_record - max_lines : 0);
+    Circada::LogRecords records;
+    try {
+        log->get_records(from, log_first_record - from, records);
+    } catch (const Circada::LogStoreException&) {
+        return 0;
+    }
+
+    int sz = records.size();
+    if (sz) {
+        Lines history;
+        history.reserve(sz);
+        SearchIndex::Id id = prev_id - sz;
+        for (Circada::LogRecords::iterator it = records.begin(); it != records.end(); it++) {
+            Line line(it->text, it->nick);
+            line.id = id++;
+            line.when = it->when;
+            index.add(line.id, line.text);
+            history.push_back(line);
+        }
+        prev_id -= sz;
+        lines.insert(lines.begin(), history.begin(), history.end());
+        log_first_record = from;
+        logged_lines += sz;
+        history_lines += sz;
+        line_at_bottom += sz;
+    }
+
+    return sz;
+}
+
+void ScreenWindow::append_line(const Line& line) {
+    lines.push_back(line);
+    Line& l = lines.back();
+    l.id = next_id++;
+    l.when = time(0);
+    if (l.type == Line::TypeRegular) {
+        index.add(l.id, l.text);
+        if (log) {
+            try {
+                if (!logged_lines) {
+                    log_first_record = log->get_record_count();
+                }
+                log->append(l.when, l.type, l.nick, l.text);
+                logged_lines++;
+            } catch (const Circada::LogStoreException&) {
+                /* stop logging in this window */
+                set_log(LogPtr());
+            }
+        }
+    }
+    cleanup();
+}
+
 bool ScreenWindowComparer::operator()(ScreenWindow* const& lhs, ScreenWindow* const& rhs) {
     if (lhs->get_circada_session() == rhs->get_circada_session()) {
         Circada::Window *lhs_w = lhs->get_circada_window();
@@ -91,11 +221,33 @@ bool ScreenWindowComparer::operator()(ScreenWindow* const& lhs, ScreenWindow* co
     return lhs->get_circada_session() < rhs->get_circada_session();
 }
 
+bool ScreenWindowHitComparer::operator()(const ScreenWindow::Hit& lhs, const ScreenWindow::Hit& rhs) {
+    return lhs.when > rhs.when;
+}
+
 void ScreenWindow::cleanup() {
-    int max_messages = atoi(config.get_value("", "window_max_entries", "10000").c_str());
+    int max_messages = max_entries.get();
     if (max_messages) {
-        while (static_cast<int>(lines.size()) > max_messages) {
-            lines.erase(lines.begin());
+        /* keep lines from the log, as long as the user scrolls back */
+        if (following) {
+            history_lines = 0;
+        }
+        max_messages += history_lines;
+        int excess = static_cast<int>(lines.size()) - max_messages;
+        if (excess > 0) {
+            /* a lowered limit may drop many lines, erase them at once */
+            for (int i = 0; i < excess; i++) {
+                const Line& l = lines[i];
+                if (l.type == Line::TypeRegular) {
+                    index.remove(l.id, l.text);
+                    if (logged_lines) {
+                        log_first_record++;
+                        logged_lines--;
+                    }
+                }
+            }
+            lines.erase(lines.begin(), lines.begin() + excess);
+            line_at_bottom = (line_at_bottom > excess ? line_at_bottom - excess : 0);
         }
     }
 }
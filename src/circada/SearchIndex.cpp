@@ -0,0 +1,181 @@
+/*
+ *  SearchIndex.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SearchIndex.hpp"
+#include "Formatter.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <queue>
+#include <functional>
+#include <cctype>
+
+static const size_t CompactThreshold = 64;
+
+SearchIndex::SearchIndex() { }
+
+SearchIndex::~SearchIndex() { }
+
+void SearchIndex::add(Id id, const std::string& formatted_text) {
+    Words words;
+    get_words(get_plaintext(formatted_text), words);
+    for (Words::iterator it = words.begin(); it != words.end(); it++) {
+        Postings& p = index[*it];
+        if (p.skip == p.ids.size() || p.ids.back() < id) {
+            p.ids.push_back(id);
+        } else {
+            /* older lines, eg. from a log */
+            p.ids.insert(std::lower_bound(p.ids.begin() + p.skip, p.ids.end(), id), id);
+        }
+    }
+}
+
+void SearchIndex::remove(Id id, const std::string& formatted_text) {
+    Words words;
+    get_words(get_plaintext(formatted_text), words);
+    for (Words::iterator it = words.begin(); it != words.end(); it++) {
+        Index::iterator iit = index.find(*it);
+        if (iit != index.end()) {
+            Postings& p = iit->second;
+            if (p.skip < p.ids.size() && p.ids[p.skip] == id) {
+                /* usual case, the oldest line is evicted */
+                p.skip++;
+            } else {
+                Ids::iterator pos = std::lower_bound(p.ids.begin() + p.skip, p.ids.end(), id);
+                if (pos != p.ids.end() && *pos == id) {
+                    p.ids.erase(pos);
+                }
+            }
+
+            if (p.skip == p.ids.size()) {
+                index.erase(iit);
+            } else if (p.skip > CompactThreshold && p.skip * 2 > p.ids.size()) {
+                p.ids.erase(p.ids.begin(), p.ids.begin() + p.skip);
+                p.skip = 0;
+            }
+        }
+    }
+}
+
+void SearchIndex::clear() {
+    index.clear();
+}
+
+void SearchIndex::find(const Words& query, Ids& ids) const {
+    ids.clear();
+    bool first = true;
+    for (Words::const_iterator it = query.begin(); it != query.end(); it++) {
+        Ids found;
+        find_prefix(*it, found);
+        if (first) {
+            ids.swap(found);
+            first = false;
+        } else {
+            Ids intersection;
+            std::set_intersection(ids.begin(), ids.end(), found.begin(), found.end(), std::back_inserter(intersection));
+            ids.swap(intersection);
+        }
+        if (!ids.size()) {
+            break;
+        }
+    }
+}
+
+void SearchIndex::find_prefix(const std::string& prefix, Ids& ids) const {
+    /* short prefixes match many words. their postings are merged in one
+     * pass over a heap, not by a set union per word. */
+    typedef std::pair<Ids::const_iterator, Ids::const_iterator> Range;
+    typedef std::pair<Id, size_t> Head;
+    std::vector<Range> ranges;
+    size_t total = 0;
+    for (Index::const_iterator it = index.lower_bound(prefix); it != index.end(); it++) {
+        if (it->first.compare(0, prefix.length(), prefix)) {
+            break;
+        }
+        const Postings& p = it->second;
+        ranges.push_back(Range(p.ids.begin() + p.skip, p.ids.end()));
+        total += p.ids.size() - p.skip;
+    }
+
+    ids.clear();
+    if (ranges.size() == 1) {
+        ids.assign(ranges[0].first, ranges[0].second);
+        return;
+    }
+
+    ids.reserve(total);
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heads;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        heads.push(Head(*ranges[i].first, i));
+    }
+    while (!heads.empty()) {
+        Head head = heads.top();
+        heads.pop();
+        if (!ids.size() || ids.back() != head.first) {
+            ids.push_back(head.first);
+        }
+        Range& range = ranges[head.second];
+        if (++range.first != range.second) {
+            heads.push(Head(*range.first, head.second));
+        }
+    }
+}
+
+void SearchIndex::get_words(const std::string& text, Words& words) {
+    /* words are separated by ascii punctuation and spaces,
+     * utf-8 sequences are part of words. */
+    std::string word;
+    size_t sz = text.length();
+    for (size_t i = 0; i <= sz; i++) {
+        unsigned char c = (i < sz ? text[i] : ' ');
+        if (c >= 0x80 || isalnum(c)) {
+            word += static_cast<char>(tolower(c));
+        } else if (word.length()) {
+            words.push_back(word);
+            word.clear();
+        }
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+}
+
+std::string SearchIndex::get_plaintext(const std::string& formatted_text) {
+    std::string text;
+    size_t sz = formatted_text.length();
+    text.reserve(sz);
+    for (size_t i = 0; i < sz; i++) {
+        char c = formatted_text[i];
+        if (c == Formatter::AttributeSwitch && i + 1 < sz) {
+            switch (formatted_text[++i]) {
+                case Formatter::AttributeFormat:
+                    i += sizeof(Formatter::Attribute);
+                    break;
+
+                case Formatter::AttributeRepeater:
+                    text += ' ';
+                    break;
+            }
+        } else {
+            text += c;
+        }
+    }
+
+    return text;
+}
@@ -22,6 +22,8 @@
 #include "UTF8.hpp"
 #include "Utils.hpp"
 
+const int HistoryChunk = 256;
+
 /* NOTICES:
  * this chunk of code is a quick-and-dirty hack. it works, but it isn't
  * clearly legible. sorry for that :)
@@ -30,7 +32,8 @@
 TextWidget::TextWidget(StatusWidget& status_widget)
     : configured(false), selected_window(0), startx(0),
       orig_width(0), orig_height(0), orig_posx(0), width(0), height(0),
-      curx(0), cury(0), first_line(true), status_widget(status_widget) { }
+      curx(0), cury(0), first_line(true), formats_valid(false), run_x(0),
+      status_widget(status_widget) { }
 
 TextWidget::~TextWidget() {
     void delete_ncurses_object();
@@ -46,6 +49,7 @@ void TextWidget::configure(int height, int width, int posx) {
     delete_ncurses_object();
     win_text = newwin(this->height, this->width, 1, posx);
     scrollok(win_text, FALSE);
+    formats_valid = false;
     configured = true;
 }
 
@@ -72,6 +76,10 @@ void TextWidget::draw() {
 }
 
 void TextWidget::scroll_up() {
+    /* near the top of the lines in memory, fetch older ones from the log */
+    if (selected_window->line_at_bottom < 2 * height) {
+        selected_window->load_history(HistoryChunk);
+    }
     top_down_draw(2 * height - 1);
 }
 
@@ -90,6 +98,22 @@ void TextWidget::scroll_down() {
     }
 }
 
+void TextWidget::show_line(int index) {
+    /* scrolls, so that the line is at the bottom */
+    ScreenWindow::Lines& lines = selected_window->get_lines();
+    int sz = lines.size();
+    if (index >= 0 && index < sz) {
+        int save_curx = curx;
+        int save_cury = cury;
+        curx = cury = 0;
+        selected_window->line_at_bottom = index;
+        selected_window->rows_in_last_line = draw_line(lines[index].text, true);
+        curx = save_curx;
+        cury = save_cury;
+        top_down_draw(height);
+    }
+}
+
 void TextWidget::top_down_draw(int max_lines) {
     ScreenWindow::Lines& lines = selected_window->get_lines();
 
@@ -125,9 +149,7 @@ bool TextWidget::draw_clipping(int from_index, int upmost_skip_rows, int how_man
 
     int save_curx, save_cury;
     curx = cury = 0;
-    for (int x = 0; x < width; x++) {
-        mvwaddch(win_text, cury, x, ' ');
-    }
+    draw_hline(cury, 0, ' ', width);
     first_line = true;
     if (from_index < sz) {
         int lines_drawn = draw_line(lines[from_index++].text, false, upmost_skip_rows + 1) - upmost_skip_rows;
@@ -158,9 +180,7 @@ bool TextWidget::draw_clipping(int from_index, int upmost_skip_rows, int how_man
     }
 
     for (int y = cury + 1; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            mvwaddch(win_text, y, x, ' ');
-        }
+        draw_hline(y, 0, ' ', width);
     }
 
     /* is there more text to show -> set following to false */
@@ -287,10 +307,10 @@ int TextWidget::draw_line(const std::string& line, bool test_only, int from_line
                 leftmost = curx + 1;
                 str_it++;
             } else if (c == Formatter::AttributeRepeater) {
-                if (!test_only) {
-                    while (curx < width - 1) {
-                        mvwaddch(win_text, cury, curx++, '-');
-                    }
+                if (!test_only && curx < width - 1) {
+                    flush_run();
+                    draw_hline(cury, curx, '-', width - 1 - curx);
+                    curx = width - 1;
                 }
                 str_it++;
             }
@@ -310,15 +330,10 @@ int TextWidget::draw_line(const std::string& line, bool test_only, int from_line
     }
 
     /* fill up line */
-    wattroff(win_text, A_BOLD);
-    wattroff(win_text, A_UNDERLINE);
-#ifdef A_ITALIC
-    wattroff(win_text, A_ITALIC);
-#endif
+    flush_run();
+    reset_formats();
     if (!test_only) {
-        for (int i = curx; i < width; i++) {
-            mvwaddch(win_text, cury, i, ' ');
-        }
+        draw_hline(cury, curx, ' ', width - curx);
     }
 
     return line_height;
@@ -348,68 +363,108 @@ void TextWidget::delete_ncurses_object() {
 
 void TextWidget::set_formats(const char *p) {
     const Formatter::Attribute *a = reinterpret_cast<const Formatter::Attribute *>(p);
-    wcolor_set(win_text, a->color, 0);
+
+    /* skip redundant attribute switches */
+    if (formats_valid && a->color == current_formats.color && a->switches == current_formats.switches) {
+        return;
+    }
+
+    /* the pending run still has the old attributes */
+    flush_run();
+
+    attr_t attrs = A_NORMAL;
     if (a->switches & Formatter::AttributeBold) {
-        wattron(win_text, A_BOLD);
-    } else {
-        wattroff(win_text, A_BOLD);
+        attrs |= A_BOLD;
     }
 
     if (a->switches & Formatter::AttributeUnderline) {
-        wattron(win_text, A_UNDERLINE);
-    } else {
-        wattroff(win_text, A_UNDERLINE);
+        attrs |= A_UNDERLINE;
     }
 
     /* on many systems, A_ITALIC is not defined */
 #ifdef A_ITALIC
     if (a->switches & Formatter::AttributeItalic) {
-        wattron(win_text, A_ITALIC);
+        attrs |= A_ITALIC;
+    }
+#endif
+
+    /* color and switches in one go */
+    wattr_set(win_text, attrs, a->color, 0);
+
+    current_formats = *a;
+    formats_valid = true;
+}
+
+void TextWidget::reset_formats() {
+    /* keeps the color, turns off all switches */
+    if (formats_valid) {
+        if (!current_formats.switches) {
+            return;
+        }
+        Formatter::Attribute a = current_formats;
+        a.switches = 0;
+        set_formats(reinterpret_cast<const char *>(&a));
     } else {
+        flush_run();
+        wattroff(win_text, A_BOLD);
+        wattroff(win_text, A_UNDERLINE);
+#ifdef A_ITALIC
         wattroff(win_text, A_ITALIC);
-    }
 #endif
+    }
 }
 
 void TextWidget::draw_word(int leftmost, std::string& word, int& line_height, bool test_only, int from_line, int to_line) {
     int len = get_utf8_length(word);
     if (len) {
+        /* glyphs are collected in one run, which is emitted when
+         * the attributes or the row change or the line ends. */
         UTF8Iterator it = word.begin();
-        int pos;
+        int pos, w;
         while (*it) {
-            pos = curx + get_display_width(it.get_sequence());
+            const std::string& seq = it.get_sequence();
+            w = get_display_width(seq);
+            pos = curx + w;
             if (pos > width) {
+                flush_run();
                 if (!test_only && to_line > -1 && line_height == to_line - 1) return;
                 increment_line(leftmost, line_height, test_only, from_line, to_line);
             }
             if (!test_only && (from_line == -1 || line_height >= from_line)) {
-                mvwaddstr(win_text, cury, curx, it.get_sequence().c_str());
-            }
-            curx += get_display_width(it.get_sequence());
-
-            /*
-            if (curx > width - 1) {
-                if (!test_only && to_line > -1 && line_height == to_line - 1) return;
-                increment_line(leftmost, line_height, test_only, from_line, to_line);
-            }
-            if (!test_only && (from_line == -1 || line_height >= from_line)) {
-                mvwaddstr(win_text, cury, curx, it.get_sequence().c_str());
+                if (run.empty()) {
+                    run_x = curx;
+                }
+                run += seq;
             }
-            curx += get_display_width(it.get_sequence());
-            */
-
+            curx += w;
             it++;
         }
         word.clear();
     }
 }
 
+void TextWidget::flush_run() {
+    if (run.length()) {
+        mvwaddnstr(win_text, cury, run_x, run.c_str(), run.length());
+        run.clear();
+    }
+}
+
+void TextWidget::draw_hline(int y, int x, chtype ch, int n) {
+    if (n > 0) {
+        /* whline only renders the background, pass the current attributes */
+        attr_t attrs;
+        short pair;
+        wattr_get(win_text, &attrs, &pair, 0);
+        mvwhline(win_text, y, x, ch | (attrs & ~A_COLOR) | COLOR_PAIR(pair), n);
+    }
+}
+
 void TextWidget::increment_line(int new_posx, int& line_height, bool test_only, int from_line, int to_line) {
     /* fill up line */
+    flush_run();
     if (!test_only && (from_line == -1 || line_height >= from_line)) {
-        for (int i = curx; i < width; i++) {
-            mvwaddch(win_text, cury, i, ' ');
-        }
+        draw_hline(cury, curx, ' ', width - curx);
     }
 
     /* next line */
@@ -430,9 +485,7 @@ void TextWidget::increment_line(int new_posx, int& line_height, bool test_only,
 
     /* fill up line */
     if (!test_only && (from_line == -1 || line_height >= from_line)) {
-        for (int i = 0; i < curx; i++) {
-            mvwaddch(win_text, cury, i, ' ');
-        }
+        draw_hline(cury, 0, ' ', curx);
     }
 
     /* increment used rows in this text line */
@@ -22,6 +22,7 @@
 #include "UTF8.hpp"
 
 #include <cstdio>
+#include <time.h>
 
 static const int RecodeMaxSize = 1024;
 
@@ -58,3 +59,17 @@ int get_display_width_string(const std::string& utf8_string) {
 
     return sz;
 }
+
+long get_monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+long get_monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -28,23 +28,33 @@
 #include "NicklistWidget.hpp"
 #include "TreeViewWidget.hpp"
 #include "Formatter.hpp"
+#include "LuaExecutor.hpp"
+#include "RepaintTimer.hpp"
 #include <Circada/Circada.hpp>
 
 #include <vector>
+#include <map>
+#include <atomic>
 
 #define SOL_ALL_SAFETIES_ON 1
 #define SOL_PRINT_ERRORS 0
+#define SOL_EXCEPTIONS_SAFE_PROPAGATION 0    /* luajit would let them pass through pcall */
 #include "sol/sol.hpp"
 
 using namespace Circada;
 
+/* lets sol pass messages to lua as views */
+inline int sol_lua_push(sol::types<LuaMessage>, lua_State *L, const LuaMessage& msg) {
+    return push_lua_message(L, msg);
+}
+
 class ApplicationException : public Exception {
 public:
     ApplicationException(const char *msg) : Exception(msg) { }
     ApplicationException(std::string msg) : Exception(msg) { }
 };
 
-class Application : public IrcClient, public Parser {
+class Application : public IrcClient, public Parser, public FileWatcherListener, public LuaEventHandler, public RepaintTimerHandler {
 public:
     Application(Configuration& config);
     virtual ~Application();
@@ -54,7 +64,10 @@ public:
 private:
     Configuration& config;
 
+    typedef std::map<std::string, std::weak_ptr<LogStore> > Logs;
+
     ScreenWindow::List windows;
+    Logs logs;              /* by file name, two sessions may log the same channel */
     Mutex draw_mtx;
     WINDOW *win_main;
     int height, width;
@@ -81,6 +94,11 @@ private:
     std::string number_input_sign;
     std::string windowbar_separator;
 
+    /* nicklist updates are coalesced, one repaint per frame */
+    bool nicklist_dirty;
+    long nicklist_drawn_at;
+    RepaintTimer nicklist_timer;    /* draws the tail of a burst */
+
     /* widget flags */
     bool nicklist_visible;
     bool treeview_visible;
@@ -89,12 +107,111 @@ private:
     /* loop */
     bool running;
 
-    /* lua */
+    /* last search results */
+    ScreenWindow::Hits search_hits;
+
+    /* /stats shows the counter rates since the last call */
+    typedef std::map<std::string, u64> StatsValues;
+    StatsValues stats_values;
+    long stats_time;
+
+    /* lua, only touched on the executor thread after start */
+    struct LuaProfile {
+        LuaProfile() : calls(0), total(0), max(0), instructions(0), allocations(0), aborted(0) { }
+
+        u64 calls;
+        u64 total;          /* us */
+        u64 max;            /* us */
+        u64 instructions;   /* counted in steps of the hook interval */
+        u64 allocations;
+        u64 aborted;
+    };
+    typedef std::map<std::string, LuaProfile> LuaProfiles;
+
+    struct LuaSubscription {
+        LuaSubscription() : id(0), legacy(false), active(true), profile(0) { }
+
+        int id;
+        bool legacy;    /* bound from a global on_... function */
+        bool active;    /* removed after the running dispatch */
+        LuaProfile *profile;
+        LuaFilter filter;
+        sol::main_protected_function fn;
+    };
+    typedef std::vector<LuaSubscription *> LuaSubscriptions;
+
+    struct LuaTimer {
+        long interval;  /* 0 for a single shot */
+        LuaProfile *profile;
+        sol::main_protected_function fn;
+    };
+    typedef std::map<TimerWheel::Id, LuaTimer> LuaTimers;
+
+    /* a coroutine in await_reply, keyed by its timeout */
+    struct LuaWaiter {
+        lua_State *thread;
+        int ref;
+        LuaProfile *profile;
+        LuaFilter filter;
+    };
+    typedef std::map<TimerWheel::Id, LuaWaiter> LuaWaiters;
+
+    LuaProfiles lua_profiles;
+    LuaProfile *lua_profile;
+    long lua_call_started;
+    u64 lua_call_instructions;
+    u64 lua_call_allocations;
+    bool lua_call_aborted;
+    bool lua_budget_hooked;
+    u64 lua_allocations;
+    ConfigurationValue<int> lua_budget_ms;
+    ConfigurationValue<u64> lua_budget_instructions;
+    MetricHistogram& lua_call_time;
+    MetricCounter& lua_aborted_calls;
+
     sol::state lua;
+    LuaSubscriptions lua_subscriptions[LuaEvent::TypeMessages + 1];
+    int lua_subscription_id;
+    bool lua_subscriptions_dirty;
+    LuaTimers lua_timers;
+    LuaWaiters lua_waiters;
+    std::atomic<unsigned long> lua_hooked;
+    LuaExecutor lua_executor;
+    std::string script_file;
+
+    /* hot reload, the watcher flags and the main loop applies */
+    std::atomic<bool> config_reload_pending;
+    std::atomic<bool> script_reload_pending;
+    FileWatcher file_watcher;
+
+    /* reacts to /set, it is called outside of the draw lock */
+    class SettingsListener : public Circada::ConfigurationListener {
+    public:
+        SettingsListener(Application& app) : app(app) { }
+
+        virtual void configuration_changed(const std::string& category, const std::string& key, const std::string& value);
+
+    private:
+        Application& app;
+    };
+
+    SettingsListener settings_listener;
+
+    void setting_changed(const std::string& category, const std::string& key, const std::string& value);
+    virtual void file_changed(const std::string& filename);
+    void start_file_watcher();
+    void watch_script(const std::string& filename);
+    void reload_config();
+    void reload_script();
 
     ScreenWindow *create_window(Session *s, Window *w);
+    void open_log_nolock(ScreenWindow *sw);
+    ScreenWindow::LogPtr get_log_nolock(const std::string& filename);
+    void flush_logs();
     ScreenWindow *get_window(Window *w);
     ScreenWindow *get_window_nolock(Window *w);
+    ScreenWindow *get_window_by_sequence_nolock(int sequence);
+    bool is_window_listed(unsigned long id);
     ScreenWindow *get_server_window(Session *s);
     ScreenWindow *get_server_window_nolock(Session *s);
     void destroy_window(Window *w);
@@ -106,6 +223,8 @@ private:
     ScreenWindow *set_channel_mode(Window *w, const std::string& mode);
     void set_lag(ScreenWindow *w, double lag_in_s);
     void changes_in_nicklist(Window *w);
+    void flush_nicklist_nolock(bool force);
+    virtual void repaint_timer_expired();
     void select_next_window();
     void select_prev_window();
 
@@ -129,16 +248,14 @@ private:
     std::string make_tree_nr(ScreenWindow::List::iterator& it);
 
     /* lua */
-    Session *lua_find_session_throw(Session *s);
-    void lua_cmd_raw(Session *s, const std::string& params);
-    void lua_cmd_join(Session *s, const std::string& params);
-    void lua_cmd_part(Session *s, const std::string& params);
-    void lua_cmd_privmsg(Session *s, const std::string& dest, const std::string& msg);
-    void lua_cmd_notice(Session *s, const std::string& dest, const std::string& msg);
-    void lua_cmd_me(Session *s, const std::string& dest, const std::string& msg);
-    void lua_cmd_mode(Session *s, const std::string& dest, const std::string& params);
+    void lua_cmd_raw(const LuaSession& s, const std::string& params);
+    void lua_cmd_join(const LuaSession& s, const std::string& params);
+    void lua_cmd_part(const LuaSession& s, const std::string& params);
+    void lua_cmd_privmsg(const LuaSession& s, const std::string& dest, const std::string& msg);
+    void lua_cmd_notice(const LuaSession& s, const std::string& dest, const std::string& msg);
+    void lua_cmd_me(const LuaSession& s, const std::string& dest, const std::string& msg);
+    void lua_cmd_mode(const LuaSession& s, const std::string& dest, const std::string& params);
 
-    sol::table make_table_from_message(const Message& msg);
 
     void lua_on_connection_lost(Session *s, const std::string& reason);
     void lua_on_message_arrived(Session *s, Window *w, const Message& msg);
@@ -152,6 +269,39 @@ private:
     void lua_on_nick_added(Session *s, Window *w, const std::string& nick);
     void lua_on_nick_removed(Session *s, Window *w, const std::string& nick);
     void lua_on_nick_changed(Session *s, Window *w, const std::string& old_nick, const std::string& new_nick);
+    bool lua_is_hooked(LuaEvent::Type type) const;
+    virtual void lua_dispatch(LuaEvent::List& events);
+    void lua_dispatch_event(LuaEvent& evt);
+    void lua_dispatch_messages(LuaEvent::List& events, const std::vector<bool>& valid, size_t from, size_t to);
+    sol::protected_function_result lua_call_hook(sol::main_protected_function& fn, const LuaEvent& evt);
+    sol::object lua_session_object(const LuaSession& s);
+    sol::object lua_window_object(const LuaWindow& w);
+    void lua_check_result(const sol::protected_function_result& result);
+    bool lua_check_event(LuaEvent& evt);
+    void lua_get_commands(const sol::object& obj, LuaFilter::Commands& commands);
+    int lua_subscribe(const std::string& event, sol::main_protected_function fn, sol::optional<sol::table> filter, bool legacy);
+    bool lua_unsubscribe(int id);
+    void lua_bind_legacy_hooks();
+    void lua_clear_subscriptions();
+    void lua_cleanup_subscriptions();
+    void lua_update_hooked();
+    TimerWheel::Id lua_add_timer(long delay, long interval, sol::main_protected_function fn);
+    bool lua_cancel_timer(TimerWheel::Id id);
+    virtual void lua_timers_expired(const TimerWheel::Ids& ids);
+    void lua_clear_timers();
+    void lua_await_reply(lua_State *thread, const LuaSession& s, const sol::object& replies, long timeout);
+    void lua_resume_waiters(const LuaEvent& evt);
+    void lua_resume_waiter(const LuaWaiter& waiter, const MessagePtr& msg);
+    LuaProfile *lua_get_profile(const std::string& name);
+    std::string lua_get_location(sol::main_protected_function& fn);
+    std::string lua_get_location(lua_State *thread, int level);
+    void lua_update_budget_hook();
+    void lua_begin_call(LuaProfile *profile);
+    void lua_end_call();
+    void lua_print_stats(bool reset);
+    sol::state lua_create_state();
+    static void *lua_allocate(void *ud, void *ptr, size_t osize, size_t nsize);
+    static void lua_budget_hook(lua_State *L, lua_Debug *ar);
     void lua_setup();
     void lua_print(const char *s);
     void lua_error(const sol::error&);
@@ -175,6 +325,11 @@ private:
     void execute_sort(const std::string& params);
     void execute_netsplits(const std::string& params);
     void execute_lua(const std::string& params);
+    void execute_search(const std::string& params);
+    void execute_jump(const std::string& params);
+    void execute_stats(const std::string& params);
+    void search_nolock(const std::string& query, ScreenWindow::Hits& hits);
+    void jump_to_hit(const ScreenWindow::Hit& hit);
     void print_line(ScreenWindow *w, const std::string& timestamp, const std::string& what, Format& fmt);
     void print_line(ScreenWindow *w, const std::string& timestamp, const std::string& what);
 
@@ -0,0 +1,85 @@
+/*
+ *  LuaCompat.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LUACOMPAT_HPP_
+#define _LUACOMPAT_HPP_
+
+#include <lua.hpp>
+
+/* the few calls, that differ between lua 5.4 and luajit. luajit */
+/* has no user values, the environment table of a userdata holds */
+/* them instead. lua 5.1 to 5.3 are not supported.               */
+#ifdef LUAJIT_VERSION
+
+inline int compat_lua_resume(lua_State *L, lua_State *from, int nargs, int *results) {
+    int rv = lua_resume(L, nargs);
+    *results = (rv == LUA_OK || rv == LUA_YIELD ? lua_gettop(L) : 0);
+
+    return rv;
+}
+
+inline void *compat_lua_newuserdata(lua_State *L, size_t sz, int nuv) {
+    void *mem = lua_newuserdata(L, sz);
+    lua_createtable(L, nuv, 0);
+    lua_setfenv(L, -2);
+
+    return mem;
+}
+
+inline int compat_lua_getuservalue(lua_State *L, int idx, int n) {
+    lua_getfenv(L, idx);
+    lua_rawgeti(L, -1, n);
+    lua_remove(L, -2);
+
+    return lua_type(L, -1);
+}
+
+inline void compat_lua_setuservalue(lua_State *L, int idx, int n) {
+    lua_getfenv(L, idx);
+    lua_insert(L, -2);
+    lua_rawseti(L, -2, n);
+    lua_pop(L, 1);
+}
+
+#else
+
+#if LUA_VERSION_NUM < 504
+#error "Lua 5.4 or LuaJIT is required."
+#endif
+
+inline int compat_lua_resume(lua_State *L, lua_State *from, int nargs, int *results) {
+    return lua_resume(L, from, nargs, results);
+}
+
+inline void *compat_lua_newuserdata(lua_State *L, size_t sz, int nuv) {
+    return lua_newuserdatauv(L, sz, nuv);
+}
+
+inline int compat_lua_getuservalue(lua_State *L, int idx, int n) {
+    return lua_getiuservalue(L, idx, n);
+}
+
+inline void compat_lua_setuservalue(lua_State *L, int idx, int n) {
+    lua_setiuservalue(L, idx, n);
+}
+
+#endif
+
+#endif // _LUACOMPAT_HPP_
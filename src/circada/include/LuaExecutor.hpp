@@ -0,0 +1,170 @@
+/*
+ *  LuaExecutor.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LUAEXECUTOR_HPP_
+#define _LUAEXECUTOR_HPP_
+
+#include <Circada/Circada.hpp>
+#include <Circada/Thread.hpp>
+#include <Circada/IOSync.hpp>
+#include <Circada/Mutex.hpp>
+#include <Circada/TimerWheel.hpp>
+
+#include "LuaMessage.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace Circada;
+
+class LuaExecutorException : public Exception {
+public:
+    LuaExecutorException(const char *msg) : Exception(msg) { }
+    LuaExecutorException(std::string msg) : Exception(msg) { }
+};
+
+/* copies of a session and a window, taken by the posting thread. */
+/* scripts never touch the originals, they change meanwhile. an id */
+/* of 0 means none, the ids are never reused.                      */
+struct LuaSession {
+    LuaSession() : id(0), away(false), nicklen(0), lag(0.0) { }
+    LuaSession(Session *s);
+
+    bool is_that_me(const std::string& nick) const;
+    bool is_channel(const std::string& name) const;
+
+    unsigned long id;
+    std::string server;
+    std::string nick;
+    std::string flags;
+    std::string channel_prefixes;
+    bool away;
+    int nicklen;
+    double lag;
+};
+
+struct LuaWindow {
+    LuaWindow() : id(0), window_type(WindowTypeApplication), action(WindowActionNone) { }
+    LuaWindow(Window *w);
+
+    unsigned long id;
+    WindowType window_type;
+    std::string name;
+    std::string topic;
+    std::string flags;
+    WindowAction action;
+};
+
+/* a copy of everything a hook needs. the session and the window */
+/* may be gone, when the event is delivered.                     */
+struct LuaEvent {
+    typedef std::vector<LuaEvent> List;
+
+    enum Type {
+        TypeLoad,
+        TypeReload,
+        TypeExecute,
+        TypeStats,
+        TypeConnectionLost,
+        TypeMessageArrived,
+        TypeMyModeChanged,
+        TypeWindowOpened,
+        TypeWindowClosing,
+        TypeTopicChanged,
+        TypeNameChanged,
+        TypeChannelModeChanged,
+        TypeNewNicklist,
+        TypeNickAdded,
+        TypeNickRemoved,
+        TypeNickChanged,
+        TypeMessages    /* a run of messages, never posted */
+    };
+
+    LuaEvent(Type type, Session *s, Window *w) : type(type) {
+        if (s) this->s = LuaSession(s);
+        if (w) this->w = LuaWindow(w);
+    }
+
+    Type type;
+    LuaSession s;
+    LuaWindow w;
+    MessagePtr msg;
+    std::string a;
+    std::string b;
+};
+
+/* checked in c++, before a hook is entered */
+struct LuaFilter {
+    typedef std::vector<std::string> Commands;
+
+    LuaFilter() : window_type(-1), session_id(0) { }
+
+    bool matches(const LuaEvent& evt) const;
+
+    Commands commands;          /* any, if empty */
+    int window_type;            /* any, if negative */
+    std::string nick;           /* glob pattern, any if empty */
+    unsigned long session_id;   /* any, if 0 */
+};
+
+class LuaEventHandler {
+public:
+    virtual ~LuaEventHandler() { }
+
+    /* called on the executor thread with all events queued meanwhile */
+    virtual void lua_dispatch(LuaEvent::List& events) = 0;
+
+    /* called on the executor thread with the expired timers */
+    virtual void lua_timers_expired(const TimerWheel::Ids& ids) = 0;
+};
+
+/* runs all lua code on one thread. posting never waits for a */
+/* script, so a slow script cannot stall a receive loop.      */
+class LuaExecutor : private Thread, private IOSync {
+private:
+    LuaExecutor(const LuaExecutor& rhs);
+    LuaExecutor& operator=(const LuaExecutor& rhs);
+
+public:
+    LuaExecutor(LuaEventHandler& handler);
+    virtual ~LuaExecutor();
+
+    void start();
+    void stop();
+    void post(const LuaEvent& evt);
+
+    /* on the executor thread only */
+    TimerWheel::Id add_timer(long delay);
+    void rearm_timer(TimerWheel::Id id, long delay);
+    bool cancel_timer(TimerWheel::Id id);
+    void clear_timers();
+
+private:
+    LuaEventHandler& handler;
+    Mutex mtx;
+    bool running;
+    bool started;
+    LuaEvent::List queue;
+    TimerWheel timers;
+
+    virtual void thread();
+};
+
+#endif // _LUAEXECUTOR_HPP_
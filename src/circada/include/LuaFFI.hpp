@@ -0,0 +1,46 @@
+/*
+ *  LuaFFI.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LUAFFI_HPP_
+#define _LUAFFI_HPP_
+
+#include "LuaExecutor.hpp"
+
+#include <cstddef>
+
+using namespace Circada;
+
+/* a read-only c api for scripts, that run on luajit. the pointers */
+/* come from m:pointer() and w:pointer() and are only valid during */
+/* the hook, that received the message or the window. a window is  */
+/* the copy, that was taken with the event.                        */
+extern "C" {
+    const char *circada_message_field(const Message *msg, int field, size_t *len);
+    int circada_message_param_count(const Message *msg);
+    const char *circada_message_param(const Message *msg, int i, size_t *len);
+    int circada_window_type(const LuaWindow *w);
+    const char *circada_window_name(const LuaWindow *w, size_t *len);
+    const char *circada_window_topic(const LuaWindow *w, size_t *len);
+}
+
+/* passed to ffi.cdef, when a script runs on luajit */
+extern const char *LuaFFIDeclarations;
+
+#endif // _LUAFFI_HPP_
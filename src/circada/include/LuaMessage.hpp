@@ -0,0 +1,47 @@
+/*
+ *  LuaMessage.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LUAMESSAGE_HPP_
+#define _LUAMESSAGE_HPP_
+
+#include <Circada/Message.hpp>
+
+#include <memory>
+
+#include "LuaCompat.hpp"
+
+using namespace Circada;
+
+typedef std::shared_ptr<const Message> MessagePtr;
+
+/* a view on a parsed message for lua. nothing is copied, when it */
+/* is passed to a hook. the lua strings are created on the first  */
+/* access and kept with the view.                                 */
+struct LuaMessage {
+    LuaMessage(const MessagePtr& msg) : msg(msg) { }
+
+    MessagePtr msg;
+};
+
+void register_lua_message(lua_State *L);
+int push_lua_message(lua_State *L, const LuaMessage& msg);
+const std::string *get_lua_message_field(const Message& msg, int field);
+
+#endif // _LUAMESSAGE_HPP_
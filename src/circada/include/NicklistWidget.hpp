@@ -25,6 +25,7 @@
 #include "ScreenWindow.hpp"
 
 #include <string>
+#include <vector>
 
 class NicklistWidget {
 public:
@@ -40,14 +41,31 @@ public:
     void set_nicklist_delimiter(const std::string& delimiter);
 
 private:
+    struct Row {
+        Row() : flag(0) { }
+        Row(char flag, const std::string& nick) : flag(flag), nick(nick) { }
+
+        bool operator==(const Row& rhs) const { return (flag == rhs.flag && nick == rhs.nick); }
+        bool operator!=(const Row& rhs) const { return !(*this == rhs); }
+
+        char flag;          /* 0 = empty row */
+        std::string nick;
+    };
+    typedef std::vector<Row> Rows;
+
     bool configured;
     ScreenWindow *current_window;
     std::string nicklist_delimiter;
     int width;
     int height;
     WINDOW *win_nicklist;
+    Rows rows;          /* visible rows on screen */
+    bool rows_valid;
 
     void delete_ncurses_object();
+    void draw_row(int y, const Row& row);
+    void insert_row(int y, const Row& row);
+    void delete_row(int y, const Row& last_row);
 };
 
 #endif // _NICKLISTWIDGET_HPP_
@@ -0,0 +1,72 @@
+/*
+ *  RepaintTimer.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _REPAINTTIMER_HPP_
+#define _REPAINTTIMER_HPP_
+
+#include <Circada/Circada.hpp>
+#include <Circada/Thread.hpp>
+#include <Circada/IOSync.hpp>
+#include <Circada/Mutex.hpp>
+
+using namespace Circada;
+
+class RepaintTimerException : public Exception {
+public:
+    RepaintTimerException(const char *msg) : Exception(msg) { }
+    RepaintTimerException(std::string msg) : Exception(msg) { }
+};
+
+class RepaintTimerHandler {
+public:
+    virtual ~RepaintTimerHandler() { }
+
+    /* called on the timer thread, no lock held */
+    virtual void repaint_timer_expired() = 0;
+};
+
+/* one shot timer for deferred repaints. the main loop sleeps in */
+/* getch() and cannot pick up the tail of a burst in time.       */
+class RepaintTimer : private Thread, private IOSync {
+private:
+    RepaintTimer(const RepaintTimer& rhs);
+    RepaintTimer& operator=(const RepaintTimer& rhs);
+
+public:
+    RepaintTimer(RepaintTimerHandler& handler);
+    virtual ~RepaintTimer();
+
+    void start();
+    void stop();
+
+    /* an armed timer keeps its earlier deadline */
+    void arm(long delay);
+
+private:
+    RepaintTimerHandler& handler;
+    Mutex mtx;
+    bool running;
+    bool started;
+    long deadline;          /* monotonic ms, 0 if not armed */
+
+    virtual void thread();
+};
+
+#endif // _REPAINTTIMER_HPP_
@@ -22,11 +22,14 @@
 #define _SCREENWINDOW_HPP_
 
 #include "Formatter.hpp"
+#include "SearchIndex.hpp"
 
 #include <Circada/Circada.hpp>
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <time.h>
 
 class ScreenWindow {
 public:
@@ -36,16 +39,32 @@ public:
             TypeLastViewed
         };
 
-        Line(const std::string& text) : type(TypeRegular), text(text) { }
-        Line(Type type, const std::string& text) : type(type), text(text) { }
+        Line(const std::string& text) : type(TypeRegular), text(text), id(0), when(0) { }
+        Line(Type type, const std::string& text) : type(type), text(text), id(0), when(0) { }
+        Line(const std::string& text, const std::string& nick) : type(TypeRegular), text(text), id(0), when(0), nick(nick) { }
 
         Type type;
         std::string text;
+        SearchIndex::Id id;
+        time_t when;
+        std::string nick;
+    };
+
+    /* the window is referred by its sequence, which is never reused */
+    struct Hit {
+        int sequence;
+        std::string window;
+        SearchIndex::Id id;
+        time_t when;
+        std::string nick;
+        std::string text;
     };
 
     typedef std::vector<Circada::DCCHandle> DDCHandles;
     typedef std::vector<ScreenWindow *> List;
     typedef std::vector<Line> Lines;
+    typedef std::vector<Hit> Hits;
+    typedef std::shared_ptr<Circada::LogStore> LogPtr;    /* windows of the same log share it */
 
     ScreenWindow(Circada::Configuration& config, int sequence, Circada::Session *s, Circada::Window *w);
     virtual ~ScreenWindow();
@@ -57,6 +76,13 @@ public:
     void set_last_viewed(Formatter& fmt);
     Lines& get_lines();
     int get_sequence();
+    void search(const SearchIndex::Words& words, const std::string& nick, time_t since, size_t max_hits, Hits& hits);
+    int get_line_index(SearchIndex::Id id);
+    void set_log(const LogPtr& log);
+    Circada::LogStore *get_log();
+    void flush_log();
+    int load_history(int max_lines);
+    void cleanup();
 
     /* direct accessible */
     int line_at_bottom;
@@ -68,16 +94,29 @@ public:
 private:
     int sequence;
     Circada::Configuration& config;
+    Circada::ConfigurationValue<int> max_entries;
     Circada::Session *session;
     Circada::Window *window;
 
     Lines lines;
+    SearchIndex index;
+    SearchIndex::Id next_id;
+    SearchIndex::Id prev_id;    /* for lines from the log */
 
-    void cleanup();
+    LogPtr log;
+    size_t log_first_record;    /* record of the oldest logged line in memory */
+    size_t logged_lines;
+    int history_lines;          /* lines fetched from the log while scrolling back */
+
+    void append_line(const Line& line);
 };
 
 struct ScreenWindowComparer {
     bool operator()(ScreenWindow* const& lhs, ScreenWindow* const& rhs);
 };
 
+struct ScreenWindowHitComparer {
+    bool operator()(const ScreenWindow::Hit& lhs, const ScreenWindow::Hit& rhs);
+};
+
 #endif // _SCREENWINDOW_HPP_
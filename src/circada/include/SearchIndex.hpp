@@ -0,0 +1,62 @@
+/*
+ *  SearchIndex.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SEARCHINDEX_HPP_
+#define _SEARCHINDEX_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+
+/* word index over the formatted lines of a screen window.
+ * a query word matches all indexed words, which start with it.
+ */
+class SearchIndex {
+public:
+    typedef unsigned long Id;
+    typedef std::vector<Id> Ids;
+    typedef std::vector<std::string> Words;
+
+    SearchIndex();
+    virtual ~SearchIndex();
+
+    void add(Id id, const std::string& formatted_text);
+    void remove(Id id, const std::string& formatted_text);
+    void clear();
+    void find(const Words& query, Ids& ids) const;
+
+    static void get_words(const std::string& text, Words& words);
+    static std::string get_plaintext(const std::string& formatted_text);
+
+private:
+    struct Postings {
+        Postings() : skip(0) { }
+
+        size_t skip;    /* evicted ids at the front */
+        Ids ids;        /* ascending */
+    };
+    typedef std::map<std::string, Postings> Index;
+
+    Index index;
+
+    void find_prefix(const std::string& prefix, Ids& ids) const;
+};
+
+#endif // _SEARCHINDEX_HPP_
@@ -38,6 +38,7 @@ public:
     void draw();
     void scroll_up();
     void scroll_down();
+    void show_line(int index);
     void draw_line(ScreenWindow *w, const std::string& line);
     void select_window(ScreenWindow *w);
     ScreenWindow *get_selected_window();
@@ -55,6 +56,10 @@ private:
     int curx;
     int cury;
     bool first_line;
+    bool formats_valid;
+    Formatter::Attribute current_formats;
+    std::string run;    /* pending glyphs, drawn at run_x */
+    int run_x;
     WINDOW *win_text;
 
     StatusWidget& status_widget;
@@ -63,8 +68,11 @@ private:
     void top_down_draw(int max_lines);
     bool draw_clipping(int from_index, int upmost_skip_rows, int how_many_rows);
     void set_formats(const char *p);
+    void reset_formats();
     int draw_line(const std::string& line, bool test_only = false, int from_line = -1, int to_line = -1);
     void draw_word(int leftmost, std::string& word, int& line_height, bool test_only, int from_line, int to_line);
+    void flush_run();
+    void draw_hline(int y, int x, chtype ch, int n);
     void increment_line(int new_posx, int& line_height, bool test_only, int from_line, int to_line);
     void set_height(int line, int height);
     int get_height(int line);
@@ -28,5 +28,7 @@
 size_t to_wstring(const std::string& from, std::wstring& to);
 int get_display_width(const std::string& utf8_sequence);
 int get_display_width_string(const std::string& utf8_string);
+long get_monotonic_ms();
+long get_monotonic_us();
 
 #endif // _UTILS_HPP_
@@ -22,9 +22,12 @@
 #include "Circada/Session.hpp"
 #include "Circada/Global.hpp"
 
+#include <algorithm>
+
 namespace Circada {
 
-    IrcClient::IrcClient(Configuration& config) : IrcServerSide(config), config(config) { }
+    IrcClient::IrcClient(Configuration& config)
+        : IrcServerSide(config), config(config), metrics_exporter(config, get_metrics()) { }
 
     IrcClient::~IrcClient() {
         ScopeMutex lock(&mtx);
@@ -59,8 +62,19 @@ namespace Circada {
     }
 
     void IrcClient::destroy_session(Session *s) {
-        ScopeMutex lock(&mtx);
-        destroy_session_nolock(s);
+        {
+            ScopeMutex lock(&mtx);
+            Session::List::iterator it = std::find(sessions.begin(), sessions.end(), s);
+            if (it == sessions.end()) {
+                return;
+            }
+            sessions.erase(it);
+        }
+
+        /* the teardown fires window events, which may look up */
+        /* sessions again. the session is not listed anymore.  */
+        s->disconnect();
+        delete s;
     }
 
     size_t IrcClient::get_session_count() {
@@ -91,6 +105,33 @@ namespace Circada {
         return 0;
     }
 
+    bool IrcClient::is_session_listed(unsigned long id) {
+        ScopeMutex lock(&mtx);
+        for (Session::List::iterator it = sessions.begin(); it != sessions.end(); it++) {
+            if ((*it)->get_id() == id) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IrcClient::send_to_session(unsigned long id, const std::string& data) {
+        /* a listed session is not destroyed while we hold the lock */
+        ScopeMutex lock(&mtx);
+        for (Session::List::iterator it = sessions.begin(); it != sessions.end(); it++) {
+            Session *s = *it;
+            if (s->get_id() == id) {
+                s->send(data);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string IrcClient::get_metrics_error() {
+        return metrics_exporter.get_error();
+    }
+
     DCCHandle::List IrcClient::get_dcc_list() {
         DCCManager *dcc_mgr = static_cast<DCCManager *>(this);
         return dcc_mgr->get_all_handles(0);
@@ -121,6 +162,36 @@ namespace Circada {
         dcc_mgr->send_dcc_msg(dcc, msg);
     }
 
+    void IrcClient::dcc_set_limit(DCCLimitScope scope, u64 rate) {
+        DCCManager *dcc_mgr = static_cast<DCCManager *>(this);
+        dcc_mgr->set_bandwidth_limit(scope, rate);
+    }
+
+    u64 IrcClient::dcc_get_limit(DCCLimitScope scope) {
+        DCCManager *dcc_mgr = static_cast<DCCManager *>(this);
+        return dcc_mgr->get_bandwidth_limit(scope);
+    }
+
+    void IrcClient::dcc_set_transfer_limit(DCCHandle dcc, u64 rate) {
+        DCCManager *dcc_mgr = static_cast<DCCManager *>(this);
+        dcc_mgr->set_transfer_limit(dcc, rate);
+    }
+
+    void IrcClient::dcc_set_priority(DCCHandle dcc, DCCPriority priority) {
+        DCCManager *dcc_mgr = static_cast<DCCManager *>(this);
+        dcc_mgr->set_transfer_priority(dcc, priority);
+    }
+
+    void IrcClient::dcc_set_slots(DCCLimitScope scope, unsigned int slots) {
+        DCCManager *dcc_mgr = static_cast<DCCManager *>(this);
+        dcc_mgr->set_slots(scope, slots);
+    }
+
+    unsigned int IrcClient::dcc_get_slots(DCCLimitScope scope) {
+        DCCManager *dcc_mgr = static_cast<DCCManager *>(this);
+        return dcc_mgr->get_slots(scope);
+    }
+
     DCCHandle IrcClient::get_dcc_handle_from_window(Window *w) {
         SessionWindow *sw = static_cast<SessionWindow *>(w);
         if (!sw->is_dcc_window()) {
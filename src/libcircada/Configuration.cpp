@@ -31,6 +31,43 @@ namespace Circada {
 
     const char *Configuration::ConfigurationFile = "config";
 
+    /**************************************************************************
+     * ConfigurationHandle
+     **************************************************************************/
+    ConfigurationHandle::ConfigurationHandle(Configuration& config, const std::string& category, const std::string& key, const std::string& defaults)
+        : config(config), name(category + "." + key), defaults(defaults), attached(false) { }
+
+    ConfigurationHandle::~ConfigurationHandle() {
+        detach();
+    }
+
+    const std::string& ConfigurationHandle::get_name() const {
+        return name;
+    }
+
+    const std::string& ConfigurationHandle::get_defaults() const {
+        return defaults;
+    }
+
+    void ConfigurationHandle::attach() {
+        /* called by the derived constructor, update() is not ready before */
+        if (!attached) {
+            config.attach_handle(this);
+            attached = true;
+        }
+    }
+
+    void ConfigurationHandle::detach() {
+        if (attached) {
+            config.detach_handle(this);
+            attached = false;
+        }
+    }
+
+    /**************************************************************************
+     * Configuration
+     **************************************************************************/
+
     Configuration::Configuration(const std::string& working_directory) : modified(false) {
         try {
             this->working_directory = Environment::get_home_directory() + "/" + working_directory;
@@ -58,12 +95,78 @@ namespace Circada {
         return working_directory;
     }
 
+    std::string Configuration::get_filename() const {
+        return working_directory + "/" + ConfigurationFile;
+    }
+
     void Configuration::load() {
         ScopeMutex lock(&mtx);
 
-        std::string filename = working_directory + "/";
-        filename += ConfigurationFile;
+        Entries read_entries;
+        read_file(read_entries);
+        for (Entries::iterator it = read_entries.begin(); it != read_entries.end(); it++) {
+            entries[it->first] = it->second;
+        }
+        file_entries = read_entries;
+
+        for (Handles::iterator it = handles.begin(); it != handles.end(); it = handles.upper_bound(it->first)) {
+            update_handles_nolock(it->first);
+        }
+    }
+
+    size_t Configuration::reload() {
+        typedef std::vector<std::pair<std::string, std::string> > Changes;
+
+        Changes changes;
+        {
+            ScopeMutex lock(&mtx);
+
+            /* a half written file throws here and the old values stay */
+            Entries read_entries;
+            read_file(read_entries);
+
+            /* only keys, which differ from the last loaded or saved */
+            /* file, are taken. unsaved changes of others are kept.  */
+            for (Entries::iterator it = read_entries.begin(); it != read_entries.end(); it++) {
+                Entries::iterator old = file_entries.find(it->first);
+                if (old == file_entries.end() || old->second != it->second) {
+                    changes.push_back(Changes::value_type(it->first, it->second));
+                }
+            }
+            for (Entries::iterator it = file_entries.begin(); it != file_entries.end(); it++) {
+                if (read_entries.find(it->first) == read_entries.end()) {
+                    changes.push_back(Changes::value_type(it->first, ""));
+                }
+            }
+            file_entries = read_entries;
+
+            bool was_modified = modified;
+            for (Changes::iterator it = changes.begin(); it != changes.end(); ) {
+                size_t pos = it->first.find('.');
+                try {
+                    if (pos == std::string::npos) {
+                        throw ConfigurationException("Missing category.");
+                    }
+                    set_value_nolock(it->first.substr(0, pos), it->first.substr(pos + 1), it->second);
+                    it++;
+                } catch (const ConfigurationException&) {
+                    /* skip invalid names, someone edited the file by hand */
+                    it = changes.erase(it);
+                }
+            }
+            modified = was_modified;
+        }
+
+        for (Changes::iterator it = changes.begin(); it != changes.end(); it++) {
+            size_t pos = it->first.find('.');
+            notify_listeners(it->first.substr(0, pos), it->first.substr(pos + 1), it->second);
+        }
+
+        return changes.size();
+    }
 
+    void Configuration::read_file(Entries& read_entries) {
+        std::string filename = get_filename();
         std::ifstream f(filename.c_str());
 
         if (f.is_open()) {
@@ -72,7 +175,7 @@ namespace Circada {
                 if (line.length()) {
                     size_t pos = line.find('=');
                     if (pos != std::string::npos) {
-                        entries[line.substr(0, pos)] = line.substr(pos + 1);
+                        read_entries[line.substr(0, pos)] = line.substr(pos + 1);
                     } else {
                         throw ConfigurationException("Malformed expression in configuration file.");
                     }
@@ -85,9 +188,7 @@ namespace Circada {
         ScopeMutex lock(&mtx);
 
         if (modified) {
-            std::string filename = working_directory + "/";
-            filename += ConfigurationFile;
-
+            std::string filename = get_filename();
             std::ofstream f(filename.c_str());
             if (!f.is_open()) {
                 throw ConfigurationException("Cannot open file for writing: " + filename);
@@ -97,13 +198,18 @@ namespace Circada {
                 f << it->first << "=" << it->second << std::endl;
             }
 
+            file_entries = entries;
             modified = false;
         }
     }
 
     void Configuration::set_value(const std::string& category, const std::string& key, const std::string& value) {
-        ScopeMutex lock(&mtx);
-        set_value_nolock(category, key, value);
+        {
+            ScopeMutex lock(&mtx);
+            set_value_nolock(category, key, value);
+        }
+
+        notify_listeners(category, key, value);
     }
 
     const std::string& Configuration::get_value(const std::string& category, const std::string& key) const {
@@ -129,6 +235,21 @@ namespace Circada {
         return entries;
     }
 
+    void Configuration::add_listener(ConfigurationListener *listener) {
+        ScopeMutex lock(&listener_mtx);
+        listeners.push_back(listener);
+    }
+
+    void Configuration::remove_listener(ConfigurationListener *listener) {
+        ScopeMutex lock(&listener_mtx);
+        for (Listeners::iterator it = listeners.begin(); it != listeners.end(); it++) {
+            if (*it == listener) {
+                listeners.erase(it);
+                break;
+            }
+        }
+    }
+
     void Configuration::validation(const std::string& s) {
         static std::string allowed_characters("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_");
 
@@ -144,16 +265,55 @@ namespace Circada {
         validation(category);
         validation(key);
 
+        std::string name(category + "." + key);
         if (value.length()) {
-            entries[category + "." + key] = value;
+            entries[name] = value;
             modified = true;
         } else {
-            Entries::iterator it = entries.find(category + "." + key);
+            Entries::iterator it = entries.find(name);
             if (it != entries.end()) {
                 entries.erase(it);
                 modified = true;
             }
         }
+        update_handles_nolock(name);
+    }
+
+    void Configuration::update_handles_nolock(const std::string& name) {
+        std::pair<Handles::iterator, Handles::iterator> range = handles.equal_range(name);
+        if (range.first != range.second) {
+            Entries::const_iterator entry = entries.find(name);
+            for (Handles::iterator it = range.first; it != range.second; it++) {
+                ConfigurationHandle *handle = it->second;
+                handle->update(entry != entries.end() ? entry->second : handle->get_defaults());
+            }
+        }
+    }
+
+    void Configuration::notify_listeners(const std::string& category, const std::string& key, const std::string& value) {
+        /* the listeners may read the configuration again */
+        ScopeMutex lock(&listener_mtx);
+        for (Listeners::iterator it = listeners.begin(); it != listeners.end(); it++) {
+            (*it)->configuration_changed(category, key, value);
+        }
+    }
+
+    void Configuration::attach_handle(ConfigurationHandle *handle) {
+        ScopeMutex lock(&mtx);
+        handles.insert(Handles::value_type(handle->get_name(), handle));
+        Entries::const_iterator entry = entries.find(handle->get_name());
+        handle->update(entry != entries.end() ? entry->second : handle->get_defaults());
+    }
+
+    void Configuration::detach_handle(ConfigurationHandle *handle) {
+        ScopeMutex lock(&mtx);
+        std::pair<Handles::iterator, Handles::iterator> range = handles.equal_range(handle->get_name());
+        for (Handles::iterator it = range.first; it != range.second; it++) {
+            if (it->second == handle) {
+                handles.erase(it);
+                break;
+            }
+        }
     }
 
 } /* namespace Circada */
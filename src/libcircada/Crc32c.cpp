@@ -0,0 +1,152 @@
+/*
+ *  Crc32c.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/Crc32c.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define CIRCADA_CRC32C_HW 1
+#endif
+
+namespace {
+
+    using Circada::u32;
+    using Circada::u64;
+
+    const u32 Polynomial = 0x82f63b78;
+
+    /* slicing by 8 tables */
+    struct Crc32cTables {
+        u32 t[8][256];
+
+        Crc32cTables() {
+            for (u32 i = 0; i < 256; i++) {
+                u32 crc = i;
+                for (int j = 0; j < 8; j++) {
+                    crc = (crc >> 1) ^ (crc & 1 ? Polynomial : 0);
+                }
+                t[0][i] = crc;
+            }
+            for (u32 i = 0; i < 256; i++) {
+                for (int j = 1; j < 8; j++) {
+                    t[j][i] = (t[j - 1][i] >> 8) ^ t[0][t[j - 1][i] & 0xff];
+                }
+            }
+        }
+    };
+
+    const Crc32cTables tables;
+
+    u32 update_sw(u32 crc, const unsigned char *p, size_t length) {
+        while (length && (reinterpret_cast<size_t>(p) & 7)) {
+            crc = (crc >> 8) ^ tables.t[0][(crc ^ *p++) & 0xff];
+            length--;
+        }
+        while (length >= 8) {
+            u64 v;
+            memcpy(&v, p, sizeof(v));
+            /* little endian only, checked by the caller */
+            v ^= crc;
+            crc = tables.t[7][v & 0xff] ^ tables.t[6][(v >> 8) & 0xff] ^
+                  tables.t[5][(v >> 16) & 0xff] ^ tables.t[4][(v >> 24) & 0xff] ^
+                  tables.t[3][(v >> 32) & 0xff] ^ tables.t[2][(v >> 40) & 0xff] ^
+                  tables.t[1][(v >> 48) & 0xff] ^ tables.t[0][v >> 56];
+            p += 8;
+            length -= 8;
+        }
+        while (length--) {
+            crc = (crc >> 8) ^ tables.t[0][(crc ^ *p++) & 0xff];
+        }
+
+        return crc;
+    }
+
+    u32 update_bytewise(u32 crc, const unsigned char *p, size_t length) {
+        while (length--) {
+            crc = (crc >> 8) ^ tables.t[0][(crc ^ *p++) & 0xff];
+        }
+
+        return crc;
+    }
+
+#ifdef CIRCADA_CRC32C_HW
+    __attribute__((target("sse4.2")))
+    u32 update_hw(u32 crc, const unsigned char *p, size_t length) {
+        u64 crc64 = crc;
+        while (length && (reinterpret_cast<size_t>(p) & 7)) {
+            crc64 = _mm_crc32_u8(static_cast<u32>(crc64), *p++);
+            length--;
+        }
+        while (length >= 8) {
+            u64 v;
+            memcpy(&v, p, sizeof(v));
+            crc64 = _mm_crc32_u64(crc64, v);
+            p += 8;
+            length -= 8;
+        }
+        while (length--) {
+            crc64 = _mm_crc32_u8(static_cast<u32>(crc64), *p++);
+        }
+
+        return static_cast<u32>(crc64);
+    }
+#endif
+
+    typedef u32 (*UpdateFunction)(u32 crc, const unsigned char *p, size_t length);
+
+    UpdateFunction select_update() {
+#ifdef CIRCADA_CRC32C_HW
+        if (__builtin_cpu_supports("sse4.2")) {
+            return &update_hw;
+        }
+#endif
+        u32 probe = 1;
+        if (*reinterpret_cast<unsigned char *>(&probe) == 1) {
+            return &update_sw;
+        }
+
+        return &update_bytewise;
+    }
+
+    const UpdateFunction update_function = select_update();
+
+}
+
+namespace Circada {
+
+    Crc32c::Crc32c() : crc(0) { }
+
+    Crc32c::~Crc32c() { }
+
+    void Crc32c::reset(u32 value) {
+        crc = value;
+    }
+
+    void Crc32c::update(const void *data, size_t length) {
+        crc = ~update_function(~crc, static_cast<const unsigned char *>(data), length);
+    }
+
+    u32 Crc32c::get_value() const {
+        return crc;
+    }
+
+} /* namespace Circada */
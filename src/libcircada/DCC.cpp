@@ -27,6 +27,8 @@
 #include <cstring>
 #include <cerrno>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -41,13 +43,28 @@ namespace Circada {
      *  -> out is incoming, the opposite is offering, we have to connect.
      */
 
+    /* the receiver acknowledges the received bytes modulo 2^32. */
+    /* rebuild the 64 bit position from the last known one.      */
+    static u64 extend_acknowledge(u64 last, u32 ack) {
+        u64 position = (last & ~static_cast<u64>(0xffffffff)) | ack;
+        if (position < last && last - position > 0x7fffffff) {
+            position += static_cast<u64>(1) << 32;
+        }
+
+        return position;
+    }
+
     /**************************************************************************
      * DCCIO
      **************************************************************************/
-    DCCIO::DCCIO(DCCDirection direction, unsigned long address, unsigned short port)
-        : iorunning(true), timeout(300), direction(direction), address(address), port(port) { }
+    DCCIO::DCCIO(DCCListenerPool& listeners, DCCDirection direction, unsigned long address, unsigned short port)
+        : timeout(300), listeners(listeners), direction(direction), address(address), port(port),
+          peer_address(0), mode(ConnectModeWait), attached(false), connecting(false) { }
 
-    DCCIO::~DCCIO() { }
+    DCCIO::~DCCIO() {
+        listeners.release(this);
+        socket.close();
+    }
 
     unsigned long DCCIO::get_address() const {
         return address;
@@ -69,8 +86,111 @@ namespace Circada {
         timeout = s;
     }
 
-    void DCCIO::stop() {
-        iorunning = false;
+    int DCCIO::get_timeout() const {
+        return timeout;
+    }
+
+    const std::string& DCCIO::get_token() const {
+        return token;
+    }
+
+    void DCCIO::set_token(const std::string& token) {
+        this->token = token;
+    }
+
+    unsigned long DCCIO::get_peer_address() const {
+        return peer_address;
+    }
+
+    void DCCIO::set_peer_address(unsigned long peer_address) {
+        this->peer_address = peer_address;
+    }
+
+    bool DCCIO::is_waiting() const {
+        ScopeMutex lock(&mtx);
+        return (mode == ConnectModeWait);
+    }
+
+    void DCCIO::listen() {
+        /* the pool may attach a connection before we return */
+        unsigned short listen_port;
+        try {
+            listen_port = listeners.acquire(this, peer_address);
+        } catch (const Exception& e) {
+            throw DCCException(e.what());
+        }
+        ScopeMutex lock(&mtx);
+        set_port(listen_port);
+        mode = ConnectModeListen;
+    }
+
+    void DCCIO::connect_to(unsigned long address, unsigned short port) {
+        ScopeMutex lock(&mtx);
+        set_address(address);
+        set_port(port);
+        mode = ConnectModeConnect;
+    }
+
+    void DCCIO::attach(int fd) {
+        ScopeMutex lock(&mtx);
+        try {
+            socket.attach(fd);
+            attached = true;
+        } catch (const SocketException&) {
+            ::close(fd);
+        }
+    }
+
+    void DCCIO::connect_start() {
+        /* called again on every poller round until the connect is under way */
+        ScopeMutex lock(&mtx);
+        if (mode == ConnectModeConnect && !connecting) {
+            try {
+                char addr[128];
+                unsigned int address = get_address();
+                inet_ntop(AF_INET, &address, addr, sizeof(addr));
+                socket.connect_nonblocking(addr, get_port());
+                connecting = true;
+            } catch (const SocketException& e) {
+                throw DCCException(e.what());
+            }
+        }
+    }
+
+    bool DCCIO::connect_continue() {
+        ScopeMutex lock(&mtx);
+        try {
+            if (mode == ConnectModeConnect) {
+                socket.finish_connect();
+            } else {
+                socket.set_nonblocking(true);
+            }
+        } catch (const SocketException& e) {
+            throw DCCException(e.what());
+        }
+
+        return true;
+    }
+
+    int DCCIO::get_connect_fd() const {
+        ScopeMutex lock(&mtx);
+        return socket.get_fd();
+    }
+
+    short DCCIO::get_connect_events() const {
+        ScopeMutex lock(&mtx);
+        switch (mode) {
+            case ConnectModeListen:
+                return (attached ? POLLOUT : 0);
+
+            case ConnectModeConnect:
+                return (connecting ? POLLOUT : 0);
+
+            default:
+                break;
+        }
+
+        return 0;
     }
 
     void DCCIO::set_port(unsigned short port) {
@@ -86,7 +206,7 @@ namespace Circada {
      **************************************************************************/
     DCC::DCC(Session *s, DCCManager& mgr, DCCIO& io, DCCType type, const std::string& nick)
         : mgr(mgr), s(s), io(io), type(type), my_nick(s->get_nick()), his_nick(nick),
-          running(false), connected(false), will_be_killed(false) { }
+          running(false), connected(false), will_be_killed(false), deadline(-1) { }
 
     DCC::~DCC() { }
 
@@ -145,45 +265,102 @@ namespace Circada {
     void DCC::start() {
         if (!running) {
             running = true;
-            if (!thread_start()) {
-                throw DCCException("Starting thread failed.");
-            }
+            mgr.get_poller().add(this);
         }
     }
 
     void DCC::stop() {
-        if (running) {
-            running = false;
-            try {
-                io.stop();
-                io.get_socket().close();
-            } catch (const DCCException& e) {
-                /* chomp */
-            }
-            thread_join();
+        /* the poller skips stopped dccs, the sockets */
+        /* are closed when the dcc is disposed.       */
+        running = false;
+    }
+
+    short DCC::get_poll_events() {
+        if (!running) {
+            return 0;
         }
+
+        return (connected ? get_transfer_events() : io.get_connect_events());
+    }
+
+    int DCC::get_poll_fd() {
+        return (connected ? io.get_socket().get_fd() : io.get_connect_fd());
+    }
+
+    long DCC::get_deadline() const {
+        if (!running) {
+            return -1;
+        }
+
+        return (connected ? get_transfer_deadline() : deadline);
+    }
+
+    void DCC::handle_start() {
+        dispatch(DispatchStart, 0, 0);
+    }
+
+    void DCC::handle_events(short revents) {
+        dispatch(DispatchEvents, revents, 0);
     }
 
-    void DCC::thread() {
+    void DCC::handle_timer(long now) {
+        dispatch(DispatchTimer, 0, now);
+    }
+
+    void DCC::dispatch(DispatchType type, short revents, long now) {
+        if (!running) {
+            return;
+        }
+
         try {
-            int to = atoi(mgr.get_configuration().get_value("", "dcc_timeout", "300").c_str());
-            io.set_timeout(to);
-            io.connect();
-            connected = true;
-            begin_handler();
-            while (running) {
-                process_or_idle();
+            switch (type) {
+                case DispatchStart:
+                {
+                    int to = mgr.get_timeout();
+                    io.set_timeout(to);
+                    deadline = DCCPoller::get_monotonic_ms() + static_cast<long>(to) * 1000;
+                    io.connect_start();
+                    break;
+                }
+
+                case DispatchEvents:
+                    if (revents & POLLNVAL) {
+                        throw DCCException("Connection lost.");
+                    }
+                    if (!connected) {
+                        if (io.connect_continue()) {
+                            connected = true;
+                            begin_handler();
+                        }
+                    } else {
+                        process_events(revents);
+                    }
+                    break;
+
+                case DispatchTimer:
+                    if (!connected) {
+                        if (now >= deadline) {
+                            throw DCCTimedoutException();
+                        }
+                        /* a passive dcc may have got its peer address */
+                        io.connect_start();
+                    } else {
+                        process_timer(now);
+                    }
+                    break;
+            }
+            if (connected && !running) {
+                connected = false;
+                end_handler();
             }
-            connected = false;
-            end_handler();
         } catch (const DCCTimedoutException& e) {
-            connected = false;
+            connected = running = false;
             mgr.dcc_mgr_timedout(this, e.what());
         } catch (const DCCChatStoppedException& e) {
-            connected = false;
+            connected = running = false;
             mgr.dcc_mgr_chat_ended(this, e.what());
         } catch (const DCCException& e) {
-            connected = false;
+            connected = running = false;
             mgr.dcc_mgr_failed(this, e.what());
         }
     }
@@ -191,60 +368,25 @@ namespace Circada {
     /**************************************************************************
      * DCCIn
      **************************************************************************/
-    DCCIn::DCCIn()
-        : DCCIO(DCCDirectionIncoming, 0, 0), listening(false)
-    {
-        socket.listen(0);
-        try {
-            set_port(socket.get_port());
-            set_address(socket.get_address());
-        } catch (const SocketException& e) {
-            throw DCCException(e.what());
-        }
-    }
+    DCCIn::DCCIn(DCCListenerPool& listeners)
+        : DCCIO(listeners, DCCDirectionIncoming, 0, 0) { }
 
     DCCIn::~DCCIn() { }
 
-    void DCCIn::connect() {
-        try {
-            int timeout_counter = 0;
-            while (iorunning) {
-                if (timeout_counter >= timeout * 10) {
-                    throw DCCTimedoutException();
-                }
-                if (socket.activity(0, 100000)) {
-                    socket.accept(socket);
-                    break;
-                }
-                timeout_counter++;
-            }
-            if (!iorunning) {
-                throw DCCException("Operation aborted.");
-            }
-        } catch (const SocketException& e) {
-            throw DCCException(e.what());
-        }
-    }
-
     /**************************************************************************
      * DCCOut
      **************************************************************************/
-    DCCOut::DCCOut(unsigned long address, unsigned short port)
-        : DCCIO(DCCDirectionOutgoing, address, port) { }
-
-    DCCOut::~DCCOut() { }
-
-    void DCCOut::connect() {
-        try {
-            char addr[128];
-            unsigned int address = get_address();
-            inet_ntop(AF_INET, &address, addr, sizeof(addr));
-            socket.connect(addr, get_port());
-        } catch (const SocketException& e) {
-            throw DCCException(e.what());
+    DCCOut::DCCOut(DCCListenerPool& listeners, unsigned long address, unsigned short port)
+        : DCCIO(listeners, DCCDirectionOutgoing, address, port)
+    {
+        /* port 0 is a passive offer, we listen when it is accepted */
+        if (port) {
+            connect_to(address, port);
         }
     }
 
+    DCCOut::~DCCOut() { }
+
     /**************************************************************************
      * DCCChat
      **************************************************************************/
@@ -257,10 +399,20 @@ namespace Circada {
         mgr.dcc_mgr_chat_begins(this);
     }
 
-    void DCCChat::process_or_idle() {
+    short DCCChat::get_transfer_events() {
+        ScopeMutex lock(&out_mtx);
+        return POLLIN | (out_buffer.length() ? POLLOUT : 0);
+    }
+
+    void DCCChat::process_events(short revents) {
         try {
             Socket& socket = get_dccio().get_socket();
-            if (socket.activity(0, 100000)) {
+            if (revents & POLLOUT) {
+                ScopeMutex lock(&out_mtx);
+                size_t sz = socket.send(out_buffer);
+                out_buffer.erase(0, sz);
+            }
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
                 LineFetcher::Lines lines;
                 fetcher.fetch(socket, lines);
                 for (LineFetcher::Lines::iterator it = lines.begin(); it != lines.end(); it++) {
@@ -280,31 +432,31 @@ namespace Circada {
                     mgr.dcc_mgr_message(this, get_his_nick(), ctcp, line);
                 }
             }
-        } catch (const SocketException& e) {
+        } catch (const Exception& e) {
             throw DCCChatStoppedException(e.what());
         }
     }
 
     void DCCChat::send(const std::string& msg) {
-        try {
-            Socket& socket = get_dccio().get_socket();
-            socket.send(msg + "\r\n");
-        } catch (const SocketException& e) {
-            throw DCCException(e.what());
-        }
+        /* the poller writes the buffer as soon as the socket is ready */
+        ScopeMutex lock(&out_mtx);
+        out_buffer += msg + "\r\n";
+        mgr.get_poller().wakeup();
     }
 
     /**************************************************************************
      * DCCXfer
      **************************************************************************/
     DCCXfer::DCCXfer(Session *s, DCCManager& mgr, DCCIO& io, const std::string& nick,
-          const std::string& filename, u32 filesize)
+          const std::string& filename, u64 filesize)
         : DCC(s, mgr, io, DCCTypeXfer, nick), filename(filename), filesize(filesize),
-          startpos(0), state(XferStateStart), f(0), successful(false) { }
+          startpos(0), state(XferStateStart), fd(-1), successful(false), turbo(false),
+          total_acknowledged(0), own_limit(false), priority(DCCPriorityNormal), priority_changed(false), throttled_until(-1),
+          queued(false), admitted(false) { }
 
     DCCXfer::~DCCXfer() {
-        if (f) {
-            fclose(f);
+        if (fd >= 0) {
+            ::close(fd);
         }
     }
 
@@ -322,23 +474,113 @@ namespace Circada {
         return filename;
     }
 
-    void DCCXfer::set_resume_position(u32 startpos) {
+    void DCCXfer::set_resume_position(u64 startpos) {
         this->startpos = startpos;
     }
 
-    u32 DCCXfer::get_total_acknownledged() const {
+    u64 DCCXfer::get_total_acknownledged() const {
         return total_acknowledged;
     }
 
-    u32 DCCXfer::get_filesize() const {
+    u64 DCCXfer::get_filesize() const {
         return filesize;
     }
 
+    u32 DCCXfer::get_checksum() const {
+        return checksum.get_value();
+    }
+
+    TokenBucket& DCCXfer::get_bucket() {
+        return bucket;
+    }
+
+    void DCCXfer::set_priority(DCCPriority priority) {
+        if (priority != this->priority) {
+            this->priority = priority;
+            priority_changed = true;
+            mgr.get_poller().wakeup();
+        }
+    }
+
+    void DCCXfer::set_own_limit(bool state) {
+        own_limit = state;
+    }
+
+    bool DCCXfer::has_own_limit() const {
+        return own_limit;
+    }
+
+    DCCPriority DCCXfer::get_priority() const {
+        return priority;
+    }
+
+    void DCCXfer::set_queued(bool state) {
+        queued = state;
+    }
+
+    bool DCCXfer::is_queued() const {
+        return queued;
+    }
+
+    void DCCXfer::set_admitted(bool state) {
+        admitted = state;
+    }
+
+    bool DCCXfer::is_admitted() const {
+        return admitted;
+    }
+
+    void DCCXfer::set_turbo(bool state) {
+        turbo = state;
+    }
+
+    bool DCCXfer::is_turbo() const {
+        return turbo;
+    }
+
+    bool DCCXfer::is_throttled() const {
+        return (throttled_until >= 0);
+    }
+
+    u64 DCCXfer::get_bandwidth(u64 want) {
+        long ready_at;
+        u64 granted = mgr.get_bandwidth(this, want, DCCPoller::get_monotonic_ms(), ready_at);
+        if (!granted) {
+            /* sleep until the buckets are refilled */
+            throttled_until = ready_at;
+        }
+
+        return granted;
+    }
+
+    void DCCXfer::consume_bandwidth(u64 bytes) {
+        if (bytes) {
+            mgr.consume_bandwidth(this, bytes);
+        }
+    }
+
+    void DCCXfer::update_traffic_class() {
+        if (priority_changed) {
+            priority_changed = false;
+            get_dccio().get_socket().set_bulk(priority == DCCPriorityBulk);
+        }
+    }
+
+    long DCCXfer::get_transfer_deadline() const {
+        return throttled_until;
+    }
+
+    void DCCXfer::process_timer(long now) {
+        if (throttled_until >= 0 && now >= throttled_until) {
+            throttled_until = -1;
+        }
+    }
+
     /**************************************************************************
      * DCCChatIn
      **************************************************************************/
     DCCChatIn::DCCChatIn(Session *s, DCCManager& mgr, const std::string& nick)
-        : DCCChat(s, mgr, static_cast<DCCIO&>(*this), nick), DCCIn() { }
+        : DCCChat(s, mgr, static_cast<DCCIO&>(*this), nick), DCCIn(mgr.get_poller().get_listeners()) { }
 
     DCCChatIn::~DCCChatIn() { }
 
@@ -347,67 +589,145 @@ namespace Circada {
      **************************************************************************/
     DCCChatOut::DCCChatOut(Session *s, DCCManager& mgr, const std::string& nick,
           unsigned long address, unsigned short port)
-        : DCCChat(s, mgr, static_cast<DCCIO&>(*this), nick), DCCOut(address, port) { }
+        : DCCChat(s, mgr, static_cast<DCCIO&>(*this), nick), DCCOut(mgr.get_poller().get_listeners(), address, port) { }
 
     DCCChatOut::~DCCChatOut() { }
 
     /**************************************************************************
      * DCCXferIn
      **************************************************************************/
-    DCCXferIn::DCCXferIn(Session *s, DCCManager& mgr, const std::string& nick, const std::string& filename, u32 filesize)
-        : DCCXfer(s, mgr, static_cast<DCCIO&>(*this), nick, filename, filesize), DCCIn() { }
+    DCCXferIn::DCCXferIn(Session *s, DCCManager& mgr, const std::string& nick, const std::string& filename, u64 filesize)
+        : DCCXfer(s, mgr, static_cast<DCCIO&>(*this), nick, filename, filesize), DCCIn(mgr.get_poller().get_listeners()),
+          total_sent(0), ack(0), ack_read(0), hashed(0) { }
 
     DCCXferIn::~DCCXferIn() { }
 
-    u32 DCCXferIn::get_total_sent() const {
+    u64 DCCXferIn::get_total_sent() const {
         return total_sent;
     }
 
-    void DCCXferIn::process_or_idle() {
+    void DCCXferIn::update_checksum(u64 upto) {
+        /* sendfile never shows us the data, read it back from the page  */
+        /* cache. pread reports a truncated file, a mapping would fault. */
+        char buffer[HashBufferLength];
+        while (hashed < upto) {
+            size_t count = (upto - hashed > HashBufferLength ? HashBufferLength : static_cast<size_t>(upto - hashed));
+            ssize_t rv = pread(fd, buffer, count, static_cast<off_t>(hashed));
+            if (rv < 0 && errno == EINTR) {
+                continue;
+            }
+            if (rv <= 0) {
+                throw DCCException("Cannot read file: " + filename);
+            }
+            checksum.update(buffer, rv);
+            hashed += rv;
+        }
+    }
+
+    u64 DCCXferIn::get_hash_target() const {
+        /* after an early full acknowledge, the rest is hashed unsent */
+        return (total_acknowledged >= filesize ? filesize : total_sent);
+    }
+
+    short DCCXferIn::get_transfer_events() {
+        if (state == XferStateStart) {
+            return POLLOUT;
+        }
+
+        bool sending = (total_acknowledged < filesize && total_sent < filesize && !is_throttled());
+        return POLLIN | (sending || hashed < get_hash_target() ? POLLOUT : 0);
+    }
+
+    void DCCXferIn::process_events(short revents) {
         try {
+            update_traffic_class();
             switch (state) {
                 case XferStateStart:
                 {
-                    f = fopen(filename.c_str(), "rb");
-                    if (!f) {
+                    fd = open(filename.c_str(), O_RDONLY);
+                    if (fd < 0) {
                         throw DCCException("Cannot open file for reading: " + filename);
                     }
+#ifdef POSIX_FADV_SEQUENTIAL
+                    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+                    int buffer_size = mgr.get_socket_buffer();
+                    socket.set_buffer_sizes(buffer_size);
                     total_sent = startpos;
-                    total_size_read = 0;
+                    total_acknowledged = startpos;
                     mgr.dcc_mgr_send_progress(this, total_sent, filesize);
                     last_time = time(0);
                     state = XferStateTransfer;
                     break;
                 }
 
+                case XferStateVerify:
+                    /* only the receiver verifies a resume */
+                    break;
+
                 case XferStateTransfer:
                 {
-                    /* send chunk to client */
-                    if (total_sent < filesize) {
-                        fseek(f, total_sent, SEEK_SET);
-                        size_t sz_to_send = fread(buffer, 1, BufferLength, f);
-                        total_sent += static_cast<uint32_t>(socket.send(buffer, sz_to_send));
+                    /* send as much as the socket takes */
+                    if ((revents & POLLOUT) && total_acknowledged < filesize && total_sent < filesize) {
+                        off_t offset = total_sent;
+                        size_t count = filesize - total_sent;
+                        if (count > SendChunkLength) {
+                            count = SendChunkLength;
+                        }
+                        count = static_cast<size_t>(get_bandwidth(count));
+                        if (count) {
+                            if (!socket.send_file(fd, offset, count) && offset == static_cast<off_t>(total_sent)) {
+                                if (lseek(fd, 0, SEEK_END) <= offset) {
+                                    throw DCCException("File has been truncated while sending: " + filename);
+                                }
+                            }
+                            consume_bandwidth(static_cast<u64>(offset) - total_sent);
+                            total_sent = static_cast<u64>(offset);
+                        }
+                        if (turbo) {
+                            /* the receiver does not acknowledge in turbo mode */
+                            total_acknowledged = total_sent;
+                        }
                     }
+
                     /* get total received */
-                    while (socket.activity(0, 1)) {
-                        char *sz_buf = reinterpret_cast<char *>(&total_acknowledged);
-                        void *v = static_cast<void *>(&sz_buf[total_size_read]);
-                        total_size_read = socket.receive(v, sizeof(u32) - total_size_read);
-                        /* finished */
-                        if (total_size_read >= sizeof(u32)) {
-                            total_size_read = 0;
-                            total_acknowledged = ntohl(total_acknowledged);
-                            if (total_acknowledged >= filesize) {
-                                successful = true;
-                                mgr.dcc_mgr_send_progress(this, total_acknowledged, filesize);
-                                finished();
-                            } else {
-                                time_t current_time = time(0);
-                                if (current_time != last_time) {
-                                    last_time = current_time;
-                                    mgr.dcc_mgr_send_progress(this, total_acknowledged, filesize);
+                    if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                        char *ack_buf = reinterpret_cast<char *>(&ack);
+                        size_t sz;
+                        try {
+                            while ((sz = socket.receive(&ack_buf[ack_read], sizeof(u32) - ack_read)) > 0) {
+                                ack_read += sz;
+                                if (ack_read >= sizeof(u32)) {
+                                    ack_read = 0;
+                                    total_acknowledged = extend_acknowledge(total_acknowledged, ntohl(ack));
                                 }
                             }
+                        } catch (const SocketException& e) {
+                            /* the receiver may close right after its last acknowledge */
+                            if (total_acknowledged < filesize) {
+                                throw;
+                            }
+                        }
+                    }
+
+                    /* hash a bounded step per wakeup, so a resumed prefix or */
+                    /* an early acknowledge never stalls the other transfers. */
+                    u64 target = get_hash_target();
+                    if (hashed < target) {
+                        u64 upto = hashed + HashStepLength;
+                        update_checksum(upto < target ? upto : target);
+                    }
+
+                    /* finished? */
+                    if (total_acknowledged >= filesize && hashed >= filesize) {
+                        successful = true;
+                        mgr.dcc_mgr_send_progress(this, total_acknowledged, filesize);
+                        finished();
+                    } else {
+                        time_t current_time = time(0);
+                        if (current_time != last_time) {
+                            last_time = current_time;
+                            mgr.dcc_mgr_send_progress(this, total_acknowledged, filesize);
                         }
                     }
                     break;
@@ -422,13 +742,163 @@ namespace Circada {
      * DCCXferOut
      **************************************************************************/
     DCCXferOut::DCCXferOut(Session *s, DCCManager& mgr, const std::string& nick,
-          const std::string& filename, u32 filesize, unsigned long address, unsigned short port)
-        : DCCXfer(s, mgr, static_cast<DCCIO&>(*this), nick, filename, filesize), DCCOut(address, port) { }
+          const std::string& filename, u64 filesize, unsigned long address, unsigned short port)
+        : DCCXfer(s, mgr, static_cast<DCCIO&>(*this), nick, filename, filesize), DCCOut(mgr.get_poller().get_listeners(), address, port),
+          part_fd(-1), last_acknowledged(0), write_buffer(0), write_buffer_used(0), write_offset(0),
+          verify_offset(0), part_offset(0), part_checksum(0), resume_checksum(0) { }
 
-    DCCXferOut::~DCCXferOut() { }
+    DCCXferOut::~DCCXferOut() {
+        if (write_buffer) {
+            try {
+                flush();
+            } catch (const Exception& e) {
+                /* chomp */
+            }
+            free(write_buffer);
+        }
+        if (part_fd >= 0) {
+            ::close(part_fd);
+        }
+    }
 
-    void DCCXferOut::process_or_idle() {
+    bool DCCXferOut::read_part_checksum(const std::string& part_filename, u64& offset, u32& checksum) {
+        FILE *f = fopen(part_filename.c_str(), "r");
+        if (!f) {
+            return false;
+        }
+        unsigned long long o;
+        unsigned int c;
+        bool valid = (fscanf(f, "crc32c %llu %x", &o, &c) == 2);
+        fclose(f);
+        if (valid) {
+            offset = static_cast<u64>(o);
+            checksum = static_cast<u32>(c);
+        }
+
+        return valid;
+    }
+
+    short DCCXferOut::get_transfer_events() {
+        if (state == XferStateStart || state == XferStateVerify) {
+            return POLLOUT;
+        }
+
+        /* a throttled receiver lets tcp slow down the sender */
+        return (is_throttled() ? 0 : POLLIN);
+    }
+
+    void DCCXferOut::flush() {
+        size_t written = 0;
+        while (written < write_buffer_used) {
+            ssize_t rv = pwrite(fd, write_buffer + written, write_buffer_used - written, write_offset + written);
+            if (rv < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw DCCException("Cannot write file: " + filename + " (" + std::string(strerror(errno)) + ")");
+            }
+            written += rv;
+        }
+#ifdef SYNC_FILE_RANGE_WRITE
+        /* start the writeback now, but do not wait for it */
+        if (written) {
+            sync_file_range(fd, write_offset, written, SYNC_FILE_RANGE_WRITE);
+        }
+#endif
+        write_offset += written;
+        write_buffer_used = 0;
+        if (written) {
+            write_part_checksum();
+        }
+    }
+
+    void DCCXferOut::write_part_checksum() {
+        /* fixed length record, always overwritten in place */
+        char buffer[64];
+        int len = sprintf(buffer, "crc32c %020llu %08x\n", static_cast<unsigned long long>(write_offset), checksum.get_value());
+        if (part_fd >= 0 && pwrite(part_fd, buffer, len, 0) != len) {
+            throw DCCException("Cannot write partial file: " + part_filename + " (" + std::string(strerror(errno)) + ")");
+        }
+    }
+
+    void DCCXferOut::begin_transfer() {
+        /* drop everything behind the verified resume position */
+        if (ftruncate(fd, static_cast<off_t>(startpos)) < 0) {
+            throw DCCException("Cannot truncate file: " + filename + " (" + std::string(strerror(errno)) + ")");
+        }
+#ifdef FALLOC_FL_KEEP_SIZE
+        /* reserve the space, but keep the file size, the */
+        /* resume position is taken from the file size.   */
+        if (filesize > startpos) {
+            fallocate(fd, FALLOC_FL_KEEP_SIZE, startpos, filesize - startpos);
+        }
+#endif
+        int buffer_size = mgr.get_socket_buffer();
+        socket.set_buffer_sizes(buffer_size);
+        total_acknowledged = startpos;
+        write_offset = startpos;
+        write_part_checksum();
+        mgr.dcc_mgr_receive_progress(this, total_acknowledged, filesize);
+        last_time = time(0);
+        state = XferStateTransfer;
+    }
+
+    void DCCXferOut::verify_part() {
+        /* rehash the written prefix, one buffer per wakeup. the checksum */
+        /* at the resume position is kept, the sender may go back a bit.  */
+        u64 count = part_offset - verify_offset;
+        if (count > WriteBufferLength) {
+            count = WriteBufferLength;
+        }
+        if (verify_offset < startpos && verify_offset + count > startpos) {
+            count = startpos - verify_offset;
+        }
+        if (count) {
+            ssize_t rv = pread(fd, write_buffer, static_cast<size_t>(count), static_cast<off_t>(verify_offset));
+            if (rv < 0 && errno == EINTR) {
+                return;
+            }
+            if (rv <= 0) {
+                remove(part_filename.c_str());
+                throw DCCException("Partial file is shorter than its checksum, restart the transfer: " + filename);
+            }
+            checksum.update(write_buffer, rv);
+            verify_offset += rv;
+        }
+        if (verify_offset == startpos) {
+            resume_checksum = checksum.get_value();
+        }
+        if (verify_offset == part_offset) {
+            if (checksum.get_value() != part_checksum) {
+                remove(part_filename.c_str());
+                throw DCCException("Partial file does not match its checksum, restart the transfer: " + filename);
+            }
+            checksum.reset(resume_checksum);
+            begin_transfer();
+        }
+    }
+
+    void DCCXferOut::send_acknowledge() {
+        /* the protocol only knows 32 bit, let it wrap */
+        u32 ack = htonl(static_cast<u32>(total_acknowledged & 0xffffffff));
+        socket.send(reinterpret_cast<const char *>(&ack), sizeof(u32));
+    }
+
+    void DCCXferOut::transfer_completed() {
+        flush();
+        successful = true;
+        ::close(part_fd);
+        part_fd = -1;
+        remove(part_filename.c_str());
+        if (last_acknowledged != total_acknowledged) {
+            mgr.dcc_mgr_receive_progress(this, total_acknowledged, filesize);
+        }
+        finished();
+    }
+
+    void DCCXferOut::process_events(short revents) {
         try {
+            update_traffic_class();
             switch (state) {
                 case XferStateStart:
                 {
@@ -436,6 +906,14 @@ namespace Circada {
                     part_filename = mgr.get_storage(mgr.get_part_filename(filename));
                     last_acknowledged = 0;
 
+                    /* a resume needs a checksum of the written prefix */
+                    if (startpos) {
+                        if (!read_part_checksum(part_filename, part_offset, part_checksum) || startpos > part_offset) {
+                            remove(part_filename.c_str());
+                            throw DCCException("Cannot verify partial file, restart the transfer: " + filename);
+                        }
+                    }
+
                     /* rename old existing file, if exists */
                     if (!file_exists(part_filename)) {
                         if (file_exists(outfile)) {
@@ -459,39 +937,68 @@ namespace Circada {
                     }
 
                     /* create partial file */
-                    f = fopen(part_filename.c_str(), "wb");
-                    if (!f) {
+                    part_fd = open(part_filename.c_str(), O_WRONLY | O_CREAT, 0644);
+                    if (part_fd < 0) {
                         throw DCCException("Cannot create partial file: " + part_filename +" (" + std::string(strerror(errno)) + ")");
                     }
-                    fclose(f);
-                    f = 0;
 
-                    /* open output file in append or in read/update mode */
-                    if (!file_exists(outfile)) {
-                        f = fopen(outfile.c_str(), "ab");
-                    } else {
-                        f = fopen(outfile.c_str(), "r+b");
-                    }
-                    if (!f) {
+                    /* open output file, data is written at the resume position */
+                    fd = open(outfile.c_str(), O_RDWR | O_CREAT, 0644);
+                    if (fd < 0) {
                         throw DCCException("Cannot open file for writing: " + outfile +" (" + std::string(strerror(errno)) + ")");
                     }
-                    total_acknowledged = startpos;
-                    fseek(f, total_acknowledged, SEEK_SET);
-                    mgr.dcc_mgr_receive_progress(this, total_acknowledged, filesize);
-                    last_time = time(0);
-                    state = XferStateTransfer;
+                    if (posix_memalign(reinterpret_cast<void **>(&write_buffer), WriteBufferAlignment, WriteBufferLength)) {
+                        write_buffer = 0;
+                        throw DCCException("Cannot allocate write buffer.");
+                    }
+                    if (startpos) {
+                        verify_offset = 0;
+                        state = XferStateVerify;
+                    } else {
+                        begin_transfer();
+                    }
+                    break;
+                }
+
+                case XferStateVerify:
+                {
+                    verify_part();
                     break;
                 }
 
                 case XferStateTransfer:
                 {
-                    /* get total received */
-                    if (socket.activity(0, 100000)) {
-                        size_t sz = socket.receive(buffer, BufferLength);
-                        if (filesize && total_acknowledged < filesize) {
-                            total_acknowledged += fwrite(buffer, 1, sz, f);
-                            *buffer = htonl(total_acknowledged);
-                            socket.send(buffer, sizeof(u32));
+                    /* drain the socket, at most one buffer per wakeup */
+                    if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                        size_t total = 0;
+                        size_t sz;
+                        do {
+                            if (write_buffer_used == WriteBufferLength) {
+                                flush();
+                            }
+                            sz = WriteBufferLength - write_buffer_used;
+                            if (filesize && sz > filesize - total_acknowledged) {
+                                /* bytes behind the announced size are not ours */
+                                sz = static_cast<size_t>(filesize - total_acknowledged);
+                            }
+                            sz = static_cast<size_t>(get_bandwidth(sz));
+                            if (sz) {
+                                sz = socket.receive(write_buffer + write_buffer_used, sz);
+                                checksum.update(write_buffer + write_buffer_used, sz);
+                                consume_bandwidth(sz);
+                            }
+                            write_buffer_used += sz;
+                            total_acknowledged += sz;
+                            total += sz;
+                        } while (sz && total < WriteBufferLength);
+
+                        /* one acknowledge per wakeup, none in turbo mode */
+                        if (total && !turbo) {
+                            send_acknowledge();
+                        }
+                        if (filesize && total_acknowledged >= filesize) {
+                            transfer_completed();
+                            break;
                         }
                     }
                     time_t current_time = time(0);
@@ -506,12 +1013,7 @@ namespace Circada {
         } catch (const SocketException& e) {
             /* sender closes socket, if file successfully transferred */
             if ((filesize && total_acknowledged >= filesize) || !filesize) {
-                successful = true;
-                remove(part_filename.c_str());
-                if (last_acknowledged != total_acknowledged) {
-                    mgr.dcc_mgr_receive_progress(this, total_acknowledged, filesize);
-                }
-                finished();
+                transfer_completed();
             } else {
                 throw DCCException(e.what());
             }
@@ -599,26 +1101,46 @@ namespace Circada {
         return dcc_xfer->get_filename();
     }
 
-    unsigned int DCCXferHandle::get_transferred_bytes() const {
+    u64 DCCXferHandle::get_transferred_bytes() const {
         ScopeMutex lock(&dcc_mgr.get_mutex());
         check_handle();
-        unsigned int sz = 0;
+        u64 sz = 0;
         if (dcc->get_dccio().get_direction() == DCCDirectionIncoming) {
             const DCCXferIn *dcc_xfer = static_cast<const DCCXferIn *>(dcc);
-            sz = static_cast<unsigned int>(dcc_xfer->get_total_sent());
+            sz = dcc_xfer->get_total_sent();
         } else {
-        const DCCXfer *dcc_xfer = static_cast<const DCCXfer *>(dcc);
-        sz = static_cast<unsigned int>(dcc_xfer->get_total_acknownledged());
+            const DCCXfer *dcc_xfer = static_cast<const DCCXfer *>(dcc);
+            sz = dcc_xfer->get_total_acknownledged();
         }
 
         return sz;
     }
 
-    unsigned int DCCXferHandle::get_filesize() const {
+    u64 DCCXferHandle::get_filesize() const {
         ScopeMutex lock(&dcc_mgr.get_mutex());
         check_handle();
         const DCCXfer *dcc_xfer = static_cast<const DCCXfer *>(dcc);
-        return static_cast<unsigned int>(dcc_xfer->get_filesize());
+        return dcc_xfer->get_filesize();
+    }
+
+    u32 DCCXferHandle::get_checksum() const {
+        ScopeMutex lock(&dcc_mgr.get_mutex());
+        check_handle();
+        const DCCXfer *dcc_xfer = static_cast<const DCCXfer *>(dcc);
+        return dcc_xfer->get_checksum();
+    }
+
+    bool DCCXferHandle::is_queued() const {
+        ScopeMutex lock(&dcc_mgr.get_mutex());
+        check_handle();
+        const DCCXfer *dcc_xfer = static_cast<const DCCXfer *>(dcc);
+        return dcc_xfer->is_queued();
+    }
+
+    size_t DCCXferHandle::get_queue_position() const {
+        ScopeMutex lock(&dcc_mgr.get_mutex());
+        check_handle();
+        return dcc_mgr.get_queue_position_nolock(dcc);
     }
 
 } /* namespace Circada */
@@ -0,0 +1,210 @@
+/*
+ *  DCCListenerPool.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/DCCListenerPool.hpp"
+#include "Circada/DCCPoller.hpp"
+#include "Circada/DCC.hpp"
+
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+namespace Circada {
+
+    DCCListenerPool::DCCListenerPool(DCCPoller& poller)
+        : poller(poller), first_port(0), last_port(0) { }
+
+    DCCListenerPool::~DCCListenerPool() {
+        for (Listeners::iterator it = listeners.begin(); it != listeners.end(); it++) {
+            (*it)->socket.close();
+            delete *it;
+        }
+    }
+
+    void DCCListenerPool::set_port_range(unsigned short first, unsigned short last) {
+        ScopeMutex lock(&mtx);
+        if (first > last) {
+            unsigned short tmp = first;
+            first = last;
+            last = tmp;
+        }
+        first_port = first;
+        last_port = last;
+    }
+
+    unsigned short DCCListenerPool::acquire(DCCIO *io, unsigned long peer_address) {
+        ScopeMutex lock(&mtx);
+        Listener *listener = 0;
+
+        /* share an open listener, if the peer can be told apart */
+        for (Listeners::iterator it = listeners.begin(); it != listeners.end(); it++) {
+            if (is_usable(*it, peer_address)) {
+                listener = *it;
+                break;
+            }
+        }
+
+        /* otherwise open a new one */
+        if (!listener) {
+            if (first_port) {
+                for (unsigned int port = first_port; port <= last_port && !listener; port++) {
+                    bool in_use = false;
+                    for (Listeners::iterator it = listeners.begin(); it != listeners.end(); it++) {
+                        if ((*it)->port == port) {
+                            in_use = true;
+                            break;
+                        }
+                    }
+                    if (!in_use) {
+                        listener = open_listener(static_cast<unsigned short>(port));
+                    }
+                }
+                if (!listener) {
+                    throw DCCListenerPoolException("No free port in the DCC port range.");
+                }
+            } else {
+                listener = open_listener(0);
+                if (!listener) {
+                    throw DCCListenerPoolException("Cannot open a DCC listener.");
+                }
+            }
+        }
+
+        listener->entries.push_back(Entry(io, peer_address));
+        poller.wakeup();
+
+        return listener->port;
+    }
+
+    void DCCListenerPool::release(DCCIO *io) {
+        ScopeMutex lock(&mtx);
+        for (Listeners::iterator it = listeners.begin(); it != listeners.end(); it++) {
+            Listener *listener = *it;
+            for (Entries::iterator eit = listener->entries.begin(); eit != listener->entries.end(); eit++) {
+                if (eit->io == io) {
+                    listener->entries.erase(eit);
+                    if (!listener->entries.size()) {
+                        listeners.erase(it);
+                        close_listener(listener);
+                    }
+                    return;
+                }
+            }
+        }
+    }
+
+    size_t DCCListenerPool::get_listener_count() {
+        ScopeMutex lock(&mtx);
+        return listeners.size();
+    }
+
+    void DCCListenerPool::get_poll_fds(std::vector<struct pollfd>& fds) {
+        ScopeMutex lock(&mtx);
+        struct pollfd pfd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        for (Listeners::iterator it = listeners.begin(); it != listeners.end(); it++) {
+            pfd.fd = (*it)->socket.get_fd();
+            fds.push_back(pfd);
+        }
+    }
+
+    void DCCListenerPool::handle_events(int fd, short revents) {
+        ScopeMutex lock(&mtx);
+        for (Listeners::iterator it = listeners.begin(); it != listeners.end(); it++) {
+            Listener *listener = *it;
+            if (listener->socket.get_fd() != fd) {
+                continue;
+            }
+            while (listener->entries.size()) {
+                struct sockaddr_in client;
+                socklen_t client_len = sizeof(client);
+                int client_fd = ::accept(fd, reinterpret_cast<struct sockaddr *>(&client), &client_len);
+                if (client_fd < 0) {
+                    /* EAGAIN or an aborted connection */
+                    break;
+                }
+
+                /* route by the source address, an unknown peer takes the rest */
+                unsigned long peer_address = client.sin_addr.s_addr;
+                Entries::iterator target = listener->entries.end();
+                for (Entries::iterator eit = listener->entries.begin(); eit != listener->entries.end(); eit++) {
+                    if (eit->peer_address == peer_address) {
+                        target = eit;
+                        break;
+                    }
+                    if (!eit->peer_address && target == listener->entries.end()) {
+                        target = eit;
+                    }
+                }
+                if (target == listener->entries.end()) {
+                    ::close(client_fd);
+                    continue;
+                }
+                target->io->attach(client_fd);
+                listener->entries.erase(target);
+            }
+            if (!listener->entries.size()) {
+                listeners.erase(it);
+                close_listener(listener);
+            }
+            break;
+        }
+    }
+
+    bool DCCListenerPool::is_usable(const Listener *listener, unsigned long peer_address) const {
+        /* keep ephemeral listeners apart from a configured range */
+        if (first_port) {
+            if (listener->ephemeral || listener->port < first_port || listener->port > last_port) {
+                return false;
+            }
+        }
+        for (Entries::const_iterator it = listener->entries.begin(); it != listener->entries.end(); it++) {
+            if (it->peer_address == peer_address) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    DCCListenerPool::Listener *DCCListenerPool::open_listener(unsigned short port) {
+        Listener *listener = new Listener;
+        try {
+            listener->socket.listen(port);
+            listener->socket.set_nonblocking(true);
+            listener->port = listener->socket.get_port();
+            listener->ephemeral = (port == 0);
+        } catch (const SocketException&) {
+            delete listener;
+            return 0;
+        }
+        listeners.push_back(listener);
+
+        return listener;
+    }
+
+    void DCCListenerPool::close_listener(Listener *listener) {
+        listener->socket.close();
+        delete listener;
+    }
+
+} /* namespace Circada */
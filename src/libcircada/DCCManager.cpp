@@ -22,18 +22,31 @@
 #include "Circada/Utils.hpp"
 
 #include <unistd.h>
+#include <cstdlib>
 #include <cstdio>
 #include <cerrno>
 #include <cstring>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <arpa/inet.h>
+#include <ctime>
 
 #include <iostream>
 
 namespace Circada {
 
-    DCCManager::DCCManager(Configuration& config, Events& evt, WindowManager& win_mgr)
-        : config(config), evt(evt), win_mgr(win_mgr), destroying(false)
+    DCCManager::DCCManager(Configuration& config, Events& evt, WindowManager& win_mgr, Metrics& metrics)
+        : config(config), evt(evt), win_mgr(win_mgr), destroying(false),
+          token_sequence(static_cast<u32>(time(0)) & 0xffff),
+          queue(config.get_working_directory() + "/dcc_queue"), nick_limit(0), transfer_limit(0), default_priority(DCCPriorityNormal),
+          timeout_setting(config, "", "dcc_timeout", "300"),
+          socket_buffer_setting(config, "", "dcc_socket_buffer", "1048576"),
+          turbo_setting(config, "", "dcc_turbo", "0"),
+          xfer_in_window_setting(config, "", "dcc_xfer_in_window", "0"),
+          slots_setting(config, "", "dcc_slots", "0"),
+          nick_slots_setting(config, "", "dcc_slots_nick", "0"),
+          sent_bytes(metrics.counter("circada_dcc_sent_bytes_total", "Bytes sent in dcc transfers.")),
+          received_bytes(metrics.counter("circada_dcc_received_bytes_total", "Bytes received in dcc transfers."))
     {
         /* create transfer directory */
         storage_directory = config.get_working_directory() + "/transfer";
@@ -42,54 +55,79 @@ namespace Circada {
         } catch (const UtilsException& e) {
             throw DCCManagerException("Cannot create transfer directory: " + std::string(e.what()));
         }
+
+        /* bandwidth limits, later changes come in as notifications */
+        apply_bandwidth_limit(DCCLimitGlobal, strtoull(config.get_value("", "dcc_limit_global", "0").c_str(), 0, 10));
+        apply_bandwidth_limit(DCCLimitNick, strtoull(config.get_value("", "dcc_limit_nick", "0").c_str(), 0, 10));
+        apply_bandwidth_limit(DCCLimitTransfer, strtoull(config.get_value("", "dcc_limit_transfer", "0").c_str(), 0, 10));
+        if (is_equal(config.get_value("", "dcc_priority", "normal"), "bulk")) {
+            default_priority = DCCPriorityBulk;
+        }
+        config.add_listener(this);
+
+        /* offers, which waited for a slot in the last run */
+        queue.load();
+
+        /* all dccs are driven by this poller thread */
+        try {
+            poller.start();
+        } catch (const DCCPollerException& e) {
+            throw DCCManagerException(e.what());
+        }
     }
 
     DCCManager::~DCCManager() {
+        config.remove_listener(this);
         destroying = true;
-        ScopeMutex lock(&mtx);
-        while (dccs.size()) {
-            DCC *dcc = dccs[0];
-            destroy_dcc_nolock(dcc);
+        {
+            ScopeMutex lock(&mtx);
+            for (DCC::List::iterator it = dccs.begin(); it != dccs.end(); it++) {
+                DCC *dcc = *it;
+                if (dcc->get_type() == DCCTypeXfer && static_cast<DCCXfer *>(dcc)->is_queued()) {
+                    queue.park(static_cast<DCCXfer *>(dcc));
+                    static_cast<DCCXfer *>(dcc)->set_queued(false);
+                }
+            }
+            save_queue_nolock();
+            while (dccs.size()) {
+                DCC *dcc = dccs[0];
+                destroy_dcc_nolock(dcc);
+            }
         }
+        poller.stop();
     }
 
-    DCC *DCCManager::create_chat_in(Session *s, const std::string& nick) {
-        /* we are offering a chat, we create an incoming socket */
+    DCC *DCCManager::create_chat_in(Session *s, const std::string& nick, bool passive) {
+        /* we are offering a chat, we listen or wait for the peer's address */
         DCCChatIn *dcc = 0;
         try {
             dcc = new DCCChatIn(s, *this, nick);
-            dcc->start();
+            if (!passive) {
+                update_port_range();
+                dcc->listen();
+            }
         } catch (const std::exception& e) {
             if (dcc) delete dcc;
             throw DCCManagerException(e.what());
         }
+        if (passive) {
+            dcc->set_token(create_token());
+        }
 
         ScopeMutex lock(&mtx);
         dccs.push_back(dcc);
+        dcc->start();
 
         return dcc;
     }
 
-    DCC *DCCManager::create_xfer_in(Session *s, const std::string& nick, const std::string& filename, std::string& out_filename, u32& filesize) {
-        /* we are offering a file, we create an incoming socket */
-        DCCXferIn *dcc = 0;
-        try {
-            get_fileinfo(filename, out_filename, filesize);
-            dcc = new DCCXferIn(s, *this, nick, filename, filesize);
-            dcc->start();
-        } catch (const std::exception& e) {
-            if (dcc) delete dcc;
-            throw DCCManagerException(e.what());
-        }
-
-        ScopeMutex lock(&mtx);
-        dccs.push_back(dcc);
-
-        return dcc;
+    DCC *DCCManager::create_xfer_in(Session *s, const std::string& nick, const std::string& filename, bool passive) {
+        /* we are offering a file, the offer is sent when a slot is free */
+        return enqueue_xfer_in(s, nick, filename, passive, 0);
     }
 
-    DCC *DCCManager::create_chat_out(Session *s, const std::string& nick, unsigned long address, unsigned short port) {
-        /* we can connect to an offered socket */
+    DCC *DCCManager::create_chat_out(Session *s, const std::string& nick, unsigned long address, unsigned short port, const std::string& token) {
+        /* we can connect to an offered socket, or listen for a passive one */
         DCCChatOut *dcc = 0;
         try {
             dcc = new DCCChatOut(s, *this, nick, address, port);
@@ -97,6 +135,7 @@ namespace Circada {
             if (dcc) delete dcc;
             throw DCCManagerException(e.what());
         }
+        dcc->set_token(token);
 
         ScopeMutex lock(&mtx);
         dccs.push_back(dcc);
@@ -104,8 +143,8 @@ namespace Circada {
         return dcc;
     }
 
-    DCC *DCCManager::create_xfer_out(Session *s, const std::string& nick, const std::string& filename, u32 filesize, unsigned long address, unsigned short port) {
-        /* we can connect to an offered socket */
+    DCC *DCCManager::create_xfer_out(Session *s, const std::string& nick, const std::string& filename, u64 filesize, unsigned long address, unsigned short port, const std::string& token, bool turbo) {
+        /* we can connect to an offered socket, or listen for a passive one */
         DCCXferOut *dcc = 0;
         try {
             dcc = new DCCXferOut(s, *this, nick, filename, filesize, address, port);
@@ -113,6 +152,9 @@ namespace Circada {
             if (dcc) delete dcc;
             throw DCCManagerException(e.what());
         }
+        setup_xfer(dcc);
+        dcc->set_token(token);
+        dcc->set_turbo(turbo);
 
         ScopeMutex lock(&mtx);
         dccs.push_back(dcc);
@@ -120,6 +162,32 @@ namespace Circada {
         return dcc;
     }
 
+    bool DCCManager::connect_passive(Session *s, const std::string& nick, const std::string& token, unsigned long address, unsigned short port) {
+        /* the peer answered our passive offer with its address */
+        ScopeMutex lock(&mtx);
+        if (!token.length()) {
+            return false;
+        }
+        for (DCC::List::iterator it = dccs.begin(); it != dccs.end(); it++) {
+            DCC *tmp_dcc = *it;
+            DCCIO& io = tmp_dcc->get_dccio();
+            if (tmp_dcc->get_session() == s && io.get_direction() == DCCDirectionIncoming && io.is_waiting() &&
+                io.get_token() == token && is_equal(tmp_dcc->get_his_nick(), nick))
+            {
+                io.connect_to(address, port);
+                poller.wakeup();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void DCCManager::begin_dcc(DCC *dcc) {
+        ScopeMutex lock(&mtx);
+        begin_dcc_nolock(dcc);
+    }
+
     void DCCManager::dcc_change_his_nick(Session *s, const std::string& old_nick, const std::string& new_nick) {
         if (s) {
             ScopeMutex lock(&mtx);
@@ -158,6 +226,24 @@ namespace Circada {
 
     void DCCManager::destroy_all_dccs_in_session(Session *s) {
         ScopeMutex lock(&mtx);
+
+        /* queued offers are kept until we are logged in again */
+        bool parked = false;
+        for (DCC::List::iterator it = dccs.begin(); it != dccs.end(); it++) {
+            DCC *tmp_dcc = *it;
+            if (tmp_dcc->get_session() == s && tmp_dcc->get_type() == DCCTypeXfer) {
+                DCCXfer *dcc_xfer = static_cast<DCCXfer *>(tmp_dcc);
+                if (dcc_xfer->is_queued()) {
+                    queue.park(dcc_xfer);
+                    dcc_xfer->set_queued(false);
+                    parked = true;
+                }
+            }
+        }
+        if (parked) {
+            save_queue_nolock();
+        }
+
         bool found;
         do {
             found = false;
@@ -179,6 +265,16 @@ namespace Circada {
 
     void DCCManager::destroy_dcc_nolock(const DCC *dcc) {
         DCC *my_dcc = const_cast<DCC *>(dcc);
+        bool slot_freed = false;
+        if (my_dcc->get_type() == DCCTypeXfer) {
+            DCCXfer *dcc_xfer = static_cast<DCCXfer *>(my_dcc);
+            slot_freed = dcc_xfer->is_admitted();
+            if (dcc_xfer->is_queued()) {
+                queue.remove(dcc_xfer);
+                dcc_xfer->set_queued(false);
+                save_queue_nolock();
+            }
+        }
         my_dcc->set_will_be_killed();
         my_dcc->stop();
         win_mgr.detach_window(my_dcc);
@@ -191,7 +287,13 @@ namespace Circada {
             }
         }
 
-        delete my_dcc;
+        /* the poller may be in a callback of this dcc right now */
+        poller.dispose(my_dcc);
+        prune_nick_buckets_nolock();
+
+        if (slot_freed) {
+            process_queue_nolock();
+        }
     }
 
     DCC::List& DCCManager::get_dccs() {
@@ -207,21 +309,23 @@ namespace Circada {
         return "~" + filename + ".part";
     }
 
-    bool DCCManager::set_resume_position(Session *s, unsigned short port, u32& startpos, DCC*& out_dcc) {
+    bool DCCManager::set_resume_position(Session *s, unsigned short port, const std::string& token, u64& startpos, DCC*& out_dcc) {
         ScopeMutex lock(&mtx);
 
         out_dcc = 0;
         for (DCC::List::iterator it = dccs.begin(); it != dccs.end(); it++) {
             DCC *dcc = *it;
             if (dcc->get_type() == DCCTypeXfer) {
-                if (dcc->get_dccio().get_port() == port) {
+                /* passive transfers are identified by their token */
+                const DCCIO& io = dcc->get_dccio();
+                if (port ? io.get_port() == port : (token.length() && io.get_token() == token)) {
                     DCCXfer *dcc_xfer = static_cast<DCCXfer *>(dcc);
                     out_dcc = dcc_xfer;
                     switch (dcc->get_dccio().get_direction()) {
                         case DCCDirectionIncoming:
                         {
                             try {
-                                if (startpos > get_filesize(dcc_xfer->get_filename())) {
+                                if (startpos > static_cast<u64>(get_filesize(dcc_xfer->get_filename()))) {
                                     startpos = 0;
                                 }
                             } catch (const std::exception&) {
@@ -234,7 +338,7 @@ namespace Circada {
                         {
                             try {
                                 std::string outfile = get_storage(dcc_xfer->get_filename());
-                                if (startpos > get_filesize(outfile)) {
+                                if (startpos > static_cast<u64>(get_filesize(outfile))) {
                                     throw DCCManagerException("Resume position is out of received file.");
                                 }
                             } catch (const std::exception& e) {
@@ -300,50 +404,45 @@ namespace Circada {
         if (tmp_dcc->is_running()) {
             throw DCCOperationNotPermittedException();
         }
+        if (tmp_dcc->get_type() != DCCTypeXfer) {
+            begin_dcc_nolock(tmp_dcc);
+            return;
+        }
+
+        /* a queued transfer can only be forced to start immediately */
+        DCCXfer *dcc_xfer = static_cast<DCCXfer *>(tmp_dcc);
+        if (dcc_xfer->is_queued()) {
+            if (!force) {
+                throw DCCOperationNotPermittedException();
+            }
+            admit_nolock(dcc_xfer, true);
+            queue.remove(dcc_xfer);
+            dcc_xfer->set_queued(false);
+            save_queue_nolock();
+            return;
+        }
+
         Session *s = tmp_dcc->get_session();
-        if (!force && s && tmp_dcc->get_type() == DCCTypeXfer && tmp_dcc->get_dccio().get_direction() == DCCDirectionOutgoing) {
-            DCCXfer *dcc_xfer = static_cast<DCCXfer *>(tmp_dcc);
+        if (!force && s && tmp_dcc->get_dccio().get_direction() == DCCDirectionOutgoing) {
             const std::string& filename = dcc_xfer->get_filename();
             /* check, if receiving file is in progress */
             for (DCC::List::iterator it = dccs.begin(); it != dccs.end(); it++) {
                 DCC *list_dcc = *it;
                 if (list_dcc->get_type() == DCCTypeXfer) {
-                    DCCXfer *dcc_xfer = static_cast<DCCXfer *>(list_dcc);
-                    if (dcc_xfer->get_filename() == filename && list_dcc->is_running()) {
+                    DCCXfer *list_xfer = static_cast<DCCXfer *>(list_dcc);
+                    if (list_xfer->get_filename() == filename && (list_dcc->is_running() || list_xfer->is_queued())) {
                         throw DCCOperationNotPermittedException();
                     }
                 }
             }
-            /* setup resume position */
-            if (file_exists(get_storage(get_part_filename(filename)))) {
-                try {
-                    u32 startpos = static_cast<u32>(get_filesize(get_storage(filename)));
-                    /* avoid a send hang bug in weechat */
-                    if (startpos && dcc_xfer->get_filesize() == startpos) {
-                        startpos--;
-                    }
-                    /* send resume request */
-                    const std::string& nick = dcc_xfer->get_his_nick();
-                    char port_str[32];
-                    char startpos_str[32];
-                    sprintf(port_str, "%hu", dcc_xfer->get_dccio().get_port());
-                    sprintf(startpos_str, "%u", startpos);
-                    std::string reply("PRIVMSG " + nick + " :\x01");
-                    reply += "DCC RESUME " + filename + " ";
-                    reply += port_str;
-                    reply += " ";
-                    reply += startpos_str;
-                    reply += "\x01";
-                    s->send(reply);
-                } catch (const Exception& e) {
-                    /* start over */
-                    tmp_dcc->start();
-                }
-            } else {
-                tmp_dcc->start();
-            }
+            /* wait for a free slot */
+            dcc_xfer->set_queued(true);
+            queue.push(dcc_xfer, s->get_server(), false, 0);
+            process_queue_nolock();
+        } else if (tmp_dcc->get_dccio().get_direction() == DCCDirectionOutgoing) {
+            admit_nolock(dcc_xfer, false);
         } else {
-            tmp_dcc->start();
+            begin_dcc_nolock(tmp_dcc);
         }
     }
 
@@ -380,7 +479,8 @@ namespace Circada {
         if (tmp_dcc->get_type() != DCCTypeChat) {
             throw DCCOperationNotPermittedException();
         }
-        tmp_dcc->get_dccio().get_socket().send(msg + "\n");
+        DCCChat *dcc_chat = static_cast<DCCChat *>(const_cast<DCC *>(tmp_dcc));
+        dcc_chat->send(msg);
     }
 
     Window *DCCManager::get_window_from_dcc_handle(DCCHandle dcc) {
@@ -393,6 +493,232 @@ namespace Circada {
         return config;
     }
 
+    DCCPoller& DCCManager::get_poller() {
+        return poller;
+    }
+
+    int DCCManager::get_timeout() const {
+        return timeout_setting.get();
+    }
+
+    int DCCManager::get_socket_buffer() const {
+        return socket_buffer_setting.get();
+    }
+
+    bool DCCManager::is_turbo() const {
+        return turbo_setting.get();
+    }
+
+    void DCCManager::configuration_changed(const std::string& category, const std::string& key, const std::string& value) {
+        if (category.length()) {
+            return;
+        }
+
+        if (key == "dcc_limit_global") {
+            apply_bandwidth_limit(DCCLimitGlobal, strtoull(value.c_str(), 0, 10));
+        } else if (key == "dcc_limit_nick") {
+            apply_bandwidth_limit(DCCLimitNick, strtoull(value.c_str(), 0, 10));
+        } else if (key == "dcc_limit_transfer") {
+            apply_bandwidth_limit(DCCLimitTransfer, strtoull(value.c_str(), 0, 10));
+        } else if (key == "dcc_priority") {
+            ScopeMutex lock(&bw_mtx);
+            default_priority = (is_equal(value, "bulk") ? DCCPriorityBulk : DCCPriorityNormal);
+        } else if (key == "dcc_slots" || key == "dcc_slots_nick" || key == "dcc_queue_order") {
+            /* more slots may start waiting transfers */
+            ScopeMutex lock(&mtx);
+            process_queue_nolock();
+        }
+    }
+
+    void DCCManager::set_bandwidth_limit(DCCLimitScope scope, u64 rate) {
+        /* the new limit is applied, when the configuration notifies us */
+        char buffer[32];
+        sprintf(buffer, "%llu", static_cast<unsigned long long>(rate));
+        switch (scope) {
+            case DCCLimitGlobal:
+                config.set_value("", "dcc_limit_global", buffer);
+                break;
+
+            case DCCLimitNick:
+                config.set_value("", "dcc_limit_nick", buffer);
+                break;
+
+            case DCCLimitTransfer:
+                config.set_value("", "dcc_limit_transfer", buffer);
+                break;
+        }
+    }
+
+    u64 DCCManager::get_bandwidth_limit(DCCLimitScope scope) {
+        ScopeMutex lock(&bw_mtx);
+        switch (scope) {
+            case DCCLimitGlobal:
+                return global_bucket.get_rate();
+
+            case DCCLimitNick:
+                return nick_limit;
+
+            case DCCLimitTransfer:
+                return transfer_limit;
+        }
+
+        return 0;
+    }
+
+    void DCCManager::set_transfer_limit(DCCHandle dcc, u64 rate) {
+        ScopeMutex lock(&mtx);
+        DCCHandleBase& base = *get_dcc_handle_base(&dcc);
+        DCC *tmp_dcc = base.get_handle();
+        if (!is_handle_valid_nolock(tmp_dcc)) {
+            throw DCCInvalidHandleException();
+        }
+        if (tmp_dcc->get_type() != DCCTypeXfer) {
+            throw DCCOperationNotPermittedException();
+        }
+        ScopeMutex bw_lock(&bw_mtx);
+        DCCXfer *xfer = static_cast<DCCXfer *>(tmp_dcc);
+        xfer->get_bucket().set_rate(rate);
+        xfer->set_own_limit(true);
+        poller.wakeup();
+    }
+
+    void DCCManager::set_transfer_priority(DCCHandle dcc, DCCPriority priority) {
+        ScopeMutex lock(&mtx);
+        DCCHandleBase& base = *get_dcc_handle_base(&dcc);
+        DCC *tmp_dcc = base.get_handle();
+        if (!is_handle_valid_nolock(tmp_dcc)) {
+            throw DCCInvalidHandleException();
+        }
+        if (tmp_dcc->get_type() != DCCTypeXfer) {
+            throw DCCOperationNotPermittedException();
+        }
+        static_cast<DCCXfer *>(tmp_dcc)->set_priority(priority);
+    }
+
+    u64 DCCManager::get_bandwidth(DCCXfer *xfer, u64 want, long now, long& ready_at) {
+        ScopeMutex lock(&bw_mtx);
+        TokenBucket *buckets[] = { &xfer->get_bucket(), &get_nick_bucket(xfer), &global_bucket };
+
+        /* bulk transfers leave a part of the global burst to the others */
+        u64 reserve = 0;
+        if (xfer->get_priority() == DCCPriorityBulk && global_bucket.is_limited()) {
+            reserve = get_bulk_reserve(global_bucket.get_burst());
+        }
+
+        return get_grant(buckets, sizeof(buckets) / sizeof(buckets[0]), reserve, want, now, ready_at);
+    }
+
+    u64 DCCManager::get_grant(TokenBucket **buckets, size_t count, u64 reserve, u64 want, long now, long& ready_at) {
+        u64 granted = want;
+        for (size_t i = 0; i < count; i++) {
+            u64 available = buckets[i]->get_available(now);
+            if (i == count - 1) {
+                available = (available > reserve ? available - reserve : 0);
+            }
+            if (available < granted) granted = available;
+        }
+
+        /* avoid dribbling tiny chunks, wait for a reasonable amount */
+        u64 minimum = (want < MinimumGrant ? want : MinimumGrant);
+        if (granted < minimum) {
+            ready_at = now;
+            for (size_t i = 0; i < count; i++) {
+                long t = buckets[i]->get_ready_time(now, minimum + (i == count - 1 ? reserve : 0));
+                if (t > ready_at) ready_at = t;
+            }
+            return 0;
+        }
+        ready_at = now;
+
+        return granted;
+    }
+
+    u64 DCCManager::get_bulk_reserve(u64 burst) {
+        /* a quarter of the burst, but the minimum grant must still fit */
+        /* into a full bucket, or low limits starve bulk transfers.     */
+        u64 reserve = burst / 4;
+        if (reserve + MinimumGrant > burst) {
+            reserve = (burst > MinimumGrant ? burst - MinimumGrant : 0);
+        }
+
+        return reserve;
+    }
+
+    void DCCManager::consume_bandwidth(DCCXfer *xfer, u64 bytes) {
+        /* we send, what we offered */
+        if (xfer->get_dccio().get_direction() == DCCDirectionIncoming) {
+            sent_bytes.add(bytes);
+        } else {
+            received_bytes.add(bytes);
+        }
+
+        ScopeMutex lock(&bw_mtx);
+        xfer->get_bucket().consume(bytes);
+        get_nick_bucket(xfer).consume(bytes);
+        global_bucket.consume(bytes);
+    }
+
+    void DCCManager::set_slots(DCCLimitScope scope, unsigned int slots) {
+        char buffer[32];
+        sprintf(buffer, "%u", slots);
+        switch (scope) {
+            case DCCLimitGlobal:
+                config.set_value("", "dcc_slots", buffer);
+                break;
+
+            case DCCLimitNick:
+                config.set_value("", "dcc_slots_nick", buffer);
+                break;
+
+            case DCCLimitTransfer:
+                throw DCCOperationNotPermittedException();
+        }
+    }
+
+    unsigned int DCCManager::get_slots(DCCLimitScope scope) {
+        switch (scope) {
+            case DCCLimitGlobal:
+                return static_cast<unsigned int>(slots_setting.get());
+
+            case DCCLimitNick:
+                return static_cast<unsigned int>(nick_slots_setting.get());
+
+            case DCCLimitTransfer:
+                break;
+        }
+
+        return 0;
+    }
+
+    void DCCManager::restore_queue(Session *s) {
+        /* offers of an earlier session to this server are queued again */
+        DCCQueue::Entries entries;
+        {
+            ScopeMutex lock(&mtx);
+            queue.take_parked(s->get_server(), entries);
+        }
+        if (entries.size()) {
+            bool passive = config.is_true(config.get_value("", "dcc_passive", "0"));
+            for (DCCQueue::Entries::iterator it = entries.begin(); it != entries.end(); it++) {
+                try {
+                    enqueue_xfer_in(s, it->nick, it->filename, passive, it->sequence);
+                } catch (const Exception&) {
+                    /* the file is gone, drop the offer */
+                }
+            }
+            ScopeMutex lock(&mtx);
+            save_queue_nolock();
+        }
+    }
+
+    size_t DCCManager::get_queue_position_nolock(const DCC *dcc) {
+        if (dcc->get_type() != DCCTypeXfer || !static_cast<const DCCXfer *>(dcc)->is_queued()) {
+            return 0;
+        }
+
+        return queue.get_position(static_cast<const DCCXfer *>(dcc), get_queue_order());
+    }
+
     void DCCManager::dcc_mgr_chat_begins(const DCC *dcc) {
         SessionWindow *w = win_mgr.create_window(&evt, dcc, dcc->get_my_nick(), dcc->get_his_nick());
         detach_dcc_from_irc_server(dcc);
@@ -415,7 +741,7 @@ namespace Circada {
 
     void DCCManager::dcc_mgr_xfer_begins(const DCC *dcc) {
         SessionWindow *w = 0;
-        if (config.is_true(config.get_value("", "dcc_xfer_in_window", "0"))) {
+        if (xfer_in_window_setting.get()) {
             w = win_mgr.create_window(&evt, dcc, dcc->get_my_nick(), dcc->get_his_nick());
         }
         detach_dcc_from_irc_server(dcc);
@@ -430,7 +756,7 @@ namespace Circada {
     void DCCManager::dcc_mgr_xfer_ended(const DCC *dcc) {
         if (!destroying) {
             SessionWindow *w = 0;
-            if (config.is_true(config.get_value("", "dcc_xfer_in_window", "0"))) {
+            if (xfer_in_window_setting.get()) {
                 w = win_mgr.create_window(&evt, dcc, dcc->get_my_nick(), dcc->get_his_nick());
             }
             win_mgr.detach_window(dcc);
@@ -446,17 +772,17 @@ namespace Circada {
         evt.dcc_message(w, DCCChatHandle(*this, dcc), ctcp, msg);
     }
 
-    void DCCManager::dcc_mgr_send_progress(const DCC *dcc, u32 sent_bytes, u32 total_bytes) {
+    void DCCManager::dcc_mgr_send_progress(const DCC *dcc, u64 sent_bytes, u64 total_bytes) {
         SessionWindow *w = 0;
-        if (config.is_true(config.get_value("", "dcc_xfer_in_window", "0"))) {
+        if (xfer_in_window_setting.get()) {
             w = win_mgr.create_window(&evt, dcc, dcc->get_my_nick(), dcc->get_his_nick());
         }
         evt.dcc_send_progress(w, DCCXferHandle(*this, dcc));
     }
 
-    void DCCManager::dcc_mgr_receive_progress(const DCC *dcc, u32 received_bytes, u32 total_bytes) {
+    void DCCManager::dcc_mgr_receive_progress(const DCC *dcc, u64 received_bytes, u64 total_bytes) {
         SessionWindow *w = 0;
-        if (config.is_true(config.get_value("", "dcc_xfer_in_window", "0"))) {
+        if (xfer_in_window_setting.get()) {
             w = win_mgr.create_window(&evt, dcc, dcc->get_my_nick(), dcc->get_his_nick());
         }
         evt.dcc_receive_progress(w, DCCXferHandle(*this, dcc));
@@ -503,13 +829,308 @@ namespace Circada {
         return info.st_size;
     }
 
-    void DCCManager::get_fileinfo(const std::string& filename, std::string& out_filename, u32& out_size) {
-        off_t sz = get_filesize(filename);
-        if (sz > static_cast<u32>(-1)) {
-            throw DCCManagerException("File size too big (size > 4294967295 bytes).");
+    void DCCManager::setup_xfer(DCCXfer *xfer) {
+        ScopeMutex lock(&bw_mtx);
+        xfer->get_bucket().set_rate(transfer_limit);
+        xfer->set_priority(default_priority);
+    }
+
+    void DCCManager::update_port_range() {
+        /* dcc_port_range is "first-last" or a single port */
+        std::string range = config.get_value("", "dcc_port_range", "");
+        unsigned short first = 0;
+        unsigned short last = 0;
+        if (range.length()) {
+            size_t pos = range.find('-');
+            first = static_cast<unsigned short>(atoi(range.c_str()));
+            last = (pos != std::string::npos ? static_cast<unsigned short>(atoi(range.substr(pos + 1).c_str())) : first);
+        }
+        poller.get_listeners().set_port_range(first, last);
+    }
+
+    std::string DCCManager::create_token() {
+        char buffer[32];
+        ScopeMutex lock(&mtx);
+        sprintf(buffer, "%u", ++token_sequence);
+
+        return buffer;
+    }
+
+    void DCCManager::begin_dcc_nolock(DCC *dcc) {
+        DCCIO& io = dcc->get_dccio();
+        if (io.get_direction() == DCCDirectionOutgoing && io.is_waiting()) {
+            /* the peer offered passively, we listen and tell it where */
+            Session *s = dcc->get_session();
+            if (!s) {
+                throw DCCManagerException("Session of this DCC is gone.");
+            }
+            update_port_range();
+            io.listen();
+
+            char buffer[64];
+            std::string reply("PRIVMSG " + dcc->get_his_nick() + " :\x01");
+            if (dcc->get_type() == DCCTypeChat) {
+                reply += "DCC CHAT chat ";
+            } else {
+                DCCXfer *xfer = static_cast<DCCXfer *>(dcc);
+                reply += (xfer->is_turbo() ? "DCC TSEND " : "DCC SEND ") + xfer->get_filename() + " ";
+            }
+            sprintf(buffer, "%lu %hu", static_cast<unsigned long>(ntohl(s->get_dcc_address())), io.get_port());
+            reply += buffer;
+            if (dcc->get_type() == DCCTypeXfer) {
+                sprintf(buffer, " %llu", static_cast<unsigned long long>(static_cast<DCCXfer *>(dcc)->get_filesize()));
+                reply += buffer;
+            }
+            reply += " " + io.get_token() + "\x01";
+            s->send(reply);
+        }
+        dcc->start();
+    }
+
+    DCCXferIn *DCCManager::enqueue_xfer_in(Session *s, const std::string& nick, const std::string& filename, bool passive, u64 sequence) {
+        DCCXferIn *dcc = 0;
+        try {
+            u64 filesize = static_cast<u64>(get_filesize(filename));
+            dcc = new DCCXferIn(s, *this, nick, filename, filesize);
+        } catch (const std::exception& e) {
+            throw DCCManagerException(e.what());
+        }
+        setup_xfer(dcc);
+        if (passive) {
+            dcc->set_token(create_token());
+        }
+
+        ScopeMutex lock(&mtx);
+        dccs.push_back(dcc);
+        dcc->set_queued(true);
+        queue.push(dcc, s->get_server(), true, sequence);
+        save_queue_nolock();
+        process_queue_nolock();
+
+        return dcc;
+    }
+
+    void DCCManager::process_queue_nolock() {
+        /* admit waiting transfers in queue order, as long as slots are free */
+        if (destroying) {
+            return;
+        }
+
+        typedef std::map<std::string, unsigned int> NickSlots;
+
+        unsigned int slots = get_slots(DCCLimitGlobal);
+        unsigned int nick_slots = get_slots(DCCLimitNick);
+        unsigned int used = 0;
+        NickSlots used_by_nick;
+        for (DCC::List::iterator it = dccs.begin(); it != dccs.end(); it++) {
+            DCC *tmp_dcc = *it;
+            if (tmp_dcc->get_type() == DCCTypeXfer && static_cast<DCCXfer *>(tmp_dcc)->is_admitted()) {
+                std::string nick = tmp_dcc->get_his_nick();
+                to_lower(nick);
+                used_by_nick[nick]++;
+                used++;
+            }
+        }
+
+        DCCQueue::Xfers xfers;
+        queue.get_ordered(get_queue_order(), xfers);
+        bool changed = false;
+        for (DCCQueue::Xfers::iterator it = xfers.begin(); it != xfers.end(); it++) {
+            if (slots && used >= slots) {
+                break;
+            }
+            DCCXfer *dcc_xfer = *it;
+            std::string nick = dcc_xfer->get_his_nick();
+            to_lower(nick);
+            if (nick_slots && used_by_nick[nick] >= nick_slots) {
+                continue;
+            }
+            try {
+                admit_nolock(dcc_xfer, true);
+            } catch (const Exception&) {
+                /* no free port or no connection, retry when a slot frees */
+                break;
+            }
+            queue.remove(dcc_xfer);
+            dcc_xfer->set_queued(false);
+            changed = true;
+            used_by_nick[nick]++;
+            used++;
+        }
+        if (changed) {
+            save_queue_nolock();
+        }
+    }
+
+    void DCCManager::save_queue_nolock() {
+        try {
+            queue.save();
+        } catch (const DCCQueueException&) {
+            /* the queue still works, it is just not persistent */
+        }
+    }
+
+    DCCQueueOrder DCCManager::get_queue_order() {
+        if (is_equal(config.get_value("", "dcc_queue_order", "fifo"), "size")) {
+            return DCCQueueOrderSize;
+        }
+
+        return DCCQueueOrderFifo;
+    }
+
+    void DCCManager::admit_nolock(DCCXfer *xfer, bool resume) {
+        if (xfer->get_dccio().get_direction() == DCCDirectionIncoming) {
+            offer_xfer_nolock(xfer);
+        } else {
+            receive_xfer_nolock(xfer, resume);
+        }
+        xfer->set_admitted(true);
+    }
+
+    void DCCManager::offer_xfer_nolock(DCCXfer *xfer) {
+        /* send our offer, a passive one waits for the peer's address */
+        Session *s = xfer->get_session();
+        if (!s) {
+            throw DCCManagerException("Session of this DCC is gone.");
+        }
+        DCCIO& io = xfer->get_dccio();
+        bool passive = (io.get_token().length() > 0);
+        if (!passive && io.is_waiting()) {
+            update_port_range();
+            io.listen();
+        }
+
+        /* a receiver, that knows TSEND, does not acknowledge */
+        xfer->set_turbo(is_turbo());
+
+        std::string filename;
+        char buffer[64];
+        reduce_filename(xfer->get_filename(), filename);
+        std::string req("PRIVMSG " + xfer->get_his_nick() + " :\x01");
+        req += (xfer->is_turbo() ? "DCC TSEND " : "DCC SEND ") + filename + " ";
+        sprintf(buffer, "%lu %hu %llu", (passive ? 0 : static_cast<unsigned long>(ntohl(s->get_dcc_address()))),
+            io.get_port(), static_cast<unsigned long long>(xfer->get_filesize()));
+        req += buffer;
+        if (passive) {
+            req += " " + io.get_token();
+        }
+        req += "\x01";
+        s->send(req);
+        xfer->start();
+    }
+
+    void DCCManager::receive_xfer_nolock(DCCXfer *xfer, bool resume) {
+        Session *s = xfer->get_session();
+        const std::string& filename = xfer->get_filename();
+        std::string part_filename = get_storage(get_part_filename(filename));
+        if (!resume || !s || !file_exists(part_filename)) {
+            begin_dcc_nolock(xfer);
+            return;
+        }
+
+        /* setup resume position */
+        try {
+            /* resume behind the last verified block only */
+            u64 startpos = 0;
+            u32 checksum;
+            if (!DCCXferOut::read_part_checksum(part_filename, startpos, checksum) || !startpos) {
+                throw DCCManagerException("Partial file has no checksum.");
+            }
+            if (startpos > static_cast<u64>(get_filesize(get_storage(filename)))) {
+                throw DCCManagerException("Partial file is shorter than its checksum.");
+            }
+            /* avoid a send hang bug in weechat */
+            if (startpos && xfer->get_filesize() == startpos) {
+                startpos--;
+            }
+            /* send resume request */
+            const std::string& nick = xfer->get_his_nick();
+            char port_str[32];
+            char startpos_str[32];
+            sprintf(port_str, "%hu", xfer->get_dccio().get_port());
+            sprintf(startpos_str, "%llu", static_cast<unsigned long long>(startpos));
+            std::string reply("PRIVMSG " + nick + " :\x01");
+            reply += "DCC RESUME " + filename + " ";
+            reply += port_str;
+            reply += " ";
+            reply += startpos_str;
+            if (xfer->get_dccio().get_token().length()) {
+                reply += " " + xfer->get_dccio().get_token();
+            }
+            reply += "\x01";
+            s->send(reply);
+        } catch (const Exception& e) {
+            /* start over, the old file is renamed */
+            remove(part_filename.c_str());
+            begin_dcc_nolock(xfer);
+        }
+    }
+
+    void DCCManager::apply_bandwidth_limit(DCCLimitScope scope, u64 rate) {
+        {
+            ScopeMutex dcc_lock(&mtx);
+            ScopeMutex lock(&bw_mtx);
+            switch (scope) {
+                case DCCLimitGlobal:
+                    global_bucket.set_rate(rate);
+                    break;
+
+                case DCCLimitNick:
+                    nick_limit = rate;
+                    for (NickBuckets::iterator it = nick_buckets.begin(); it != nick_buckets.end(); it++) {
+                        it->second.set_rate(rate);
+                    }
+                    break;
+
+                case DCCLimitTransfer:
+                    /* running transfers follow, unless they have their own limit */
+                    transfer_limit = rate;
+                    for (DCC::List::iterator it = dccs.begin(); it != dccs.end(); it++) {
+                        if ((*it)->get_type() == DCCTypeXfer) {
+                            DCCXfer *xfer = static_cast<DCCXfer *>(*it);
+                            if (!xfer->has_own_limit()) {
+                                xfer->get_bucket().set_rate(rate);
+                            }
+                        }
+                    }
+                    break;
+            }
+        }
+        poller.wakeup();
+    }
+
+    TokenBucket& DCCManager::get_nick_bucket(const DCCXfer *xfer) {
+        std::string nick = xfer->get_his_nick();
+        to_lower(nick);
+        NickBuckets::iterator it = nick_buckets.find(nick);
+        if (it == nick_buckets.end()) {
+            /* later limit changes are applied to all buckets at once */
+            it = nick_buckets.insert(NickBuckets::value_type(nick, TokenBucket())).first;
+            it->second.set_rate(nick_limit);
+        }
+
+        return it->second;
+    }
+
+    void DCCManager::prune_nick_buckets_nolock() {
+        /* a nick without transfers starts over with a full bucket */
+        ScopeMutex lock(&bw_mtx);
+        NickBuckets::iterator it = nick_buckets.begin();
+        while (it != nick_buckets.end()) {
+            bool used = false;
+            for (DCC::List::iterator dit = dccs.begin(); dit != dccs.end(); dit++) {
+                DCC *dcc = *dit;
+                if (dcc->get_type() == DCCTypeXfer && is_equal(dcc->get_his_nick(), it->first)) {
+                    used = true;
+                    break;
+                }
+            }
+            if (used) {
+                it++;
+            } else {
+                nick_buckets.erase(it++);
+            }
         }
-        out_size = static_cast<u32>(sz);
-        reduce_filename(filename, out_filename);
     }
 
     void DCCManager::reduce_filename(const std::string& filename, std::string& out_filename) {
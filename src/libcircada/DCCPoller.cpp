@@ -0,0 +1,213 @@
+/*
+ *  DCCPoller.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/DCCPoller.hpp"
+#include "Circada/DCC.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+
+namespace Circada {
+
+    DCCPoller::DCCPoller() : running(false), started(false), listeners(*this) {
+        if (pipe(wakeup_fds) < 0) {
+            throw DCCPollerException("Cannot create wakeup pipe: " + std::string(strerror(errno)));
+        }
+        for (int i = 0; i < 2; i++) {
+            fcntl(wakeup_fds[i], F_SETFL, fcntl(wakeup_fds[i], F_GETFL, 0) | O_NONBLOCK);
+        }
+    }
+
+    DCCPoller::~DCCPoller() {
+        stop();
+        ::close(wakeup_fds[0]);
+        ::close(wakeup_fds[1]);
+    }
+
+    void DCCPoller::start() {
+        if (!started) {
+            running = true;
+            if (!thread_start()) {
+                running = false;
+                throw DCCPollerException("Starting dcc poller failed.");
+            }
+            started = true;
+        }
+    }
+
+    void DCCPoller::stop() {
+        if (started) {
+            running = false;
+            wakeup();
+            thread_join();
+            started = false;
+        }
+
+        /* delete left overs, the poller thread is gone */
+        ScopeMutex lock(&mtx);
+        for (List::iterator it = disposed.begin(); it != disposed.end(); it++) {
+            delete *it;
+        }
+        disposed.clear();
+        added.clear();
+        dccs.clear();
+    }
+
+    void DCCPoller::add(DCC *dcc) {
+        ScopeMutex lock(&mtx);
+        added.push_back(dcc);
+        wakeup();
+    }
+
+    void DCCPoller::dispose(DCC *dcc) {
+        ScopeMutex lock(&mtx);
+        List::iterator it = std::find(added.begin(), added.end(), dcc);
+        if (it != added.end()) {
+            added.erase(it);
+        }
+        disposed.push_back(dcc);
+        wakeup();
+    }
+
+    void DCCPoller::wakeup() {
+        char c = 0;
+        if (write(wakeup_fds[1], &c, 1) < 0) {
+            /* pipe is full, the poller wakes up anyway */
+        }
+    }
+
+    DCCListenerPool& DCCPoller::get_listeners() {
+        return listeners;
+    }
+
+    long DCCPoller::get_monotonic_ms() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    void DCCPoller::take_over() {
+        List new_dccs;
+        List old_dccs;
+        {
+            ScopeMutex lock(&mtx);
+            new_dccs.swap(added);
+            old_dccs.swap(disposed);
+        }
+
+        for (List::iterator it = old_dccs.begin(); it != old_dccs.end(); it++) {
+            List::iterator dit = std::find(dccs.begin(), dccs.end(), *it);
+            if (dit != dccs.end()) {
+                dccs.erase(dit);
+            }
+            delete *it;
+        }
+
+        for (List::iterator it = new_dccs.begin(); it != new_dccs.end(); it++) {
+            DCC *dcc = *it;
+            if (std::find(dccs.begin(), dccs.end(), dcc) == dccs.end()) {
+                dccs.push_back(dcc);
+                dcc->handle_start();
+            }
+        }
+    }
+
+    void DCCPoller::thread() {
+        std::vector<struct pollfd> fds;
+        List polled;
+        char drain[64];
+
+        /* a peer closing the connection must not kill us */
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &set, 0);
+
+        while (running) {
+            take_over();
+
+            /* collect fds and the nearest deadline */
+            struct pollfd pfd;
+            long now = get_monotonic_ms();
+            int timeout = -1;
+            fds.clear();
+            polled.clear();
+            pfd.fd = wakeup_fds[0];
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+            listeners.get_poll_fds(fds);
+            size_t first_dcc = fds.size();
+            for (List::iterator it = dccs.begin(); it != dccs.end(); it++) {
+                DCC *dcc = *it;
+                short events = dcc->get_poll_events();
+                if (events) {
+                    pfd.fd = dcc->get_poll_fd();
+                    pfd.events = events;
+                    fds.push_back(pfd);
+                    polled.push_back(dcc);
+                }
+                long deadline = dcc->get_deadline();
+                if (deadline >= 0) {
+                    long diff = (deadline > now ? deadline - now : 0);
+                    if (timeout < 0 || diff < timeout) {
+                        timeout = static_cast<int>(diff);
+                    }
+                }
+            }
+
+            int rv = poll(&fds[0], fds.size(), timeout);
+            if (rv < 0 && errno != EINTR) {
+                /* should never happen, do not spin */
+                usleep(100000);
+                continue;
+            }
+
+            if (fds[0].revents) {
+                while (read(wakeup_fds[0], drain, sizeof(drain)) > 0);
+            }
+
+            /* dispatch io, then timers */
+            if (rv > 0) {
+                for (size_t i = 1; i < first_dcc; i++) {
+                    if (fds[i].revents) {
+                        listeners.handle_events(fds[i].fd, fds[i].revents);
+                    }
+                }
+                for (size_t i = first_dcc; i < fds.size(); i++) {
+                    if (fds[i].revents) {
+                        polled[i - first_dcc]->handle_events(fds[i].revents);
+                    }
+                }
+            }
+            now = get_monotonic_ms();
+            for (List::iterator it = dccs.begin(); it != dccs.end(); it++) {
+                (*it)->handle_timer(now);
+            }
+        }
+    }
+
+} /* namespace Circada */
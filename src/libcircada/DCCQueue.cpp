@@ -0,0 +1,203 @@
+/*
+ *  DCCQueue.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/DCCQueue.hpp"
+#include "Circada/DCC.hpp"
+
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+
+namespace Circada {
+
+    namespace {
+
+        struct SizeOrder {
+            bool operator()(const DCCQueue::Entry *lhs, const DCCQueue::Entry *rhs) const {
+                if (lhs->filesize != rhs->filesize) {
+                    return lhs->filesize < rhs->filesize;
+                }
+                return lhs->sequence < rhs->sequence;
+            }
+        };
+
+        struct FifoOrder {
+            bool operator()(const DCCQueue::Entry *lhs, const DCCQueue::Entry *rhs) const {
+                return lhs->sequence < rhs->sequence;
+            }
+        };
+
+    } /* namespace */
+
+    DCCQueue::DCCQueue(const std::string& filename) : filename(filename), sequence(0) { }
+
+    DCCQueue::~DCCQueue() { }
+
+    void DCCQueue::load() {
+        /* one line per offer: sequence, server, nick and the file, tab separated */
+        std::ifstream f(filename.c_str());
+        if (f.is_open()) {
+            std::string line;
+            while (getline(f, line)) {
+                size_t p1 = line.find('\t');
+                size_t p2 = (p1 != std::string::npos ? line.find('\t', p1 + 1) : p1);
+                size_t p3 = (p2 != std::string::npos ? line.find('\t', p2 + 1) : p2);
+                if (p3 == std::string::npos) {
+                    continue;
+                }
+                Entry entry;
+                entry.sequence = strtoull(line.substr(0, p1).c_str(), 0, 10);
+                entry.server = line.substr(p1 + 1, p2 - p1 - 1);
+                entry.nick = line.substr(p2 + 1, p3 - p2 - 1);
+                entry.filename = line.substr(p3 + 1);
+                entry.filesize = 0;
+                entry.xfer = 0;
+                entry.persistent = true;
+                entries.push_back(entry);
+                if (entry.sequence > sequence) {
+                    sequence = entry.sequence;
+                }
+            }
+        }
+    }
+
+    void DCCQueue::save() {
+        std::string tmp_filename = filename + ".tmp";
+        {
+            std::ofstream f(tmp_filename.c_str());
+            if (!f.is_open()) {
+                throw DCCQueueException("Cannot open file for writing: " + tmp_filename);
+            }
+            std::vector<const Entry *> sorted;
+            get_sorted(DCCQueueOrderFifo, sorted);
+            for (std::vector<const Entry *>::iterator it = sorted.begin(); it != sorted.end(); it++) {
+                const Entry *entry = *it;
+                if (entry->persistent) {
+                    f << entry->sequence << '\t' << entry->server << '\t'
+                      << (entry->xfer ? entry->xfer->get_his_nick() : entry->nick) << '\t'
+                      << entry->filename << std::endl;
+                }
+            }
+            if (!f.good()) {
+                throw DCCQueueException("Cannot write file: " + tmp_filename);
+            }
+        }
+        if (rename(tmp_filename.c_str(), filename.c_str()) < 0) {
+            throw DCCQueueException("Cannot replace file: " + filename);
+        }
+    }
+
+    u64 DCCQueue::push(DCCXfer *xfer, const std::string& server, bool persistent, u64 sequence) {
+        /* a restored offer keeps its place in the queue */
+        Entry entry;
+        entry.sequence = (sequence ? sequence : ++this->sequence);
+        entry.server = server;
+        entry.nick = xfer->get_his_nick();
+        entry.filename = xfer->get_filename();
+        entry.filesize = xfer->get_filesize();
+        entry.xfer = xfer;
+        entry.persistent = persistent;
+        entries.push_back(entry);
+
+        return entry.sequence;
+    }
+
+    bool DCCQueue::remove(DCCXfer *xfer) {
+        for (Entries::iterator it = entries.begin(); it != entries.end(); it++) {
+            if (it->xfer == xfer) {
+                entries.erase(it);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    size_t DCCQueue::get_position(const DCCXfer *xfer, DCCQueueOrder order) const {
+        std::vector<const Entry *> sorted;
+        get_sorted(order, sorted);
+        size_t position = 0;
+        for (std::vector<const Entry *>::iterator it = sorted.begin(); it != sorted.end(); it++) {
+            if ((*it)->xfer) {
+                position++;
+                if ((*it)->xfer == xfer) {
+                    return position;
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    void DCCQueue::get_ordered(DCCQueueOrder order, Xfers& xfers) const {
+        std::vector<const Entry *> sorted;
+        get_sorted(order, sorted);
+        xfers.clear();
+        for (std::vector<const Entry *>::iterator it = sorted.begin(); it != sorted.end(); it++) {
+            if ((*it)->xfer) {
+                xfers.push_back((*it)->xfer);
+            }
+        }
+    }
+
+    bool DCCQueue::park(DCCXfer *xfer) {
+        /* the transfer is destroyed, but the offer is kept for later */
+        for (Entries::iterator it = entries.begin(); it != entries.end(); it++) {
+            if (it->xfer == xfer) {
+                if (!it->persistent) {
+                    entries.erase(it);
+                    return false;
+                }
+                it->nick = xfer->get_his_nick();
+                it->xfer = 0;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void DCCQueue::take_parked(const std::string& server, Entries& out_entries) {
+        out_entries.clear();
+        Entries::iterator it = entries.begin();
+        while (it != entries.end()) {
+            if (!it->xfer && it->server == server) {
+                out_entries.push_back(*it);
+                it = entries.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    void DCCQueue::get_sorted(DCCQueueOrder order, std::vector<const Entry *>& sorted) const {
+        sorted.clear();
+        for (Entries::const_iterator it = entries.begin(); it != entries.end(); it++) {
+            sorted.push_back(&*it);
+        }
+        if (order == DCCQueueOrderSize) {
+            std::sort(sorted.begin(), sorted.end(), SizeOrder());
+        } else {
+            std::sort(sorted.begin(), sorted.end(), FifoOrder());
+        }
+    }
+
+} /* namespace Circada */
@@ -0,0 +1,188 @@
+/*
+ *  FileWatcher.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/FileWatcher.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+namespace Circada {
+
+    FileWatcher::FileWatcher(FileWatcherListener& listener)
+        : listener(listener), running(false), started(false)
+    {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd < 0) {
+            throw FileWatcherException("Cannot initialize inotify: " + std::string(strerror(errno)));
+        }
+        if (pipe(wakeup_fds) < 0) {
+            ::close(inotify_fd);
+            throw FileWatcherException("Cannot create wakeup pipe: " + std::string(strerror(errno)));
+        }
+        for (int i = 0; i < 2; i++) {
+            fcntl(wakeup_fds[i], F_SETFL, fcntl(wakeup_fds[i], F_GETFL, 0) | O_NONBLOCK);
+        }
+    }
+
+    FileWatcher::~FileWatcher() {
+        stop();
+        ::close(inotify_fd);
+        ::close(wakeup_fds[0]);
+        ::close(wakeup_fds[1]);
+    }
+
+    void FileWatcher::start() {
+        if (!started) {
+            running = true;
+            if (!thread_start()) {
+                running = false;
+                throw FileWatcherException("Starting file watcher failed.");
+            }
+            started = true;
+        }
+    }
+
+    void FileWatcher::stop() {
+        if (started) {
+            running = false;
+            char c = 0;
+            if (write(wakeup_fds[1], &c, 1) < 0) {
+                /* pipe is full, the watcher wakes up anyway */
+            }
+            thread_join();
+            started = false;
+        }
+    }
+
+    void FileWatcher::watch(const std::string& filename) {
+        std::string path;
+        std::string file;
+        split_filename(filename, path, file);
+
+        ScopeMutex lock(&mtx);
+
+        /* inotify returns the same descriptor for the same directory */
+        int wd = inotify_add_watch(inotify_fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0) {
+            throw FileWatcherException("Cannot watch " + path + ": " + std::string(strerror(errno)));
+        }
+        Directory& dir = directories[wd];
+        dir.path = path;
+        dir.files[file] = filename;
+    }
+
+    void FileWatcher::unwatch(const std::string& filename) {
+        std::string path;
+        std::string file;
+        split_filename(filename, path, file);
+
+        ScopeMutex lock(&mtx);
+        for (Directories::iterator it = directories.begin(); it != directories.end(); it++) {
+            if (it->second.path == path) {
+                it->second.files.erase(file);
+                if (it->second.files.empty()) {
+                    inotify_rm_watch(inotify_fd, it->first);
+                    directories.erase(it);
+                }
+                break;
+            }
+        }
+    }
+
+    void FileWatcher::split_filename(const std::string& filename, std::string& path, std::string& file) {
+        size_t pos = filename.rfind('/');
+        if (pos == std::string::npos) {
+            path = ".";
+            file = filename;
+        } else {
+            path = (pos ? filename.substr(0, pos) : "/");
+            file = filename.substr(pos + 1);
+        }
+    }
+
+    void FileWatcher::read_events(Changes& changes) {
+        char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+        while (true) {
+            ssize_t len = read(inotify_fd, buffer, sizeof(buffer));
+            if (len <= 0) {
+                break;
+            }
+
+            ScopeMutex lock(&mtx);
+            for (char *ptr = buffer; ptr < buffer + len; ) {
+                const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+                ptr += sizeof(struct inotify_event) + event->len;
+
+                if (event->len) {
+                    Directories::iterator it = directories.find(event->wd);
+                    if (it != directories.end()) {
+                        Files::iterator file = it->second.files.find(event->name);
+                        if (file != it->second.files.end()) {
+                            changes.insert(file->second);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void FileWatcher::thread() {
+        Changes changes;
+
+        while (running) {
+            struct pollfd pfd[2];
+            pfd[0].fd = inotify_fd;
+            pfd[0].events = POLLIN;
+            pfd[0].revents = 0;
+            pfd[1].fd = wakeup_fds[0];
+            pfd[1].events = POLLIN;
+            pfd[1].revents = 0;
+
+            /* once something changed, wait until it is quiet */
+            int rv = poll(pfd, 2, changes.empty() ? -1 : SettleTimeout);
+            if (rv < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+
+            if (pfd[1].revents) {
+                char drain[64];
+                while (read(wakeup_fds[0], drain, sizeof(drain)) > 0);
+            }
+
+            if (pfd[0].revents) {
+                read_events(changes);
+            } else if (!rv && running) {
+                for (Changes::iterator it = changes.begin(); it != changes.end(); it++) {
+                    listener.file_changed(*it);
+                }
+                changes.clear();
+            }
+        }
+    }
+
+} /* namespace Circada */
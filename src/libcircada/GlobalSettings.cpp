@@ -52,4 +52,8 @@ namespace Circada {
         return encodings;
     }
 
+    Metrics& GlobalSettings::get_metrics() {
+        return metrics;
+    }
+
 } /* namespace Circada */
@@ -0,0 +1,193 @@
+/*
+ *  Highlighter.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/Highlighter.hpp"
+#include "Circada/RFC2812.hpp"
+
+#include <cstring>
+
+namespace Circada {
+
+    static const char *WordSeparators = " ,";
+    static const char *WordChars = CHARS_LETTER CHARS_DIGIT CHARS_SPECIAL "-";
+
+    Highlighter::Highlighter() : class_count(0), regex_compiled(false) {
+        compile();
+    }
+
+    Highlighter::~Highlighter() {
+        if (regex_compiled) {
+            regfree(&regex);
+        }
+    }
+
+    void Highlighter::set_nick(const std::string& nick) {
+        ScopeMutex lock(&mtx);
+        if (nick != this->nick) {
+            this->nick = nick;
+            compile();
+        }
+    }
+
+    void Highlighter::set_words(const std::string& words) {
+        Words new_words;
+        size_t pos = 0;
+        while ((pos = words.find_first_not_of(WordSeparators, pos)) != std::string::npos) {
+            size_t end = words.find_first_of(WordSeparators, pos);
+            new_words.push_back(words.substr(pos, end - pos));
+            pos = end;
+        }
+
+        ScopeMutex lock(&mtx);
+        this->words = new_words;
+        compile();
+    }
+
+    void Highlighter::set_regex(const std::string& regex) {
+        /* an invalid regex disables the old one, too */
+        ScopeMutex lock(&mtx);
+        if (regex_compiled) {
+            regfree(&this->regex);
+            regex_compiled = false;
+        }
+        if (regex.length()) {
+            compile_regex(&this->regex, regex);
+            regex_compiled = true;
+        }
+    }
+
+    bool Highlighter::is_highlighted(const std::string& text) {
+        ScopeMutex lock(&mtx);
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(text.data());
+        size_t len = text.length();
+        int state = 0;
+
+        /* one pass, every state knows all words ending in it */
+        for (size_t i = 0; i < len; i++) {
+            state = transitions[state * class_count + classes[p[i]]];
+            const Lengths& lengths = outputs[state];
+            for (Lengths::const_iterator it = lengths.begin(); it != lengths.end(); it++) {
+                size_t start = i + 1 - *it;
+                if ((!start || !is_word_char(p[start - 1])) && (i + 1 == len || !is_word_char(p[i + 1]))) {
+                    return true;
+                }
+            }
+        }
+
+        return (regex_compiled && !regexec(&regex, text.c_str(), 0, 0, 0));
+    }
+
+    void Highlighter::check_regex(const std::string& regex) {
+        if (regex.length()) {
+            regex_t preg;
+            compile_regex(&preg, regex);
+            regfree(&preg);
+        }
+    }
+
+    void Highlighter::compile() {
+        Words patterns;
+        if (nick.length()) {
+            patterns.push_back(nick);
+        }
+        for (Words::const_iterator it = words.begin(); it != words.end(); it++) {
+            patterns.push_back(*it);
+        }
+
+        /* only the characters of the patterns get a class of their */
+        /* own, all others share class 0, which leads to the root.  */
+        memset(classes, 0, sizeof(classes));
+        class_count = 1;
+        for (Words::const_iterator it = patterns.begin(); it != patterns.end(); it++) {
+            for (std::string::const_iterator cit = it->begin(); cit != it->end(); cit++) {
+                unsigned char c = fold(*cit);
+                if (!classes[c]) {
+                    classes[c] = static_cast<unsigned char>(class_count++);
+                }
+            }
+        }
+        for (int c = 0; c < 256; c++) {
+            classes[c] = classes[fold(c)];
+        }
+
+        /* trie */
+        transitions.assign(class_count, -1);
+        outputs.assign(1, Lengths());
+        for (Words::const_iterator it = patterns.begin(); it != patterns.end(); it++) {
+            int state = 0;
+            for (std::string::const_iterator cit = it->begin(); cit != it->end(); cit++) {
+                size_t index = state * class_count + classes[static_cast<unsigned char>(*cit)];
+                if (transitions[index] < 0) {
+                    transitions[index] = static_cast<int>(outputs.size());
+                    outputs.push_back(Lengths());
+                    transitions.resize(outputs.size() * class_count, -1);
+                }
+                state = transitions[index];
+            }
+            outputs[state].push_back(it->length());
+        }
+
+        /* breadth first, fill the missing transitions with the ones */
+        /* of the failure state, which is already complete.          */
+        std::vector<int> failures(outputs.size(), 0);
+        std::vector<int> queue;
+        for (size_t c = 0; c < class_count; c++) {
+            int& next = transitions[c];
+            if (next < 0) {
+                next = 0;
+            } else {
+                queue.push_back(next);
+            }
+        }
+        for (size_t i = 0; i < queue.size(); i++) {
+            int state = queue[i];
+            const Lengths& inherited = outputs[failures[state]];
+            outputs[state].insert(outputs[state].end(), inherited.begin(), inherited.end());
+            for (size_t c = 0; c < class_count; c++) {
+                int& next = transitions[state * class_count + c];
+                int fallback = transitions[failures[state] * class_count + c];
+                if (next < 0) {
+                    next = fallback;
+                } else {
+                    failures[next] = fallback;
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+
+    unsigned char Highlighter::fold(unsigned char c) {
+        return ((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+    }
+
+    bool Highlighter::is_word_char(unsigned char c) {
+        return (c && strchr(WordChars, c) != 0);
+    }
+
+    void Highlighter::compile_regex(regex_t *preg, const std::string& regex) {
+        int rv = regcomp(preg, regex.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB);
+        if (rv) {
+            char buffer[256];
+            regerror(rv, preg, buffer, sizeof(buffer));
+            throw HighlighterException("Invalid highlight regex: " + std::string(buffer));
+        }
+    }
+
+} /* namespace Circada */
@@ -23,6 +23,7 @@
 #include <cerrno>
 #include <cstring>
 #include <fcntl.h>
+#include <poll.h>
 
 namespace Circada {
 
@@ -60,6 +61,25 @@ namespace Circada {
         return true;
     }
 
+    /* waits at most timeout ms, a negative timeout waits forever */
+    bool IOSync::io_sync_wait_for_event(int timeout) {
+        struct pollfd pfd;
+        pfd.fd = pipefd[0];
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int rv = poll(&pfd, 1, timeout);
+        if (rv < 0) {
+            if (errno == EINTR) return false;
+            throw IOSyncException("Cannot poll pipe: " + std::string(strerror(errno)));
+        }
+        if (!rv) {
+            return false;
+        }
+
+        return io_sync_wait_for_event();
+    }
+
     void IOSync::io_sync_signal_event() {
         write(pipefd[1], signal_buffer, sizeof(signal_buffer));
     }
@@ -22,7 +22,8 @@
 
 namespace Circada {
 
-    IrcServerSide::IrcServerSide(Configuration& config) : DCCManager(config, *this, *this) { }
+    IrcServerSide::IrcServerSide(Configuration& config)
+        : WindowManager(get_metrics()), DCCManager(config, *this, *this, get_metrics()) { }
 
     IrcServerSide::~IrcServerSide() { }
 
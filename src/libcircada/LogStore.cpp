@@ -0,0 +1,370 @@
+/*
+ *  LogStore.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/LogStore.hpp"
+
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+namespace Circada {
+
+    /* file layout:
+     *   header:  "CIRCLOG" + version byte
+     *   record:  u32 length of the rest of the record
+     *            i64 time, u8 type, u8 nick length, nick, text
+     */
+    static const char LogHeader[] = { 'C', 'I', 'R', 'C', 'L', 'O', 'G', 1 };
+    static const size_t LogHeaderLength = sizeof(LogHeader);
+    static const size_t RecordFixedLength = sizeof(int64_t) + 2;
+
+    LogStore::LogStore(const std::string& filename, bool read_only)
+        : filename(filename), index_filename(filename + ".idx"), read_only(read_only), fd(-1), index_fd(-1),
+          index_written(0), file_size(0), records(0), written_records(0), map(0), map_size(0)
+    {
+        if (read_only) {
+            fd = open(filename.c_str(), O_RDONLY);
+        } else {
+            fd = open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+        }
+        if (fd < 0) {
+            throw LogStoreException("Cannot open log " + filename + ": " + strerror(errno));
+        }
+
+        struct stat info;
+        if (fstat(fd, &info)) {
+            close(fd);
+            throw LogStoreException("Cannot stat log " + filename + ": " + strerror(errno));
+        }
+        file_size = info.st_size;
+
+        if (!file_size && !read_only) {
+            if (write(fd, LogHeader, LogHeaderLength) != static_cast<ssize_t>(LogHeaderLength)) {
+                close(fd);
+                throw LogStoreException("Cannot write log " + filename + ": " + strerror(errno));
+            }
+            file_size = LogHeaderLength;
+        } else {
+            char header[LogHeaderLength];
+            if (pread(fd, header, LogHeaderLength, 0) != static_cast<ssize_t>(LogHeaderLength) ||
+                memcmp(header, LogHeader, LogHeaderLength))
+            {
+                close(fd);
+                throw LogStoreException("Invalid log file: " + filename);
+            }
+        }
+
+        /* without an index, read-only stores build it in memory */
+        if (read_only) {
+            index_fd = open(index_filename.c_str(), O_RDONLY);
+        } else {
+            index_fd = open(index_filename.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+        }
+        if (index_fd < 0 && (!read_only || errno != ENOENT)) {
+            close(fd);
+            throw LogStoreException("Cannot open log index " + index_filename + ": " + strerror(errno));
+        }
+
+        try {
+            load_index();
+        } catch (...) {
+            unmap_file();
+            if (index_fd >= 0) {
+                close(index_fd);
+            }
+            close(fd);
+            throw;
+        }
+    }
+
+    LogStore::~LogStore() {
+        try {
+            flush();
+        } catch (const LogStoreException&) {
+            /* chomp */
+        }
+        unmap_file();
+        if (index_fd >= 0) {
+            close(index_fd);
+        }
+        close(fd);
+    }
+
+    const std::string& LogStore::get_filename() const {
+        return filename;
+    }
+
+    void LogStore::append(time_t when, unsigned char type, const std::string& nick, const std::string& text) {
+        if (read_only) {
+            throw LogStoreException("Log is opened read-only: " + filename);
+        }
+
+        size_t nick_length = (nick.length() > 255 ? 255 : nick.length());
+        uint32_t length = RecordFixedLength + nick_length + text.length();
+        int64_t t = when;
+
+        if (!(records % IndexStep)) {
+            IndexEntry entry;
+            entry.when = t;
+            entry.offset = file_size + buffer.length();
+            index.push_back(entry);
+        }
+
+        buffer.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        buffer.append(reinterpret_cast<const char *>(&t), sizeof(t));
+        buffer += static_cast<char>(type);
+        buffer += static_cast<char>(nick_length);
+        buffer.append(nick, 0, nick_length);
+        buffer += text;
+        records++;
+
+        if (buffer.length() >= FlushSize) {
+            flush();
+        }
+    }
+
+    void LogStore::flush() {
+        /* the log first, a crash in between is repaired by load_index() */
+        size_t sz = buffer.length();
+        if (sz) {
+            const char *p = buffer.data();
+            while (sz) {
+                ssize_t rv = write(fd, p, sz);
+                if (rv < 0) {
+                    if (errno == EINTR) continue;
+                    throw LogStoreException("Cannot write log " + filename + ": " + strerror(errno));
+                }
+                p += rv;
+                sz -= rv;
+            }
+            file_size += buffer.length();
+            buffer.clear();
+            written_records = records;
+        }
+
+        size_t entries = index.size() - index_written;
+        if (entries) {
+            size_t len = entries * sizeof(IndexEntry);
+            off_t offset = index_written * sizeof(IndexEntry);
+            if (pwrite(index_fd, &index[index_written], len, offset) != static_cast<ssize_t>(len)) {
+                throw LogStoreException("Cannot write log index " + index_filename + ": " + strerror(errno));
+            }
+            index_written = index.size();
+        }
+    }
+
+    size_t LogStore::get_record_count() const {
+        return records;
+    }
+
+    bool LogStore::get_record(size_t nbr, LogRecord& record) {
+        uint64_t offset;
+        if (!seek(nbr, offset)) {
+            return false;
+        }
+
+        return parse(offset, &record, &offset);
+    }
+
+    size_t LogStore::get_records(size_t nbr, size_t count, LogRecords& records) {
+        /* appends up to count records, starting at nbr */
+        uint64_t offset;
+        size_t read = 0;
+        if (nbr + count > written_records) {
+            flush();
+        }
+        if (seek(nbr, offset)) {
+            LogRecord record;
+            while (read < count && nbr + read < written_records && parse(offset, &record, &offset)) {
+                records.push_back(record);
+                read++;
+            }
+        }
+
+        return read;
+    }
+
+    size_t LogStore::find(time_t when) {
+        /* first record, which is not older than when */
+        size_t lo = 0;
+        size_t hi = index.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (index[mid].when < when) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        size_t nbr = (lo ? (lo - 1) * IndexStep : 0);
+        LogRecord record;
+        while (get_record(nbr, record) && record.when < when) {
+            nbr++;
+        }
+
+        return nbr;
+    }
+
+    void LogStore::load_index() {
+        /* load stored index */
+        struct stat info;
+        if (index_fd >= 0 && !fstat(index_fd, &info)) {
+            size_t entries = info.st_size / sizeof(IndexEntry);
+            if (entries) {
+                index.resize(entries);
+                if (pread(index_fd, &index[0], entries * sizeof(IndexEntry), 0) != static_cast<ssize_t>(entries * sizeof(IndexEntry))) {
+                    index.clear();
+                }
+            }
+        }
+
+        /* drop entries, which point behind the end of the log */
+        uint64_t last_offset = LogHeaderLength;
+        size_t valid = 0;
+        while (valid < index.size() && index[valid].offset >= last_offset && index[valid].offset < file_size) {
+            last_offset = index[valid].offset;
+            valid++;
+        }
+        index.resize(valid);
+
+        /* scan the rest of the log and complete the index */
+        uint64_t offset = LogHeaderLength;
+        records = 0;
+        if (valid) {
+            offset = index[valid - 1].offset;
+            records = (valid - 1) * IndexStep;
+        }
+        map_file();
+        LogRecord record;
+        uint64_t next;
+        while (offset < file_size) {
+            if (!parse(offset, &record, &next)) {
+                /* a record, that is being written, or a crash */
+                if (read_only) {
+                    file_size = offset;
+                    break;
+                }
+
+                /* cut off a partially written record */
+                unmap_file();
+                if (ftruncate(fd, offset)) {
+                    throw LogStoreException("Cannot repair log " + filename + ": " + strerror(errno));
+                }
+                file_size = offset;
+                break;
+            }
+            if (!(records % IndexStep) && records / IndexStep >= index.size()) {
+                IndexEntry entry;
+                entry.when = record.when;
+                entry.offset = offset;
+                index.push_back(entry);
+            }
+            records++;
+            offset = next;
+        }
+        written_records = records;
+        if (read_only) {
+            index_written = index.size();
+            return;
+        }
+
+        /* rewrite index */
+        if (ftruncate(index_fd, valid * sizeof(IndexEntry))) {
+            throw LogStoreException("Cannot repair log index " + index_filename + ": " + strerror(errno));
+        }
+        index_written = valid;
+        flush();
+    }
+
+    void LogStore::map_file() {
+        if (map_size != file_size) {
+            unmap_file();
+            void *p = mmap(0, file_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                throw LogStoreException("Cannot map log " + filename + ": " + strerror(errno));
+            }
+            map = static_cast<const char *>(p);
+            map_size = file_size;
+        }
+    }
+
+    void LogStore::unmap_file() {
+        if (map) {
+            munmap(const_cast<char *>(map), map_size);
+            map = 0;
+            map_size = 0;
+        }
+    }
+
+    bool LogStore::seek(size_t nbr, uint64_t& offset) {
+        if (nbr >= records) {
+            return false;
+        }
+        if (nbr >= written_records) {
+            flush();
+        }
+        map_file();
+
+        offset = index[nbr / IndexStep].offset;
+        for (size_t i = nbr % IndexStep; i; i--) {
+            if (!parse(offset, 0, &offset)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool LogStore::parse(uint64_t offset, LogRecord *record, uint64_t *next) {
+        uint32_t length;
+        if (offset + sizeof(length) > map_size) {
+            return false;
+        }
+        memcpy(&length, map + offset, sizeof(length));
+        offset += sizeof(length);
+        if (length < RecordFixedLength || offset + length > map_size) {
+            return false;
+        }
+
+        const char *p = map + offset;
+        size_t nick_length = static_cast<unsigned char>(p[sizeof(int64_t) + 1]);
+        if (RecordFixedLength + nick_length > length) {
+            return false;
+        }
+
+        if (record) {
+            int64_t t;
+            memcpy(&t, p, sizeof(t));
+            record->when = t;
+            record->type = p[sizeof(int64_t)];
+            record->nick.assign(p + RecordFixedLength, nick_length);
+            record->text.assign(p + RecordFixedLength + nick_length, length - RecordFixedLength - nick_length);
+        }
+        *next = offset + length;
+
+        return true;
+    }
+
+} /* namespace Circada */
@@ -0,0 +1,230 @@
+/*
+ *  Metrics.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/Metrics.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+namespace Circada {
+
+    /**************************************************************************
+     * MetricHistogram
+     **************************************************************************/
+    const u64 MetricHistogram::Bounds[BucketCount] = {
+        1, 2, 5, 10, 20, 50, 100, 200, 500,
+        1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+        1000000, 2000000, 5000000, 10000000
+    };
+
+    MetricHistogram::MetricHistogram() : count(0), sum(0) {
+        for (int i = 0; i <= BucketCount; i++) {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void MetricHistogram::observe(u64 us) {
+        int i = 0;
+        while (i < BucketCount && us > Bounds[i]) {
+            i++;
+        }
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(us, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    u64 MetricHistogram::get_count() const {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    u64 MetricHistogram::get_sum() const {
+        return sum.load(std::memory_order_relaxed);
+    }
+
+    u64 MetricHistogram::get_bucket(int index) const {
+        return buckets[index].load(std::memory_order_relaxed);
+    }
+
+    u64 MetricHistogram::get_quantile(double q) const {
+        u64 total = 0;
+        for (int i = 0; i <= BucketCount; i++) {
+            total += get_bucket(i);
+        }
+        if (!total) {
+            return 0;
+        }
+
+        u64 rank = static_cast<u64>(q * total + 0.5);
+        if (!rank) rank = 1;
+        u64 seen = 0;
+        for (int i = 0; i < BucketCount; i++) {
+            seen += get_bucket(i);
+            if (seen >= rank) {
+                return Bounds[i];
+            }
+        }
+
+        return Bounds[BucketCount - 1];
+    }
+
+    u64 MetricHistogram::get_bound(int index) {
+        return Bounds[index];
+    }
+
+    u64 MetricHistogram::get_now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<u64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    /**************************************************************************
+     * Metrics
+     **************************************************************************/
+    Metrics::Metrics() { }
+
+    Metrics::~Metrics() {
+        for (Entries::iterator it = entries.begin(); it != entries.end(); it++) {
+            delete it->counter;
+            delete it->gauge;
+            delete it->histogram;
+        }
+    }
+
+    MetricCounter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+        return *find_or_add(name, help, labels, MetricTypeCounter).counter;
+    }
+
+    MetricGauge& Metrics::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+        return *find_or_add(name, help, labels, MetricTypeGauge).gauge;
+    }
+
+    MetricHistogram& Metrics::histogram(const std::string& name, const std::string& help, const std::string& labels) {
+        return *find_or_add(name, help, labels, MetricTypeHistogram).histogram;
+    }
+
+    Metrics::Entries Metrics::get_entries() {
+        ScopeMutex lock(&mtx);
+        return entries;
+    }
+
+    void Metrics::write_prometheus(std::string& out) {
+        Entries sorted = get_entries();
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Entry& a, const Entry& b) {
+            return a.name < b.name;
+        });
+
+        static const char *types[] = { "counter", "gauge", "histogram" };
+        char buffer[64];
+        std::string last_name;
+        for (Entries::const_iterator it = sorted.begin(); it != sorted.end(); it++) {
+            const Entry& e = *it;
+            if (e.name != last_name) {
+                out += "# HELP " + e.name + " " + e.help + "\n";
+                out += "# TYPE " + e.name + " " + types[e.type] + "\n";
+                last_name = e.name;
+            }
+            std::string labels = (e.labels.length() ? "{" + e.labels + "}" : "");
+            switch (e.type) {
+                case MetricTypeCounter:
+                    snprintf(buffer, sizeof(buffer), " %llu\n", static_cast<unsigned long long>(e.counter->get()));
+                    out += e.name + labels + buffer;
+                    break;
+
+                case MetricTypeGauge:
+                    snprintf(buffer, sizeof(buffer), " %lld\n", static_cast<long long>(e.gauge->get()));
+                    out += e.name + labels + buffer;
+                    break;
+
+                case MetricTypeHistogram:
+                {
+                    std::string prefix = (e.labels.length() ? "{" + e.labels + "," : "{");
+                    u64 cumulative = 0;
+                    for (int i = 0; i <= MetricHistogram::BucketCount; i++) {
+                        cumulative += e.histogram->get_bucket(i);
+                        if (i < MetricHistogram::BucketCount) {
+                            snprintf(buffer, sizeof(buffer), "le=\"%g\"} %llu\n", MetricHistogram::get_bound(i) / 1e6,
+                                static_cast<unsigned long long>(cumulative));
+                        } else {
+                            snprintf(buffer, sizeof(buffer), "le=\"+Inf\"} %llu\n", static_cast<unsigned long long>(cumulative));
+                        }
+                        out += e.name + "_bucket" + prefix + buffer;
+                    }
+                    snprintf(buffer, sizeof(buffer), " %.6f\n", e.histogram->get_sum() / 1e6);
+                    out += e.name + "_sum" + labels + buffer;
+                    snprintf(buffer, sizeof(buffer), " %llu\n", static_cast<unsigned long long>(cumulative));
+                    out += e.name + "_count" + labels + buffer;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::string Metrics::label(const std::string& key, const std::string& value) {
+        std::string escaped;
+        size_t sz = value.length();
+        for (size_t i = 0; i < sz; i++) {
+            switch (value[i]) {
+                case '\\':
+                    escaped += "\\\\";
+                    break;
+
+                case '"':
+                    escaped += "\\\"";
+                    break;
+
+                case '\n':
+                    escaped += "\\n";
+                    break;
+
+                default:
+                    escaped += value[i];
+                    break;
+            }
+        }
+
+        return key + "=\"" + escaped + "\"";
+    }
+
+    Metrics::Entry Metrics::find_or_add(const std::string& name, const std::string& help, const std::string& labels, MetricType type) {
+        ScopeMutex lock(&mtx);
+        for (Entries::iterator it = entries.begin(); it != entries.end(); it++) {
+            if (it->name == name && it->labels == labels) {
+                if (it->type != type) {
+                    throw MetricsException("Metric " + name + " is registered with another type.");
+                }
+                return *it;
+            }
+        }
+
+        Entry e;
+        e.name = name;
+        e.labels = labels;
+        e.help = help;
+        e.type = type;
+        e.counter = (type == MetricTypeCounter ? new MetricCounter : 0);
+        e.gauge = (type == MetricTypeGauge ? new MetricGauge : 0);
+        e.histogram = (type == MetricTypeHistogram ? new MetricHistogram : 0);
+        entries.push_back(e);
+
+        return e;
+    }
+
+} /* namespace Circada */
@@ -0,0 +1,220 @@
+/*
+ *  MetricsExporter.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/MetricsExporter.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+namespace Circada {
+
+    MetricsExporter::MetricsExporter(Configuration& config, Metrics& metrics)
+        : config(config), metrics(metrics), running(false), started(false), listen_fd(-1)
+    {
+        if (pipe(wakeup_fds) < 0) {
+            throw MetricsExporterException("Cannot create wakeup pipe: " + std::string(strerror(errno)));
+        }
+        for (int i = 0; i < 2; i++) {
+            fcntl(wakeup_fds[i], F_SETFL, fcntl(wakeup_fds[i], F_GETFL, 0) | O_NONBLOCK);
+        }
+        config.add_listener(this);
+
+        /* a broken socket path must not keep the client from starting */
+        try {
+            start(config.get_value("", "metrics_socket"));
+        } catch (const MetricsExporterException& e) {
+            /* chance to fix it with /set, the frontend tells about it */
+            ScopeMutex lock(&mtx);
+            error = e.what();
+        }
+    }
+
+    MetricsExporter::~MetricsExporter() {
+        config.remove_listener(this);
+        stop();
+        ::close(wakeup_fds[0]);
+        ::close(wakeup_fds[1]);
+    }
+
+    void MetricsExporter::start(const std::string& path) {
+        ScopeMutex lock(&mtx);
+        if (started) {
+            return;
+        }
+        error.clear();
+        if (!path.length()) {
+            return;
+        }
+
+        std::string filename = (path[0] == '/' ? path : config.get_working_directory() + "/" + path);
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        if (filename.length() >= sizeof(addr.sun_path)) {
+            throw MetricsExporterException("Metrics socket path is too long: " + filename);
+        }
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, filename.c_str());
+
+        /* a stale socket of a crashed client is replaced */
+        struct stat st;
+        if (!lstat(filename.c_str(), &st) && S_ISSOCK(st.st_mode)) {
+            unlink(filename.c_str());
+        }
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0) {
+            throw MetricsExporterException("Cannot create metrics socket: " + std::string(strerror(errno)));
+        }
+        /* nobody can connect before listen, so chmod in between is safe */
+        if (bind(listen_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+            std::string err(strerror(errno));
+            ::close(listen_fd);
+            listen_fd = -1;
+            throw MetricsExporterException("Cannot listen on " + filename + ": " + err);
+        }
+        if (chmod(filename.c_str(), S_IRUSR | S_IWUSR) < 0 || listen(listen_fd, 8) < 0) {
+            std::string err(strerror(errno));
+            ::close(listen_fd);
+            listen_fd = -1;
+            unlink(filename.c_str());
+            throw MetricsExporterException("Cannot listen on " + filename + ": " + err);
+        }
+
+        this->path = filename;
+        running = true;
+        if (!thread_start()) {
+            running = false;
+            ::close(listen_fd);
+            listen_fd = -1;
+            unlink(filename.c_str());
+            throw MetricsExporterException("Starting metrics exporter failed.");
+        }
+        started = true;
+    }
+
+    void MetricsExporter::stop() {
+        ScopeMutex lock(&mtx);
+        if (started) {
+            running = false;
+            char c = 0;
+            if (write(wakeup_fds[1], &c, 1) < 0) {
+                /* pipe is full, the exporter wakes up anyway */
+            }
+            thread_join();
+            started = false;
+            ::close(listen_fd);
+            listen_fd = -1;
+            unlink(path.c_str());
+            path.clear();
+
+            /* drain wakeups */
+            while (read(wakeup_fds[0], &c, 1) > 0);
+        }
+    }
+
+    const std::string& MetricsExporter::get_path() const {
+        return path;
+    }
+
+    std::string MetricsExporter::get_error() {
+        ScopeMutex lock(&mtx);
+        return error;
+    }
+
+    void MetricsExporter::configuration_changed(const std::string& category, const std::string& key, const std::string& value) {
+        if (!category.length() && key == "metrics_socket") {
+            /* a listener must not throw, the other ones are not told then */
+            stop();
+            try {
+                start(value);
+            } catch (const MetricsExporterException& e) {
+                ScopeMutex lock(&mtx);
+                error = e.what();
+            }
+        }
+    }
+
+    void MetricsExporter::serve(int fd) {
+        /* wait shortly for a request, plain clients send nothing */
+        char request[1024];
+        ssize_t len = 0;
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, RequestTimeout) > 0) {
+            len = recv(fd, request, sizeof(request) - 1, 0);
+        }
+        bool http = (len >= 4 && (!strncmp(request, "GET ", 4) || !strncmp(request, "HEAD", 4)));
+
+        std::string body;
+        metrics.write_prometheus(body);
+        std::string out;
+        if (http) {
+            char buffer[160];
+            snprintf(buffer, sizeof(buffer), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: %lu\r\nConnection: close\r\n\r\n", static_cast<unsigned long>(body.length()));
+            out = buffer;
+        }
+        if (!http || strncmp(request, "HEAD", 4)) {
+            out += body;
+        }
+
+        /* a scraper, that stops reading, must not hang the exporter */
+        struct timeval tv;
+        tv.tv_sec = SendTimeout / 1000;
+        tv.tv_usec = (SendTimeout % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        size_t sent = 0;
+        while (sent < out.length()) {
+            ssize_t n = send(fd, out.data() + sent, out.length() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                break;
+            }
+            sent += n;
+        }
+    }
+
+    void MetricsExporter::thread() {
+        while (running) {
+            struct pollfd pfds[2] = { { listen_fd, POLLIN, 0 }, { wakeup_fds[0], POLLIN, 0 } };
+            if (poll(pfds, 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (!running) {
+                break;
+            }
+            if (pfds[0].revents & POLLIN) {
+                int fd = accept4(listen_fd, 0, 0, SOCK_CLOEXEC);
+                if (fd >= 0) {
+                    serve(fd);
+                    ::close(fd);
+                }
+            }
+        }
+    }
+
+} /* namespace Circada */
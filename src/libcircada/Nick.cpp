@@ -25,19 +25,7 @@
 
 namespace Circada {
 
-    bool Nick::is_nick_in_text(const std::string& nick, const std::string& text) {
-        if (is_equal(nick, text)) return true;
-        if (text.find(" " + nick) != std::string::npos) return true;
-        if (text.find(nick + " ") != std::string::npos) return true;
-        if (text.find("~" + nick) != std::string::npos) return true;
-        if (text.find(nick + "~") != std::string::npos) return true;
-        if (text.find(nick + ":") != std::string::npos) return true;
-        if (text.find(nick + ",") != std::string::npos) return true;
-
-        return false;
-    }
-
-    Nick::Nick(const std::string& nick, ServerNickPrefix *snp) {
+    Nick::Nick(const std::string& nick, ServerNickPrefix *snp) : flag(' ') {
         this->snp = snp;
         set_nick(nick);
     }
@@ -52,19 +40,7 @@ namespace Circada {
     }
 
     char Nick::get_flag() {
-        if (snp) {
-            const std::string& nick_chars = snp->get_nick_chars();
-            const std::string& nick_symbols = snp->get_nick_symbols();
-            size_t sz = nick_chars.length();
-
-            for (size_t i = 0; i < sz; i++) {
-                if (flags.is_flag_set(nick_chars[i])) {
-                    return nick_symbols[i];
-                }
-            }
-        }
-
-        return ' ';
+        return flag;
     }
 
     void Nick::set_nick(const std::string& nick) {
@@ -91,13 +67,30 @@ namespace Circada {
         return nick;
     }
 
+    void Nick::set_flag() {
+        flag = ' ';
+        if (snp) {
+            const std::string& nick_chars = snp->get_nick_chars();
+            const std::string& nick_symbols = snp->get_nick_symbols();
+            size_t sz = nick_chars.length();
+
+            for (size_t i = 0; i < sz; i++) {
+                if (flags.is_flag_set(nick_chars[i])) {
+                    flag = nick_symbols[i];
+                    break;
+                }
+            }
+        }
+    }
+
     void Nick::set_sortnick() {
+        /* the flag is cached, it is needed on every nicklist draw */
+        set_flag();
         if (snp) {
             const std::string& nick_symbols = snp->get_nick_symbols();
             size_t pos;
 
             sortnick.clear();
-            char flag = get_flag();
             if ((pos = nick_symbols.find(flag)) != std::string::npos) {
                 sortnick.push_back(static_cast<char>(pos + 1));
             } else {
@@ -64,6 +64,7 @@ namespace Circada {
         { "invite ", 0, &Parser::cmd_std_2, false },
         { "ison ", 0, &Parser::cmd_std_1, false },
         { "join ", 0, &Parser::cmd_std_1, false },
+        { "jump ", 0, 0, true },
         { "kick ", 0, &Parser::cmd_std_2_colon_opt, false },
         { "kill ", 0, 0, false },
         { "knock ", 0, &Parser::cmd_std_1, false },
@@ -102,6 +103,7 @@ namespace Circada {
         { "restart ", 0, 0, false },
         { "rootserv ", 0, &Parser::cmd_std_1, false },
         { "save ", 0, 0, true },
+        { "search ", 0, 0, true },
         { "service ", 0, 0, false },
         { "servlist ", 0, 0, false },
         { "set ", 0, 0, true },
@@ -110,7 +112,7 @@ namespace Circada {
         { "squery ", 0, 0, false },
         { "squit ", 0, 0, false },
         { "ss ", "SPAMSERV", &Parser::cmd_std_1, false },
-        { "stats ", 0, 0, false },
+        { "stats ", 0, 0, true },
         { "statserv ", 0, &Parser::cmd_std_1, false },
         { "summon ", 0, 0, false },
         { "time ", 0, 0, false },
@@ -35,9 +35,12 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <atomic>
 
 namespace Circada {
 
+    static std::atomic<unsigned long> next_session_id(0);
+
     class SuicideThread : public Thread {
     private:
         SuicideThread(const SenderThread& rhs);
@@ -55,8 +58,11 @@ namespace Circada {
         virtual void thread();
     };
 
-    SenderThread::SenderThread(Socket *socket)
-        : socket(socket), running(false)
+    SenderThread::SenderThread(Socket *socket, Metrics& metrics, const std::string& labels)
+        : socket(socket), running(false),
+          lines_sent(metrics.counter("circada_session_lines_sent_total", "Lines sent to the server.", labels)),
+          bytes_sent(metrics.counter("circada_session_bytes_sent_total", "Bytes sent to the server.", labels)),
+          queue_depth(metrics.gauge("circada_session_send_queue_depth", "Lines waiting to be sent to the server.", labels))
     {
         running = true;
         if (!thread_start()) {
@@ -74,17 +80,27 @@ namespace Circada {
     void SenderThread::pump(const std::string& data) {
         ScopeMutex lock(&mtx);
         queue.push(data);
+        queue_depth.add(1);
         io_sync_signal_event();
     }
 
     void SenderThread::send(const std::string& data) {
         try {
             socket->send(data + "\r\n");
+            lines_sent.add(1);
+            bytes_sent.add(data.length() + 2);
         } catch (const SocketException& e) {
             throw SessionException(e.what());
         }
     }
 
+    void SenderThread::clear_queue() {
+        ScopeMutex lock(&mtx);
+        queue_depth.add(-static_cast<s64>(queue.size()));
+        Queue empty;
+        std::swap(queue, empty);
+    }
+
     void SenderThread::thread() {
         while (running) {
             /* outgoing data */
@@ -101,21 +117,20 @@ namespace Circada {
                         if (queue.empty()) break;
                         data = queue.front();
                         queue.pop();
+                        queue_depth.add(-1);
                         queue_empty = queue.empty();
                     }
                     try {
                         send(data);
                     } catch (const SessionException& e) {
-                        Queue empty;
-                        std::swap(queue, empty);
+                        clear_queue();
                         break;
                     }
                 } while (!queue_empty);
             }
         }
 
-        Queue empty;
-        std::swap(queue, empty);
+        clear_queue();
     }
 
     Joinable::Joinable() { }
@@ -127,9 +142,13 @@ namespace Circada {
     Suicidal::~Suicidal() { }
 
     Session::Session(Configuration& config, IrcServerSide& iss, const SessionOptions& options)
-        : config(config), iss(iss), running(false), sender(0), server_window(0),
+        : id(++next_session_id), config(config), iss(iss), running(false), sender(0), server_window(0),
           recoder(iss.get_encodings()), lag_detector(false), last_tracked_lag(0), old_time(0),
-          options(options), connection_state(ConnectionStateLogin), suiciding(false)
+          options(options), connection_state(ConnectionStateLogin), suiciding(false),
+          lines_received(iss.get_metrics().counter("circada_session_lines_received_total", "Lines received from the server.", get_metrics_labels(options))),
+          bytes_received(iss.get_metrics().counter("circada_session_bytes_received_total", "Bytes received from the server.", get_metrics_labels(options))),
+          parse_time(iss.get_metrics().histogram("circada_session_parse_seconds", "Time to parse a line from the server.", get_metrics_labels(options))),
+          dispatch_time(iss.get_metrics().histogram("circada_session_dispatch_seconds", "Time to process a parsed line from the server.", get_metrics_labels(options)))
     {
         /* checks */
         if (!options.server.length()) throw SessionException("No server specified.");
@@ -140,10 +159,19 @@ namespace Circada {
         if (!options.real_name.length()) throw SessionException("No real name specified.");
 
         /* go */
-        sender = new SenderThread(&socket);
+        sender = new SenderThread(&socket, iss.get_metrics(), get_metrics_labels(options));
+
+        highlighter.set_words(config.get_value("", "highlight_words"));
+        try {
+            highlighter.set_regex(config.get_value("", "highlight_regex"));
+        } catch (const HighlighterException& e) {
+            /* chomp, the words still work */
+        }
+        config.add_listener(this);
     }
 
     Session::~Session() {
+        config.remove_listener(this);
         iss.destroy_all_dccs_in_session(this);
         iss.destroy_all_windows_in_session(&iss, this);
         delete sender;
@@ -242,19 +270,23 @@ namespace Circada {
         }
 
 
-        /* create new chat request */
+        /* create new chat request, a passive one waits for the peer's address */
         DCC *dcc = 0;
         try {
-            dcc = iss.create_chat_in(this, nick);
+            bool passive = config.is_true(config.get_value("", "dcc_passive", "0"));
+            dcc = iss.create_chat_in(this, nick, passive);
             char buffer[32];
             std::string req;
             req = "PRIVMSG " + nick + " :\01";
             req += "DCC CHAT chat ";
-            sprintf(buffer, "%lu", static_cast<unsigned long>(ntohl(socket.get_address())));
+            sprintf(buffer, "%lu", (passive ? 0 : static_cast<unsigned long>(ntohl(get_dcc_address()))));
             req += buffer;
             req += " ";
             sprintf(buffer, "%hu", dcc->get_dccio().get_port());
             req += buffer;
+            if (passive) {
+                req += " " + dcc->get_dccio().get_token();
+            }
             req += "\01";
             send(req);
         } catch (const DCCManagerException& e) {
@@ -265,25 +297,11 @@ namespace Circada {
     }
 
     DCCXferHandle Session::dcc_file_offer(const std::string& nick, const std::string& filename) {
+        /* the offer is queued, the dcc manager sends it, when a slot is free */
         DCC *dcc = 0;
         try {
-            std::string converted_filename;
-            u32 filesize = 0;
-            char buffer[32];
-            dcc = iss.create_xfer_in(this, nick, filename, converted_filename, filesize);
-            std::string req;
-            req = "PRIVMSG " + nick + " :\01";
-            req += "DCC SEND " + converted_filename + " ";
-            sprintf(buffer, "%lu", static_cast<unsigned long>(ntohl(socket.get_address())));
-            req += buffer;
-            req += " ";
-            sprintf(buffer, "%hu", dcc->get_dccio().get_port());
-            req += buffer;
-            req += " ";
-            sprintf(buffer, "%u", filesize);
-            req += buffer;
-            req += "\01";
-            send(req);
+            bool passive = config.is_true(config.get_value("", "dcc_passive", "0"));
+            dcc = iss.create_xfer_in(this, nick, filename, passive);
         } catch (const DCCManagerException& e) {
             throw SessionException(e.what());
         }
@@ -291,6 +309,19 @@ namespace Circada {
         return DCCXferHandle(iss, dcc);
     }
 
+    unsigned long Session::get_dcc_address() {
+        /* behind a nat, the public address has to be configured */
+        std::string address = config.get_value("", "dcc_address", "");
+        if (address.length()) {
+            struct in_addr addr;
+            if (inet_pton(AF_INET, address.c_str(), &addr) == 1) {
+                return addr.s_addr;
+            }
+        }
+
+        return socket.get_address();
+    }
+
     /**************************************************************************
      * ServerNickPrefix
      **************************************************************************/
@@ -343,6 +374,7 @@ namespace Circada {
         channel_modes_d = DEFAULT_CHANNEL_MODES_D;
 
         nick = options.nick;
+        highlighter.set_nick(nick);
         away = false;
         flags.clear();
 
@@ -421,8 +453,17 @@ namespace Circada {
                 execute_injected();
                 for (LineFetcher::Lines::iterator it = lines.begin(); it != lines.end(); it++) {
                     Message m;
-                    m.parse(this, *it, &recoder);
-                    execute(m);
+                    lines_received.add(1);
+                    bytes_received.add(it->length() + 2);
+                    {
+                        MetricTimer timer(parse_time);
+                        m.parse(this, *it, &recoder);
+                    }
+                    {
+                        MetricTimer timer(dispatch_time);
+                        execute(m);
+                    }
+                    iss.line_processed(this, m);
                 }
             }
         } catch (const Exception& e) {
@@ -441,6 +482,26 @@ namespace Circada {
     /**************************************************************************
      * private functions
      **************************************************************************/
+    std::string Session::get_metrics_labels(const SessionOptions& options) {
+        return Metrics::label("session", (options.name.length() ? options.name : options.server));
+    }
+
+    void Session::configuration_changed(const std::string& category, const std::string& key, const std::string& value) {
+        if (category.length()) {
+            return;
+        }
+
+        if (key == "highlight_words") {
+            highlighter.set_words(value);
+        } else if (key == "highlight_regex") {
+            try {
+                highlighter.set_regex(value);
+            } catch (const HighlighterException& e) {
+                /* the frontend tells about it */
+            }
+        }
+    }
+
     void Session::execute_injected() {
         while (true) {
             Message m;
@@ -519,10 +580,18 @@ namespace Circada {
         return false;
     }
 
+    const std::string& Session::get_channel_prefixes() const {
+        return channel_prefixes;
+    }
+
     std::string Session::get_flags() {
         return flags.get_flags();
     }
 
+    unsigned long Session::get_id() const {
+        return id;
+    }
+
     const std::string& Session::get_nick() const {
         return nick;
     }
@@ -605,16 +674,25 @@ namespace Circada {
                 }
             }
             pc = params.size();
+            /* a passive (reverse) dcc is known by the peer's host, if numeric */
+            struct in_addr peer_addr;
+            unsigned long peer_address = (inet_pton(AF_INET, m.host.c_str(), &peer_addr) == 1 ? peer_addr.s_addr : 0);
             if (pc) {
                 dcc_request = params[0];
                 if (is_equal(dcc_request.c_str(), "CHAT") && pc > 3) {
                     const std::string& chat_request = params[1];
                     if (is_equal(chat_request, "chat")) {
-                        unsigned int addr = htonl(atoi(params[2].c_str()));
-                        unsigned long port = atol(params[3].c_str());
+                        unsigned int addr = htonl(strtoul(params[2].c_str(), 0, 10));
+                        unsigned short port = atoi(params[3].c_str());
+                        std::string token = (pc > 4 ? params[4] : "");
                         DCC *dcc = 0;
                         try {
-                            dcc = iss.create_chat_out(this, who, addr, port);
+                            /* answer to our passive offer? */
+                            if (port && iss.connect_passive(this, who, token, addr, port)) {
+                                return;
+                            }
+                            dcc = iss.create_chat_out(this, who, addr, port, token);
+                            dcc->get_dccio().set_peer_address(peer_address);
                             iss.dcc_incoming_chat_request(this, server_window, DCCChatHandle(iss, dcc));
                         } catch (const DCCException& e) {
                             iss.dcc_chat_failed(server_window, DCCChatHandle(iss, dcc), e.what());
@@ -624,14 +702,21 @@ namespace Circada {
                     }
                     window_action_and_notify(server_window, WindowActionAlert);
                     return;
-                } else if (is_equal(dcc_request.c_str(), "SEND") && pc > 3) {
+                } else if ((is_equal(dcc_request.c_str(), "SEND") || is_equal(dcc_request.c_str(), "TSEND")) && pc > 3) {
+                    bool turbo = is_equal(dcc_request.c_str(), "TSEND");
                     const std::string& filename = params[1];
-                    unsigned long addr = htonl(atol(params[2].c_str()));
+                    unsigned long addr = htonl(strtoul(params[2].c_str(), 0, 10));
                     unsigned short port = atoi(params[3].c_str());
-                    unsigned long fsz = (pc > 4 ? atol(params[4].c_str()) : 0);
+                    u64 fsz = (pc > 4 ? strtoull(params[4].c_str(), 0, 10) : 0);
+                    std::string token = (pc > 5 ? params[5] : "");
                     DCC *dcc = 0;
                     try {
-                        dcc = iss.create_xfer_out(this, who, filename, fsz, addr, port);
+                        /* answer to our passive offer? */
+                        if (port && iss.connect_passive(this, who, token, addr, port)) {
+                            return;
+                        }
+                        dcc = iss.create_xfer_out(this, who, filename, fsz, addr, port, token, turbo);
+                        dcc->get_dccio().set_peer_address(peer_address);
                         iss.dcc_incoming_xfer_request(this, server_window, DCCXferHandle(iss, dcc));
                     } catch (const DCCException& e) {
                         iss.dcc_xfer_failed(server_window, DCCXferHandle(iss, dcc), e.what());
@@ -641,15 +726,19 @@ namespace Circada {
                 } else if (is_equal(dcc_request.c_str(), "RESUME") && pc > 3) {
                     const std::string& filename = params[1];
                     unsigned short port = atoi(params[2].c_str());
-                    u32 startpos = atoi(params[3].c_str());
+                    u64 startpos = strtoull(params[3].c_str(), 0, 10);
+                    std::string token = (pc > 4 ? params[4] : "");
                     DCC *dcc = 0;
                     try {
-                        if (iss.set_resume_position(this, port, startpos, dcc)) {
+                        if (iss.set_resume_position(this, port, token, startpos, dcc)) {
                             char startpos_str[32];
-                            sprintf(startpos_str, "%du", startpos);
+                            sprintf(startpos_str, "%llu", static_cast<unsigned long long>(startpos));
                             std::string reply("PRIVMSG " + m.nick + " :\x01");
                             reply += "DCC ACCEPT " + filename + " " + params[2] + " ";
                             reply += startpos_str;
+                            if (token.length()) {
+                                reply += " " + token;
+                            }
                             reply += "\x01";
                             sender->pump(reply);
                         }
@@ -659,13 +748,14 @@ namespace Circada {
                     return;
                 } else if (is_equal(dcc_request.c_str(), "ACCEPT") && pc > 3) {
                     unsigned short port = atoi(params[2].c_str());
-                    u32 startpos = atoi(params[3].c_str());
+                    u64 startpos = strtoull(params[3].c_str(), 0, 10);
+                    std::string token = (pc > 4 ? params[4] : "");
                     DCC *dcc = 0;
                     try {
-                        if (iss.set_resume_position(this, port, startpos, dcc)) {
-                            dcc->start();
+                        if (iss.set_resume_position(this, port, token, startpos, dcc)) {
+                            iss.begin_dcc(dcc);
                         }
-                    } catch (const DCCManagerException& e) {
+                    } catch (const Exception& e) {
                         iss.dcc_mgr_failed(dcc, e.what());
                     }
                     return;
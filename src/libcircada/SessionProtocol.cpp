@@ -146,6 +146,7 @@ namespace Circada {
         if (m.nick == nick || connection_state != ConnectionStateLoggedIn) {
             std::string old_nick = nick;
             nick = new_nick;
+            highlighter.set_nick(nick);
             iss.dcc_change_my_nick(this, nick);
             iss.change_my_nick(this, old_nick, new_nick);
         } else {
@@ -276,7 +277,7 @@ namespace Circada {
             }
             add_nick_prefix(w, m);
 
-            if (Nick::is_nick_in_text(nick, text)) {
+            if (highlighter.is_highlighted(text)) {
                 Message& unsecured_m = const_cast<Message&>(m);
                 unsecured_m.to_me = true;
                 if (w->set_action(WindowActionAlert)) {
@@ -511,6 +512,7 @@ namespace Circada {
         lag_detector = true;
         connection_state = ConnectionStateLoggedIn;
         send_notification_with_noise(server_window, m);
+        iss.restore_queue(this);
     }
 
     void Session::rpl_protocol(const Message& m) {
@@ -25,17 +25,24 @@
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <netinet/in.h>
+#include <netinet/ip.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 namespace Circada {
 
     const int Socket::DefaultBacklog = 5;
+    const size_t Socket::FileBufferLength = 65536;
 
-    Socket::Socket() : socket(0), connected(false), listening(false), error(false), tls(false) { }
+    Socket::Socket()
+        : socket(0), connected(false), listening(false), error(false), tls(false),
+          disconnecting(false), connecting(false), nonblocking(false) { }
 
     Socket::~Socket() {
         if (connected) {
@@ -167,6 +174,65 @@ namespace Circada {
         }
     }
 
+    bool Socket::connect_nonblocking(const char *ip_address, unsigned short port) {
+        struct sockaddr_in server;
+        unsigned long address;
+        int rv;
+
+        /* check states */
+        check_states();
+        if (tls) {
+            throw SocketException("Non blocking connects are not supported with TLS.");
+        }
+        if ((address = inet_addr(ip_address)) == INADDR_NONE) {
+            throw SocketException("Invalid address: " + std::string(ip_address));
+        }
+
+        /* create socket */
+        if ((socket = ::socket(PF_INET, SOCK_STREAM, 0)) < 0) {
+            throw SocketException("Failed to create socket.");
+        }
+        set_nonblocking(true);
+
+        /* open connection, finish_connect() has to be called, */
+        /* as soon as the socket is writable.                  */
+        memset(&server, 0, sizeof(server));
+        memcpy(&server.sin_addr, &address, sizeof(address));
+        server.sin_family = AF_INET;
+        server.sin_port = htons(port);
+        disconnecting = false;
+        connecting = true;
+        rv = ::connect(socket, reinterpret_cast<struct sockaddr *>(&server), sizeof(server));
+        if (rv < 0 && errno != EINPROGRESS) {
+            std::string err("Cannot connect to server: ");
+            err.append(strerror(errno));
+            connecting = false;
+            ::close(socket);
+            throw SocketException(err);
+        }
+        if (!rv) {
+            connecting = false;
+            connected = true;
+        }
+
+        return connected;
+    }
+
+    void Socket::finish_connect() {
+        if (connecting) {
+            int valopt = 0;
+            socklen_t lon = sizeof(valopt);
+            getsockopt(socket, SOL_SOCKET, SO_ERROR, &valopt, &lon);
+            if (valopt) {
+                std::string err("Cannot connect to server: ");
+                err.append(strerror(valopt));
+                throw SocketException(err);
+            }
+            connecting = false;
+            connected = true;
+        }
+    }
+
     bool Socket::activity(time_t sec, suseconds_t usec) {
         fd_set fds;
         FD_ZERO(&fds);
@@ -269,7 +335,7 @@ namespace Circada {
         }
 
         /* accept socket */
-        client_len = sizeof(client_len);
+        client_len = sizeof(client);
         this->socket = ::accept(socket.socket, reinterpret_cast<struct sockaddr *>(&client), &client_len);
         if (this->socket < 0) {
             throw SocketException("Accept failed: " + std::string(strerror(errno)));
@@ -277,6 +343,13 @@ namespace Circada {
         connected = true;
     }
 
+    void Socket::attach(int fd) {
+        /* take over an accepted connection */
+        check_states();
+        socket = fd;
+        connected = true;
+    }
+
     void Socket::close() {
         disconnecting = true;
         if (connected) {
@@ -296,6 +369,9 @@ namespace Circada {
             ::shutdown(socket, SHUT_RDWR);
             ::close(socket);
             connected = listening = false;
+        } else if (connecting) {
+            ::close(socket);
+            connecting = false;
         }
     }
 
@@ -308,6 +384,12 @@ namespace Circada {
         if (tls) {
             try {
                 rv = session.send(buffer, size);
+            } catch (gnutls::exception& e) {
+                if (nonblocking && (e.get_code() == GNUTLS_E_AGAIN || e.get_code() == GNUTLS_E_INTERRUPTED)) {
+                    /* the record stays queued, the next send flushes it first */
+                    return 0;
+                }
+                throw SocketException(e.what());
             } catch (const std::exception& e) {
                 throw SocketException(e.what());
             }
@@ -315,6 +397,9 @@ namespace Circada {
             rv = ::send(socket, buffer, size, 0);
         }
         if (rv < 0) {
+            if (nonblocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return 0;
+            }
             throw SocketException("Send failed: " + std::string(strerror(errno)));
         }
 
@@ -325,6 +410,42 @@ namespace Circada {
         return send(buffer.c_str(), buffer.length());
     }
 
+    size_t Socket::send_file(int fd, off_t& offset, size_t count) {
+        if (error || !connected) {
+            throw SocketException("Send failed, socket is closed.");
+        }
+
+#ifdef __linux__
+        /* plain sockets: let the kernel copy from page cache to socket */
+        if (!tls) {
+            ssize_t rv = ::sendfile(socket, fd, &offset, count);
+            if (rv < 0) {
+                if (errno == EINTR || errno == EAGAIN) {
+                    return 0;
+                }
+                throw SocketException("Send failed: " + std::string(strerror(errno)));
+            }
+            return static_cast<size_t>(rv);
+        }
+#endif
+
+        /* tls or no sendfile(): read and send through a large buffer */
+        std::vector<char> buffer(count < FileBufferLength ? count : FileBufferLength);
+        ssize_t rd = pread(fd, &buffer[0], buffer.size(), offset);
+        if (rd < 0) {
+            throw SocketException("Read failed: " + std::string(strerror(errno)));
+        }
+        size_t sent = 0;
+        if (rd) {
+            /* a full non-blocking socket takes less, the caller retries
+             * from the new offset on the next POLLOUT */
+            sent = send(&buffer[0], static_cast<size_t>(rd));
+        }
+        offset += static_cast<off_t>(sent);
+
+        return sent;
+    }
+
     size_t Socket::receive(void *buffer, size_t size) {
         if (error || !connected) {
             throw SocketException("Receive failed, socket is closed.");
@@ -334,6 +455,11 @@ namespace Circada {
         if (tls) {
             try {
                 rv = session.recv(buffer, size);
+            } catch (gnutls::exception& e) {
+                if (nonblocking && (e.get_code() == GNUTLS_E_AGAIN || e.get_code() == GNUTLS_E_INTERRUPTED)) {
+                    return 0;
+                }
+                throw SocketException(e.what());
             } catch (const std::exception& e) {
                 throw SocketException(e.what());
             }
@@ -341,8 +467,16 @@ namespace Circada {
             rv = recv(socket, buffer, size, 0);
         }
         if (rv < 0) {
+            if (nonblocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return 0;
+            }
             throw SocketException("Receive failed: " + std::string(strerror(errno)));
         }
+        if (!rv && size && nonblocking) {
+            /* without a preceding activity() check, eof is only seen here */
+            error = true;
+            throw SocketException("Socket has closed.");
+        }
 
         return static_cast<size_t>(rv);
     }
@@ -355,6 +489,39 @@ namespace Circada {
         return connected;
     }
 
+    bool Socket::is_tls() const {
+        return tls;
+    }
+
+    void Socket::set_bulk(bool state) {
+        /* bulk data queues behind interactive traffic, eg. irc sessions */
+        int tos = (state ? IPTOS_THROUGHPUT : 0);
+        setsockopt(socket, IPPROTO_IP, IP_TOS, &tos, sizeof tos);
+    }
+
+    void Socket::set_nonblocking(bool state) {
+        int flags = fcntl(socket, F_GETFL, 0);
+        if (state) {
+            flags |= O_NONBLOCK;
+        } else {
+            flags &= (~O_NONBLOCK);
+        }
+        fcntl(socket, F_SETFL, flags);
+        nonblocking = state;
+    }
+
+    int Socket::get_fd() const {
+        return socket;
+    }
+
+    void Socket::set_buffer_sizes(int size) {
+        /* the kernel may clamp these to net.core.[rw]mem_max */
+        if (size > 0) {
+            setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof size);
+            setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof size);
+        }
+    }
+
     unsigned short Socket::get_port() {
         struct sockaddr_in sin;
         socklen_t len = sizeof(sin);
@@ -0,0 +1,159 @@
+/*
+ *  TimerWheel.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/TimerWheel.hpp"
+
+namespace Circada {
+
+    TimerWheel::TimerWheel(long resolution, size_t slot_count)
+        : resolution(resolution), slots(slot_count), last_id(0), current(0),
+          origin(0), started(false) { }
+
+    TimerWheel::~TimerWheel() { }
+
+    TimerWheel::Id TimerWheel::add(long now, long delay) {
+        Id id = ++last_id;
+        insert(id, now, delay);
+
+        return id;
+    }
+
+    void TimerWheel::rearm(Id id, long now, long delay) {
+        cancel(id);
+        insert(id, now, delay);
+    }
+
+    bool TimerWheel::cancel(Id id) {
+        Index::iterator it = index.find(id);
+        if (it == index.end()) {
+            return false;
+        }
+
+        Slot& slot = slots[it->second];
+        for (Slot::iterator sit = slot.begin(); sit != slot.end(); sit++) {
+            if (sit->id == id) {
+                slot.erase(sit);
+                break;
+            }
+        }
+        index.erase(it);
+
+        return true;
+    }
+
+    void TimerWheel::clear() {
+        for (Slots::iterator it = slots.begin(); it != slots.end(); it++) {
+            it->clear();
+        }
+        index.clear();
+    }
+
+    size_t TimerWheel::get_count() const {
+        return index.size();
+    }
+
+    long TimerWheel::get_timeout(long now) const {
+        if (index.empty()) {
+            return -1;
+        }
+
+        /* the nearest slot with an entry in its last round, */
+        /* otherwise wake up after one turn.                 */
+        size_t n = slots.size();
+        u64 tick = current + n;
+        for (size_t i = 1; i <= n && tick == current + n; i++) {
+            const Slot& slot = slots[(current + i) % n];
+            for (Slot::const_iterator it = slot.begin(); it != slot.end(); it++) {
+                if (!it->rounds) {
+                    tick = current + i;
+                    break;
+                }
+            }
+        }
+
+        long timeout = origin + static_cast<long>(tick) * resolution - now;
+
+        return (timeout < 0 ? 0 : timeout);
+    }
+
+    void TimerWheel::advance(long now, Ids& expired) {
+        if (!started) {
+            return;
+        }
+
+        u64 due = get_tick(now);
+        if (index.empty()) {
+            if (due > current) {
+                current = due;
+            }
+            return;
+        }
+
+        size_t n = slots.size();
+        while (current < due) {
+            current++;
+            Slot& slot = slots[current % n];
+            Slot::iterator it = slot.begin();
+            while (it != slot.end()) {
+                if (it->rounds) {
+                    it->rounds--;
+                    it++;
+                } else {
+                    expired.push_back(it->id);
+                    index.erase(it->id);
+                    it = slot.erase(it);
+                }
+            }
+            if (index.empty()) {
+                current = due;
+            }
+        }
+    }
+
+    void TimerWheel::insert(Id id, long now, long delay) {
+        if (!started) {
+            origin = now;
+            started = true;
+        }
+
+        /* the expiry tick is absolute, so a lagging wheel fires on time */
+        if (delay < 0) {
+            delay = 0;
+        }
+        u64 target = get_tick(now + delay + resolution - 1);
+        if (target <= current) {
+            target = current + 1;
+        }
+        u64 ticks = target - current;
+        size_t n = slots.size();
+        size_t slot = target % n;
+        slots[slot].push_back(Entry(id, (ticks - 1) / n));
+        index[id] = slot;
+    }
+
+    u64 TimerWheel::get_tick(long now) const {
+        if (now <= origin) {
+            return 0;
+        }
+
+        return static_cast<u64>((now - origin) / resolution);
+    }
+
+} /* namespace Circada */
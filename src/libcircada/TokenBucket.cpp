@@ -0,0 +1,95 @@
+/*
+ *  TokenBucket.cpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Circada/TokenBucket.hpp"
+
+namespace Circada {
+
+    TokenBucket::TokenBucket() : rate(0), burst(0), tokens(0), last(-1) { }
+
+    TokenBucket::~TokenBucket() { }
+
+    void TokenBucket::set_rate(u64 rate) {
+        if (rate != this->rate) {
+            this->rate = rate;
+            burst = rate / 4;
+            if (burst < MinimumBurst) {
+                burst = MinimumBurst;
+            }
+            if (tokens > burst) {
+                tokens = static_cast<double>(burst);
+            }
+        }
+    }
+
+    u64 TokenBucket::get_rate() const {
+        return rate;
+    }
+
+    u64 TokenBucket::get_burst() const {
+        return burst;
+    }
+
+    bool TokenBucket::is_limited() const {
+        return (rate != 0);
+    }
+
+    u64 TokenBucket::get_available(long now) {
+        if (!rate) {
+            return static_cast<u64>(-1);
+        }
+        refill(now);
+
+        return (tokens > 0 ? static_cast<u64>(tokens) : 0);
+    }
+
+    void TokenBucket::consume(u64 bytes) {
+        if (rate) {
+            tokens -= static_cast<double>(bytes);
+        }
+    }
+
+    long TokenBucket::get_ready_time(long now, u64 bytes) {
+        if (!rate) {
+            return now;
+        }
+        refill(now);
+        if (tokens >= bytes) {
+            return now;
+        }
+
+        /* round up, at least one ms */
+        double missing = static_cast<double>(bytes) - tokens;
+        return now + static_cast<long>(missing * 1000.0 / rate) + 1;
+    }
+
+    void TokenBucket::refill(long now) {
+        if (last < 0) {
+            tokens = static_cast<double>(burst);
+        } else if (now > last) {
+            tokens += static_cast<double>(now - last) * rate / 1000.0;
+            if (tokens > burst) {
+                tokens = static_cast<double>(burst);
+            }
+        }
+        last = now;
+    }
+
+} /* namespace Circada */
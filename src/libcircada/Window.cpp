@@ -23,19 +23,31 @@
 #include "Circada/Utils.hpp"
 
 #include <algorithm>
+#include <atomic>
 
 namespace Circada {
 
+    static std::atomic<unsigned long> next_window_id(0);
+
+    /**************************************************************************
+     * Window
+     **************************************************************************/
+    Window::Window() : id(++next_window_id) { }
+
+    unsigned long Window::get_id() const {
+        return id;
+    }
+
     /**************************************************************************
      * SessionWindow
      **************************************************************************/
     SessionWindow::SessionWindow(const std::string& name, const std::string& topic)
         : session(0), type(WindowTypeApplication), name(name), topic(topic), snp(0),
-          dcc(0) { }
+          dcc(0), nick_gauge(0) { }
 
     SessionWindow::SessionWindow(Session *s, WindowType type, const std::string& name, ServerNickPrefix *snp)
         : session(s), type(type), name(name), dcc_name(name), topic(), snp(snp),
-          dcc(0), dcc_type(DCCTypeNone)
+          dcc(0), dcc_type(DCCTypeNone), nick_gauge(0)
     {
         action = (type == WindowTypePrivate ? WindowActionAlert : WindowActionNoise);
     }
@@ -43,11 +55,17 @@ namespace Circada {
     SessionWindow::SessionWindow(Session *s, const DCC *dcc, const std::string& name, ServerNickPrefix *snp)
         : session(s), type(WindowTypeDCC),
           name(name), dcc_name((dcc->get_type() == DCCTypeChat ? "=" : "*") + name),
-          topic(), snp(snp), dcc(dcc), dcc_type(dcc->get_type())
+          topic(), snp(snp), dcc(dcc), dcc_type(dcc->get_type()), nick_gauge(0)
     {
         action = WindowActionAlert;
     }
 
+    SessionWindow::~SessionWindow() {
+        if (nick_gauge) {
+            nick_gauge->add(-static_cast<s64>(nicks.size()));
+        }
+    }
+
     Session *SessionWindow::get_session() {
         return session;
     }
@@ -98,6 +116,9 @@ namespace Circada {
         Nick n(nick, snp);
         remove_nick(n.get_nick());
         nicks.push_back(n);
+        if (nick_gauge) {
+            nick_gauge->add(1);
+        }
         if (!no_sort) sort_nicks();
     }
 
@@ -119,6 +140,9 @@ namespace Circada {
         for (size_t i = 0; i < sz; i ++) {
             if (is_equal(nicks[i].get_nick(), nick)) {
                 nicks.erase(nicks.begin() + i);
+                if (nick_gauge) {
+                    nick_gauge->add(-1);
+                }
                 break;
             }
         }
@@ -128,6 +152,13 @@ namespace Circada {
         std::sort(nicks.begin(), nicks.end());
     }
 
+    void SessionWindow::set_nick_gauge(MetricGauge *gauge) {
+        nick_gauge = gauge;
+        if (nick_gauge) {
+            nick_gauge->add(nicks.size());
+        }
+    }
+
     bool SessionWindow::print_netsplit(const std::string& quit_msg, struct timeval now) {
         Netsplit& ns = get_netsplit(quit_msg);
         if (now.tv_sec - ns.last_netsplit.tv_sec < 5) {
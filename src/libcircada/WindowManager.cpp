@@ -23,7 +23,9 @@
 
 namespace Circada {
 
-    WindowManager::WindowManager() { }
+    WindowManager::WindowManager(Metrics& metrics)
+        : windows_gauge(metrics.gauge("circada_windows", "Open windows.")),
+          nicks_gauge(metrics.gauge("circada_nicks", "Nicks in the nick lists of all windows.")) { }
 
     WindowManager::~WindowManager() {
         destroy_all_windows();
@@ -110,7 +112,7 @@ namespace Circada {
         if (!w) {
             ScopeMutex lock(&mtx);
             w = new SessionWindow(name, topic);
-            windows.push_back(w);
+            add_window_nolock(w);
             evt->open_window(0, w);
             evt->window_action(0, w);
         }
@@ -127,7 +129,7 @@ namespace Circada {
                 ScopeMutex lock(&mtx);
 
                 w = new SessionWindow(s, type, name, snp);
-                windows.push_back(w);
+                add_window_nolock(w);
                 evt->open_window(s, w);
                 evt->window_action(s, w);
                 if (type == WindowTypePrivate) {
@@ -147,7 +149,7 @@ namespace Circada {
         if (!w) {
             ScopeMutex lock(&mtx);
             w = new SessionWindow(0, dcc, his_nick, 0);
-            windows.push_back(w);
+            add_window_nolock(w);
             evt->open_window(0, w);
             evt->window_action(0, w);
             w->add_nick(my_nick, false);
@@ -185,6 +187,7 @@ namespace Circada {
                         evt->close_window(w->get_session(), w);
                     }
                     windows.erase(it);
+                    windows_gauge.add(-1);
                     delete w;
                     break;
                 }
@@ -217,4 +220,10 @@ namespace Circada {
         }
     }
 
+    void WindowManager::add_window_nolock(SessionWindow *w) {
+        w->set_nick_gauge(&nicks_gauge);
+        windows.push_back(w);
+        windows_gauge.add(1);
+    }
+
 } /* namespace Circada */
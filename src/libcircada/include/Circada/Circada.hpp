@@ -23,12 +23,16 @@
 
 #include "Circada/CircadaException.hpp"
 #include "Circada/Configuration.hpp"
+#include "Circada/FileWatcher.hpp"
 #include "Circada/IrcServerSide.hpp"
 #include "Circada/IrcClientSide.hpp"
 #include "Circada/Utils.hpp"
 #include "Circada/Internals.hpp"
 #include "Circada/Environment.hpp"
 #include "Circada/Parser.hpp"
+#include "Circada/LogStore.hpp"
+#include "Circada/Metrics.hpp"
+#include "Circada/MetricsExporter.hpp"
 
 #include <vector>
 #include <string>
@@ -53,6 +57,14 @@ namespace Circada {
         size_t get_session_count();
         Session *find_session(const Session *s);
         Session *find_session(const std::string& name);
+        bool is_session_listed(unsigned long id);
+
+        /* queues data on a listed session, false if it is gone. */
+        /* it never waits for the network.                        */
+        bool send_to_session(unsigned long id, const std::string& data);
+
+        /* why the metrics are not exported, empty if they are */
+        std::string get_metrics_error();
 
         /* managing all dcc requests  */
         DCCHandle::List get_dcc_list();
@@ -61,6 +73,12 @@ namespace Circada {
         void dcc_decline(DCCHandle dcc);
         void dcc_abort(DCCHandle dcc);
         void dcc_send_msg(DCCHandle dcc, const std::string& msg);
+        void dcc_set_limit(DCCLimitScope scope, u64 rate);
+        u64 dcc_get_limit(DCCLimitScope scope);
+        void dcc_set_transfer_limit(DCCHandle dcc, u64 rate);
+        void dcc_set_priority(DCCHandle dcc, DCCPriority priority);
+        void dcc_set_slots(DCCLimitScope scope, unsigned int slots);
+        unsigned int dcc_get_slots(DCCLimitScope scope);
         DCCHandle get_dcc_handle_from_window(Window *w);
         Window *get_window_from_dcc_handle(DCCHandle dcc);
         DCCChatHandle get_chat_handle(DCCHandle dcc);
@@ -82,6 +100,7 @@ namespace Circada {
     private:
         Configuration& config;
         Session::List sessions;
+        MetricsExporter metrics_exporter;
 
         void destroy_session_nolock(Session *s);
     };
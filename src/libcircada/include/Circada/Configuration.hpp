@@ -22,10 +22,14 @@
 #define _CIRCADA_CONFIGURATION_HPP_
 
 #include "Circada/Exception.hpp"
+#include "Circada/Types.hpp"
 #include "Circada/Mutex.hpp"
 
 #include <string>
 #include <map>
+#include <vector>
+#include <atomic>
+#include <cstdlib>
 
 namespace Circada {
 
@@ -35,7 +39,84 @@ namespace Circada {
         ConfigurationException(std::string msg) : Exception(msg) { }
     };
 
+    class Configuration;
+
+    /* informed after a value has changed. listeners are called outside */
+    /* of the configuration lock, but must not set values themselves.   */
+    class ConfigurationListener {
+    public:
+        virtual ~ConfigurationListener() { }
+
+        virtual void configuration_changed(const std::string& category, const std::string& key, const std::string& value) = 0;
+    };
+
+    /* a handle is bound to one key. the configuration updates it when */
+    /* the key is set, so reading the parsed value needs no lock.      */
+    class ConfigurationHandle {
+    private:
+        ConfigurationHandle(const ConfigurationHandle& rhs);
+        ConfigurationHandle& operator=(const ConfigurationHandle& rhs);
+
+    public:
+        ConfigurationHandle(Configuration& config, const std::string& category, const std::string& key, const std::string& defaults);
+        virtual ~ConfigurationHandle();
+
+        const std::string& get_name() const;
+        const std::string& get_defaults() const;
+        virtual void update(const std::string& value) = 0;
+
+    protected:
+        void attach();
+        void detach();
+
+    private:
+        Configuration& config;
+        std::string name;
+        std::string defaults;
+        bool attached;
+    };
+
+    template<typename T> class ConfigurationValue : public ConfigurationHandle {
+    public:
+        ConfigurationValue(Configuration& config, const std::string& category, const std::string& key, const std::string& defaults)
+            : ConfigurationHandle(config, category, key, defaults), value(T())
+        {
+            attach();
+        }
+
+        virtual ~ConfigurationValue() {
+            detach();
+        }
+
+        T get() const {
+            return value.load(std::memory_order_relaxed);
+        }
+
+        virtual void update(const std::string& str) {
+            value.store(parse(str), std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<T> value;
+
+        static T parse(const std::string& str);
+    };
+
+    template<> inline int ConfigurationValue<int>::parse(const std::string& str) {
+        return atoi(str.c_str());
+    }
+
+    template<> inline u64 ConfigurationValue<u64>::parse(const std::string& str) {
+        return strtoull(str.c_str(), 0, 10);
+    }
+
+    template<> inline bool ConfigurationValue<bool>::parse(const std::string& str) {
+        return (atoi(str.c_str()) != 0);
+    }
+
     class Configuration {
+        friend class ConfigurationHandle;
+
     public:
         typedef std::map<std::string, std::string> Entries;
 
@@ -43,26 +124,42 @@ namespace Circada {
         virtual ~Configuration();
 
         const std::string& get_working_directory();
+        std::string get_filename() const;
         void load();
+        size_t reload();
         void save();
         void set_value(const std::string& category, const std::string& key, const std::string& value);
         const std::string& get_value(const std::string& category, const std::string& key) const;
         const std::string& get_value(const std::string& category, const std::string& key, const std::string& defaults) const;
         bool is_true(const std::string& value);
         const Entries get_entries() const;
+        void add_listener(ConfigurationListener *listener);
+        void remove_listener(ConfigurationListener *listener);
 
     private:
+        typedef std::multimap<std::string, ConfigurationHandle *> Handles;
+        typedef std::vector<ConfigurationListener *> Listeners;
+
         static const char *ConfigurationFile;
 
         bool modified;
         std::string working_directory;
         std::string empty_string;
         Entries entries;
+        Entries file_entries;
         mutable Mutex mtx;
+        Handles handles;
+        Mutex listener_mtx;
+        Listeners listeners;
 
         void load_defaults();
+        void read_file(Entries& read_entries);
         void validation(const std::string& s);
         void set_value_nolock(const std::string& category, const std::string& key, const std::string& value);
+        void update_handles_nolock(const std::string& name);
+        void notify_listeners(const std::string& category, const std::string& key, const std::string& value);
+        void attach_handle(ConfigurationHandle *handle);
+        void detach_handle(ConfigurationHandle *handle);
     };
 
 } /* namespace Circada */
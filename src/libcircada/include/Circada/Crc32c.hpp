@@ -0,0 +1,47 @@
+/*
+ *  Crc32c.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_CRC32C_HPP_
+#define _CIRCADA_CRC32C_HPP_
+
+#include "Circada/Types.hpp"
+
+#include <cstddef>
+
+namespace Circada {
+
+    /* rolling crc32c (castagnoli), fed with the data while it streams. */
+    /* uses the sse4.2 crc32 instruction, if the cpu has it.            */
+    class Crc32c {
+    public:
+        Crc32c();
+        virtual ~Crc32c();
+
+        void reset(u32 value = 0);
+        void update(const void *data, size_t length);
+        u32 get_value() const;
+
+    private:
+        u32 crc;
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_CRC32C_HPP_ */
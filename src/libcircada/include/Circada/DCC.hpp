@@ -24,7 +24,9 @@
 #include "Circada/Exception.hpp"
 #include "Circada/Types.hpp"
 #include "Circada/Socket.hpp"
-#include "Circada/Thread.hpp"
+#include "Circada/Mutex.hpp"
+#include "Circada/TokenBucket.hpp"
+#include "Circada/Crc32c.hpp"
 #include "Circada/LineFetcher.hpp"
 
 #include <vector>
@@ -72,15 +74,32 @@ namespace Circada {
 
     enum XferState {
         XferStateStart,
+        XferStateVerify,
         XferStateTransfer
     };
 
+    enum DCCPriority {
+        DCCPriorityNormal,
+        DCCPriorityBulk
+    };
+
+    enum DCCLimitScope {
+        DCCLimitGlobal,
+        DCCLimitNick,
+        DCCLimitTransfer
+    };
+
     class DCCManager;
+    class DCCListenerPool;
     class Session;
 
+    /* the direction tells, who offered the dcc. independent of that,  */
+    /* the connection is either accepted through the listener pool or  */
+    /* connected to the peer. a passive (reverse) dcc waits until the  */
+    /* peer tells where to connect or until we listen on its behalf.   */
     class DCCIO {
     public:
-        DCCIO(DCCDirection direction, unsigned long address, unsigned short port);
+        DCCIO(DCCListenerPool& listeners, DCCDirection direction, unsigned long address, unsigned short port);
         virtual ~DCCIO();
 
         unsigned long get_address() const;
@@ -88,25 +107,49 @@ namespace Circada {
         Socket& get_socket();
         DCCDirection get_direction() const;
         void set_timeout(int s);
-
-        virtual void connect() = 0;
-        void stop();
+        int get_timeout() const;
+        const std::string& get_token() const;
+        void set_token(const std::string& token);
+        unsigned long get_peer_address() const;
+        void set_peer_address(unsigned long peer_address);
+        bool is_waiting() const;
+        void listen();
+        void connect_to(unsigned long address, unsigned short port);
+        void attach(int fd);
+
+        /* non blocking connection setup, driven by the poller */
+        void connect_start();
+        bool connect_continue();
+        int get_connect_fd() const;
+        short get_connect_events() const;
 
     protected:
         Socket socket;
-        bool iorunning;
         int timeout;
 
         void set_port(unsigned short port);
         void set_address(unsigned long address);
 
     private:
+        enum ConnectMode {
+            ConnectModeWait,
+            ConnectModeListen,
+            ConnectModeConnect
+        };
+
+        DCCListenerPool& listeners;
+        mutable Mutex mtx;
         DCCDirection direction;
         unsigned int address;
         unsigned short port;
+        std::string token;
+        unsigned long peer_address;
+        ConnectMode mode;
+        bool attached;
+        bool connecting;
     };
 
-    class DCC : public Thread {
+    class DCC {
     public:
         typedef std::vector<DCC *> List;
 
@@ -129,10 +172,24 @@ namespace Circada {
         void set_will_be_killed();
         bool get_will_be_killed() const;
 
+        /* called on the poller thread only */
+        short get_poll_events();
+        int get_poll_fd();
+        long get_deadline() const;
+        void handle_start();
+        void handle_events(short revents);
+        void handle_timer(long now);
+
     protected:
         DCCManager& mgr;
 
     private:
+        enum DispatchType {
+            DispatchStart,
+            DispatchEvents,
+            DispatchTimer
+        };
+
         Session *s;
         DCCIO& io;
         DCCType type;
@@ -141,32 +198,30 @@ namespace Circada {
         bool running;
         bool connected;
         bool will_be_killed;
+        long deadline;
 
-        virtual void process_or_idle() { }
+        void dispatch(DispatchType type, short revents, long now);
+        virtual short get_transfer_events() { return 0; }
+        virtual long get_transfer_deadline() const { return -1; }
+        virtual void process_events(short revents) { }
+        virtual void process_timer(long now) { }
         virtual void begin_handler() { }
         virtual void end_handler() { }
-        virtual void thread();
     };
 
+    /* we offer, the peer connects, or we connect in passive mode. */
+    /* the manager listens, when the offer is sent.                */
     class DCCIn : public DCCIO {
     public:
-        DCCIn();
+        DCCIn(DCCListenerPool& listeners);
         virtual ~DCCIn();
-
-    protected:
-        virtual void connect();
-
-    private:
-        bool listening;
     };
 
+    /* the peer offers, we connect, or we listen if the port is 0 */
     class DCCOut : public DCCIO {
     public:
-        DCCOut(unsigned long address, unsigned short port);
+        DCCOut(DCCListenerPool& listeners, unsigned long address, unsigned short port);
         virtual ~DCCOut();
-
-    protected:
-        virtual void connect();
     };
 
     class DCCChat : public DCC {
@@ -178,36 +233,66 @@ namespace Circada {
 
     private:
         LineFetcher fetcher;
+        Mutex out_mtx;
+        std::string out_buffer;
 
-        virtual void process_or_idle();
+        virtual short get_transfer_events();
+        virtual void process_events(short revents);
         virtual void begin_handler();
     };
 
     class DCCXfer : public DCC {
     public:
-        DCCXfer(Session *s, DCCManager& mgr, DCCIO& io, const std::string& nick, const std::string& filename, u32 filesize);
+        DCCXfer(Session *s, DCCManager& mgr, DCCIO& io, const std::string& nick, const std::string& filename, u64 filesize);
         virtual ~DCCXfer();
 
         const std::string& get_filename() const;
-        void set_resume_position(u32 startpos);
-        u32 get_total_acknownledged() const;
-        u32 get_filesize() const;
+        void set_resume_position(u64 startpos);
+        u64 get_total_acknownledged() const;
+        u64 get_filesize() const;
+        u32 get_checksum() const;
+        TokenBucket& get_bucket();
+        void set_own_limit(bool state);
+        bool has_own_limit() const;
+        void set_priority(DCCPriority priority);
+        DCCPriority get_priority() const;
+        void set_queued(bool state);
+        bool is_queued() const;
+        void set_admitted(bool state);
+        bool is_admitted() const;
+        void set_turbo(bool state);
+        bool is_turbo() const;
 
     protected:
-        static const int BufferLength = 512; //65536;
         std::string filename;
-        u32 filesize;
-        u32 startpos;
+        u64 filesize;
+        u64 startpos;
         XferState state;
-        FILE *f;
+        int fd;
         bool successful;
+        bool turbo;             /* negotiated with TSEND, the receiver does not acknowledge */
 
-        char buffer[BufferLength];
         time_t last_time;
-        u32 total_acknowledged;
-
+        u64 total_acknowledged;
+        Crc32c checksum;
+
+        TokenBucket bucket;
+        bool own_limit;         /* set per transfer, dcc_limit_transfer does not apply */
+        DCCPriority priority;
+        bool priority_changed;
+        long throttled_until;
+
+        bool queued;
+        bool admitted;
+
+        bool is_throttled() const;
+        u64 get_bandwidth(u64 want);
+        void consume_bandwidth(u64 bytes);
+        void update_traffic_class();
         virtual void begin_handler();
         virtual void end_handler();
+        virtual long get_transfer_deadline() const;
+        virtual void process_timer(long now);
     };
 
     class DCCChatIn : public DCCChat, public DCCIn {
@@ -224,28 +309,58 @@ namespace Circada {
 
     class DCCXferIn : public DCCXfer, public DCCIn {
     public:
-        DCCXferIn(Session *s, DCCManager& mgr, const std::string& nick, const std::string& filename, u32 filesize);
+        DCCXferIn(Session *s, DCCManager& mgr, const std::string& nick, const std::string& filename, u64 filesize);
         virtual ~DCCXferIn();
 
-        u32 get_total_sent() const;
+        u64 get_total_sent() const;
 
     private:
-        u32 total_sent;
-        size_t total_size_read;
-
-        virtual void process_or_idle();
+        static const size_t SendChunkLength = 1048576;
+        static const size_t HashBufferLength = 65536;
+        static const u64 HashStepLength = 2 * SendChunkLength;
+
+        u64 total_sent;
+        u32 ack;
+        size_t ack_read;
+        u64 hashed;
+
+        void update_checksum(u64 upto);
+        u64 get_hash_target() const;
+        virtual short get_transfer_events();
+        virtual void process_events(short revents);
     };
 
     class DCCXferOut : public DCCXfer, public DCCOut {
     public:
-        DCCXferOut(Session *s, DCCManager& mgr, const std::string& nick, const std::string& filename, u32 filesize, unsigned long address, unsigned short port);
+        DCCXferOut(Session *s, DCCManager& mgr, const std::string& nick, const std::string& filename, u64 filesize, unsigned long address, unsigned short port);
         virtual ~DCCXferOut();
 
+        /* the partial file holds the checksum of the written prefix */
+        static bool read_part_checksum(const std::string& part_filename, u64& offset, u32& checksum);
+
     private:
-        std::string part_filename;
-        u32 last_acknowledged;
+        static const size_t WriteBufferLength = 1048576;
+        static const size_t WriteBufferAlignment = 4096;
 
-        virtual void process_or_idle();
+        std::string part_filename;
+        int part_fd;
+        u64 last_acknowledged;
+        char *write_buffer;
+        size_t write_buffer_used;
+        u64 write_offset;
+        u64 verify_offset;
+        u64 part_offset;
+        u32 part_checksum;
+        u32 resume_checksum;
+
+        void begin_transfer();
+        void verify_part();
+        void write_part_checksum();
+        void flush();
+        void send_acknowledge();
+        void transfer_completed();
+        virtual short get_transfer_events();
+        virtual void process_events(short revents);
     };
 
     /**************************************************************************
@@ -295,8 +410,11 @@ namespace Circada {
         virtual ~DCCXferHandle();
 
         const std::string& get_filename() const;
-        unsigned int get_transferred_bytes() const;
-        unsigned int get_filesize() const;
+        u64 get_transferred_bytes() const;
+        u64 get_filesize() const;
+        u32 get_checksum() const;
+        bool is_queued() const;
+        size_t get_queue_position() const;
     };
 
 } /* namespace Circada */
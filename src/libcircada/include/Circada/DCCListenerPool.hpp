@@ -0,0 +1,98 @@
+/*
+ *  DCCListenerPool.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_DCCLISTENERPOOL_HPP_
+#define _CIRCADA_DCCLISTENERPOOL_HPP_
+
+#include "Circada/Exception.hpp"
+#include "Circada/Socket.hpp"
+#include "Circada/Mutex.hpp"
+
+#include <vector>
+#include <poll.h>
+
+namespace Circada {
+
+    class DCCListenerPoolException : public Exception {
+    public:
+        DCCListenerPoolException(const char *msg) : Exception(msg) { }
+        DCCListenerPoolException(std::string msg) : Exception(msg) { }
+    };
+
+    class DCCIO;
+    class DCCPoller;
+
+    /* pending offers share listening sockets. a dcc connection carries */
+    /* nothing but its source address, so a listener may only hold one  */
+    /* offer per peer address and one offer to an unknown peer. the     */
+    /* ports are taken from the configured range or are ephemeral.      */
+    /* only passive offers of peers with a numeric host know the peer's */
+    /* address. our own offers never do, each of them holds a listener. */
+    class DCCListenerPool {
+    private:
+        DCCListenerPool(const DCCListenerPool& rhs);
+        DCCListenerPool& operator=(const DCCListenerPool& rhs);
+
+    public:
+        DCCListenerPool(DCCPoller& poller);
+        virtual ~DCCListenerPool();
+
+        void set_port_range(unsigned short first, unsigned short last);
+        unsigned short acquire(DCCIO *io, unsigned long peer_address);
+        void release(DCCIO *io);
+        size_t get_listener_count();
+
+        /* called on the poller thread only */
+        void get_poll_fds(std::vector<struct pollfd>& fds);
+        void handle_events(int fd, short revents);
+
+    private:
+        struct Entry {
+            Entry(DCCIO *io, unsigned long peer_address) : io(io), peer_address(peer_address) { }
+
+            DCCIO *io;
+            unsigned long peer_address;
+        };
+
+        typedef std::vector<Entry> Entries;
+
+        struct Listener {
+            Socket socket;
+            unsigned short port;
+            bool ephemeral;
+            Entries entries;
+        };
+
+        typedef std::vector<Listener *> Listeners;
+
+        DCCPoller& poller;
+        Mutex mtx;
+        unsigned short first_port;
+        unsigned short last_port;
+        Listeners listeners;
+
+        bool is_usable(const Listener *listener, unsigned long peer_address) const;
+        Listener *open_listener(unsigned short port);
+        void close_listener(Listener *listener);
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_DCCLISTENERPOOL_HPP_ */
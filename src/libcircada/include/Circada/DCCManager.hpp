@@ -24,10 +24,16 @@
 #include "Circada/Exception.hpp"
 #include "Circada/Configuration.hpp"
 #include "Circada/DCC.hpp"
+#include "Circada/DCCPoller.hpp"
 #include "Circada/Session.hpp"
 #include "Circada/Mutex.hpp"
 #include "Circada/Events.hpp"
 #include "Circada/WindowManager.hpp"
+#include "Circada/TokenBucket.hpp"
+#include "Circada/DCCQueue.hpp"
+#include "Circada/Metrics.hpp"
+
+#include <map>
 
 namespace Circada {
 
@@ -37,15 +43,17 @@ namespace Circada {
         DCCManagerException(std::string msg) : Exception(msg) { }
     };
 
-    class DCCManager {
+    class DCCManager : public ConfigurationListener {
     public:
-        DCCManager(Configuration& config, Events& evt, WindowManager& win_mgr);
+        DCCManager(Configuration& config, Events& evt, WindowManager& win_mgr, Metrics& metrics);
         virtual ~DCCManager();
 
-        DCC *create_chat_in(Session *s, const std::string& nick);
-        DCC *create_xfer_in(Session *s, const std::string& nick, const std::string& filename, std::string& out_filename, u32& filesize);
-        DCC *create_chat_out(Session *s, const std::string& nick, unsigned long address, unsigned short port);
-        DCC *create_xfer_out(Session *s, const std::string& nick, const std::string& filename, u32 filesize, unsigned long address, unsigned short port);
+        DCC *create_chat_in(Session *s, const std::string& nick, bool passive);
+        DCC *create_xfer_in(Session *s, const std::string& nick, const std::string& filename, bool passive);
+        DCC *create_chat_out(Session *s, const std::string& nick, unsigned long address, unsigned short port, const std::string& token);
+        DCC *create_xfer_out(Session *s, const std::string& nick, const std::string& filename, u64 filesize, unsigned long address, unsigned short port, const std::string& token, bool turbo);
+        bool connect_passive(Session *s, const std::string& nick, const std::string& token, unsigned long address, unsigned short port);
+        void begin_dcc(DCC *dcc);
         void dcc_change_his_nick(Session *s, const std::string& old_nick, const std::string& new_nick);
         void dcc_change_my_nick(Session *s, const std::string& new_nick);
         void detach_dcc_from_irc_server(const DCC *dcc);
@@ -55,7 +63,7 @@ namespace Circada {
         DCC::List& get_dccs();
         std::string get_storage(const std::string& filename);
         std::string get_part_filename(const std::string& filename);
-        bool set_resume_position(Session *s, unsigned short port, u32& startpos, DCC*& out_dcc);
+        bool set_resume_position(Session *s, unsigned short port, const std::string& token, u64& startpos, DCC*& out_dcc);
         Mutex& get_mutex();
         bool is_handle_valid(const DCC *dcc);
         bool is_handle_valid_nolock(const DCC *dcc);
@@ -67,14 +75,41 @@ namespace Circada {
         void send_dcc_msg(DCCHandle dcc, const std::string& msg);
         Window *get_window_from_dcc_handle(DCCHandle dcc);
         Configuration& get_configuration();
+        DCCPoller& get_poller();
+        int get_timeout() const;
+        int get_socket_buffer() const;
+        bool is_turbo() const;
+
+        /* ConfigurationListener */
+        virtual void configuration_changed(const std::string& category, const std::string& key, const std::string& value);
+
+        /* bandwidth scheduler, limits in bytes per second, 0 is unlimited */
+        void set_bandwidth_limit(DCCLimitScope scope, u64 rate);
+        u64 get_bandwidth_limit(DCCLimitScope scope);
+        void set_transfer_limit(DCCHandle dcc, u64 rate);
+        void set_transfer_priority(DCCHandle dcc, DCCPriority priority);
+        u64 get_bandwidth(DCCXfer *xfer, u64 want, long now, long& ready_at);
+        void consume_bandwidth(DCCXfer *xfer, u64 bytes);
+
+        /* the reserve is kept in the last bucket. if less than the minimum */
+        /* grant is available, 0 is returned with the time to try again.   */
+        static const u64 MinimumGrant = 4096;
+        static u64 get_grant(TokenBucket **buckets, size_t count, u64 reserve, u64 want, long now, long& ready_at);
+        static u64 get_bulk_reserve(u64 burst);
+
+        /* transfer queue, slots are limits of admitted transfers, 0 is unlimited */
+        void set_slots(DCCLimitScope scope, unsigned int slots);
+        unsigned int get_slots(DCCLimitScope scope);
+        void restore_queue(Session *s);
+        size_t get_queue_position_nolock(const DCC *dcc);
 
         void dcc_mgr_chat_begins(const DCC *dcc);
         void dcc_mgr_chat_ended(const DCC *dcc, const std::string& reason);
         void dcc_mgr_xfer_begins(const DCC *dcc);
         void dcc_mgr_xfer_ended(const DCC *dcc);
         void dcc_mgr_message(const DCC *dcc, const std::string& nick, const std::string& ctcp, const std::string& msg);
-        void dcc_mgr_send_progress(const DCC *dcc, u32 sent_bytes, u32 total_bytes);
-        void dcc_mgr_receive_progress(const DCC *dcc, u32 received_bytes, u32 total_bytes);
+        void dcc_mgr_send_progress(const DCC *dcc, u64 sent_bytes, u64 total_bytes);
+        void dcc_mgr_receive_progress(const DCC *dcc, u64 received_bytes, u64 total_bytes);
         void dcc_mgr_timedout(const DCC *dcc, const std::string& reason);
         void dcc_mgr_failed(const DCC *dcc, const std::string& reason);
 
@@ -87,10 +122,45 @@ namespace Circada {
 
         DCC::List dccs;
         Mutex mtx;
+        DCCPoller poller;
+        u32 token_sequence;
+        DCCQueue queue;
+
+        typedef std::map<std::string, TokenBucket> NickBuckets;
+
+        Mutex bw_mtx;
+        TokenBucket global_bucket;
+        NickBuckets nick_buckets;
+        u64 nick_limit;
+        u64 transfer_limit;
+        DCCPriority default_priority;
+
+        ConfigurationValue<int> timeout_setting;
+        ConfigurationValue<int> socket_buffer_setting;
+        ConfigurationValue<bool> turbo_setting;
+        ConfigurationValue<bool> xfer_in_window_setting;
+        ConfigurationValue<int> slots_setting;
+        ConfigurationValue<int> nick_slots_setting;
+
+        MetricCounter& sent_bytes;
+        MetricCounter& received_bytes;
 
         off_t get_filesize(const std::string& filename);
-        void get_fileinfo(const std::string& filename, std::string& out_filename, u32& out_size);
         void reduce_filename(const std::string& filename, std::string& out_filename);
+        void setup_xfer(DCCXfer *xfer);
+        void update_port_range();
+        std::string create_token();
+        void begin_dcc_nolock(DCC *dcc);
+        DCCXferIn *enqueue_xfer_in(Session *s, const std::string& nick, const std::string& filename, bool passive, u64 sequence);
+        void process_queue_nolock();
+        void save_queue_nolock();
+        DCCQueueOrder get_queue_order();
+        void admit_nolock(DCCXfer *xfer, bool resume);
+        void offer_xfer_nolock(DCCXfer *xfer);
+        void receive_xfer_nolock(DCCXfer *xfer, bool resume);
+        TokenBucket& get_nick_bucket(const DCCXfer *xfer);
+        void prune_nick_buckets_nolock();
+        void apply_bandwidth_limit(DCCLimitScope scope, u64 rate);
     };
 
 } /* namespace Circada */
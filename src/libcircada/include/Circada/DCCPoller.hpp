@@ -0,0 +1,82 @@
+/*
+ *  DCCPoller.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_DCCPOLLER_HPP_
+#define _CIRCADA_DCCPOLLER_HPP_
+
+#include "Circada/Exception.hpp"
+#include "Circada/Thread.hpp"
+#include "Circada/Mutex.hpp"
+#include "Circada/DCCListenerPool.hpp"
+
+#include <vector>
+
+namespace Circada {
+
+    class DCCPollerException : public Exception {
+    public:
+        DCCPollerException(const char *msg) : Exception(msg) { }
+        DCCPollerException(std::string msg) : Exception(msg) { }
+    };
+
+    class DCC;
+
+    /* one thread drives all dcc sockets with poll(). a dcc tells  */
+    /* the poller its fd, the events it waits for and its deadline */
+    /* and gets called back on the poller thread. dccs are deleted */
+    /* on the poller thread too, so a callback never sees a freed  */
+    /* dcc.                                                        */
+    class DCCPoller : public Thread {
+    private:
+        DCCPoller(const DCCPoller& rhs);
+        DCCPoller& operator=(const DCCPoller& rhs);
+
+    public:
+        typedef std::vector<DCC *> List;
+
+        DCCPoller();
+        virtual ~DCCPoller();
+
+        void start();
+        void stop();
+        void add(DCC *dcc);
+        void dispose(DCC *dcc);
+        void wakeup();
+        DCCListenerPool& get_listeners();
+
+        static long get_monotonic_ms();
+
+    private:
+        Mutex mtx;
+        bool running;
+        bool started;
+        int wakeup_fds[2];
+        List dccs;
+        List added;
+        List disposed;
+        DCCListenerPool listeners;
+
+        void take_over();
+        virtual void thread();
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_DCCPOLLER_HPP_ */
@@ -0,0 +1,92 @@
+/*
+ *  DCCQueue.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_DCCQUEUE_HPP_
+#define _CIRCADA_DCCQUEUE_HPP_
+
+#include "Circada/Exception.hpp"
+#include "Circada/Types.hpp"
+
+#include <vector>
+#include <string>
+
+namespace Circada {
+
+    class DCCQueueException : public Exception {
+    public:
+        DCCQueueException(const char *msg) : Exception(msg) { }
+        DCCQueueException(std::string msg) : Exception(msg) { }
+    };
+
+    enum DCCQueueOrder {
+        DCCQueueOrderFifo,
+        DCCQueueOrderSize
+    };
+
+    class DCCXfer;
+
+    /* transfers wait here for a free slot. our own offers are stored in */
+    /* a file, they are parked when their session is gone and restored, */
+    /* when a session to the same server is logged in again. accepted    */
+    /* downloads are kept in memory only, the peer's offer expires.     */
+    /* the dcc manager serializes all calls.                            */
+    class DCCQueue {
+    private:
+        DCCQueue(const DCCQueue& rhs);
+        DCCQueue& operator=(const DCCQueue& rhs);
+
+    public:
+        struct Entry {
+            u64 sequence;
+            std::string server;
+            std::string nick;
+            std::string filename;
+            u64 filesize;
+            DCCXfer *xfer;
+            bool persistent;
+        };
+
+        typedef std::vector<Entry> Entries;
+        typedef std::vector<DCCXfer *> Xfers;
+
+        DCCQueue(const std::string& filename);
+        virtual ~DCCQueue();
+
+        void load();
+        void save();
+
+        u64 push(DCCXfer *xfer, const std::string& server, bool persistent, u64 sequence);
+        bool remove(DCCXfer *xfer);
+        size_t get_position(const DCCXfer *xfer, DCCQueueOrder order) const;
+        void get_ordered(DCCQueueOrder order, Xfers& xfers) const;
+        bool park(DCCXfer *xfer);
+        void take_parked(const std::string& server, Entries& out_entries);
+
+    private:
+        std::string filename;
+        u64 sequence;
+        Entries entries;
+
+        void get_sorted(DCCQueueOrder order, std::vector<const Entry *>& sorted) const;
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_DCCQUEUE_HPP_ */
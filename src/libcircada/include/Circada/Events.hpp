@@ -69,6 +69,9 @@ namespace Circada {
         virtual void lag_update(Session *s, double lag_in_s) { }
         virtual void connection_lost(Session *s, const std::string& reason) { }
 
+        /* after each line from the server, used by the benchmarks */
+        virtual void line_processed(Session *s, const Message& m) { }
+
         /* dcc events, during running irc connection */
         virtual void dcc_offered_chat_timedout(Session *s, Window *w, const DCCChatHandle dcc, const std::string& reason) { }
         virtual void dcc_incoming_chat_request(Session *s, Window *w, const DCCChatHandle dcc) { }
@@ -0,0 +1,93 @@
+/*
+ *  FileWatcher.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_FILEWATCHER_HPP_
+#define _CIRCADA_FILEWATCHER_HPP_
+
+#include "Circada/Exception.hpp"
+#include "Circada/Thread.hpp"
+#include "Circada/Mutex.hpp"
+
+#include <string>
+#include <map>
+#include <set>
+
+namespace Circada {
+
+    class FileWatcherException : public Exception {
+    public:
+        FileWatcherException(const char *msg) : Exception(msg) { }
+        FileWatcherException(std::string msg) : Exception(msg) { }
+    };
+
+    class FileWatcherListener {
+    public:
+        virtual ~FileWatcherListener() { }
+
+        virtual void file_changed(const std::string& filename) = 0;
+    };
+
+    /* watches the directories of the registered files with inotify. */
+    /* editors save through temporary files and renames, so a file   */
+    /* is reported once, after its directory settled down.           */
+    class FileWatcher : public Thread {
+    private:
+        FileWatcher(const FileWatcher& rhs);
+        FileWatcher& operator=(const FileWatcher& rhs);
+
+    public:
+        FileWatcher(FileWatcherListener& listener);
+        virtual ~FileWatcher();
+
+        void start();
+        void stop();
+        void watch(const std::string& filename);
+        void unwatch(const std::string& filename);
+
+    private:
+        static const int SettleTimeout = 200;
+
+        typedef std::map<std::string, std::string> Files;
+        typedef std::set<std::string> Changes;
+
+        /* files maps the name in the directory to the name as watched */
+        struct Directory {
+            std::string path;
+            Files files;
+        };
+
+        typedef std::map<int, Directory> Directories;
+
+        FileWatcherListener& listener;
+        Mutex mtx;
+        bool running;
+        bool started;
+        int inotify_fd;
+        int wakeup_fds[2];
+        Directories directories;
+
+        static void split_filename(const std::string& filename, std::string& path, std::string& file);
+        void read_events(Changes& changes);
+        virtual void thread();
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_FILEWATCHER_HPP_ */
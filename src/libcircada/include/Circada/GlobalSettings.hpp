@@ -23,6 +23,7 @@
 
 #include "Circada/Mutex.hpp"
 #include "Circada/Recoder.hpp"
+#include "Circada/Metrics.hpp"
 
 #include <string>
 
@@ -38,6 +39,7 @@ namespace Circada {
         const std::string& get_quit_message();
         bool get_injection();
         Encodings& get_encodings();
+        Metrics& get_metrics();
 
         Encodings encodings;
 
@@ -46,6 +48,7 @@ namespace Circada {
         std::string project_version;
         std::string quit_message;
         bool inject_messages;
+        Metrics metrics;
 
         Mutex settings_mtx;
     };
@@ -0,0 +1,83 @@
+/*
+ *  Highlighter.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_HIGHLIGHTER_HPP_
+#define _CIRCADA_HIGHLIGHTER_HPP_
+
+#include "Circada/Exception.hpp"
+#include "Circada/Mutex.hpp"
+
+#include <string>
+#include <vector>
+#include <regex.h>
+
+namespace Circada {
+
+    class HighlighterException : public Exception {
+    public:
+        HighlighterException(const char *msg) : Exception(msg) { }
+        HighlighterException(std::string msg) : Exception(msg) { }
+    };
+
+    /* the nick and the highlight words are compiled into one automaton  */
+    /* (aho-corasick), so a text is scanned once, however many words are */
+    /* set. words match case insensitive and only as a whole word. the   */
+    /* optional regex is an extended posix regex, tested on its own.     */
+    class Highlighter {
+    private:
+        Highlighter(const Highlighter& rhs);
+        Highlighter& operator=(const Highlighter& rhs);
+
+    public:
+        Highlighter();
+        virtual ~Highlighter();
+
+        void set_nick(const std::string& nick);
+        void set_words(const std::string& words);
+        void set_regex(const std::string& regex);
+        bool is_highlighted(const std::string& text);
+
+        static void check_regex(const std::string& regex);
+
+    private:
+        typedef std::vector<int> Transitions;
+        typedef std::vector<size_t> Lengths;
+        typedef std::vector<Lengths> Outputs;
+        typedef std::vector<std::string> Words;
+
+        Mutex mtx;
+        std::string nick;
+        Words words;
+        unsigned char classes[256];
+        size_t class_count;
+        Transitions transitions;
+        Outputs outputs;
+        regex_t regex;
+        bool regex_compiled;
+
+        void compile();
+        static unsigned char fold(unsigned char c);
+        static bool is_word_char(unsigned char c);
+        static void compile_regex(regex_t *preg, const std::string& regex);
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_HIGHLIGHTER_HPP_ */
@@ -45,6 +45,7 @@ namespace Circada {
         void io_sync_set_non_blocking();
         void io_sync_set_blocking();
         bool io_sync_wait_for_event();
+        bool io_sync_wait_for_event(int timeout);
         void io_sync_signal_event();
 
     private:
@@ -0,0 +1,106 @@
+/*
+ *  LogStore.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_LOGSTORE_HPP_
+#define _CIRCADA_LOGSTORE_HPP_
+
+#include "Circada/Exception.hpp"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+
+namespace Circada {
+
+    class LogStoreException : public Exception {
+    public:
+        LogStoreException(const char *msg) : Exception(msg) { }
+        LogStoreException(std::string msg) : Exception(msg) { }
+    };
+
+    struct LogRecord {
+        time_t when;
+        unsigned char type;
+        std::string nick;
+        std::string text;
+    };
+
+    typedef std::vector<LogRecord> LogRecords;
+
+    /* append-only binary log. records are collected and written in
+     * batches, reading is done through a memory mapping of the file.
+     * every IndexStep-th record is stored with its time and offset in
+     * a sidecar index file, which is repaired on open if needed.
+     * opened read-only, neither file is created or changed, a missing
+     * index is built in memory and a partial last record is skipped.
+     * this class is not thread safe.
+     */
+    class LogStore {
+    private:
+        LogStore(const LogStore& rhs);
+        LogStore& operator=(const LogStore& rhs);
+
+    public:
+        LogStore(const std::string& filename, bool read_only = false);
+        virtual ~LogStore();
+
+        const std::string& get_filename() const;
+        void append(time_t when, unsigned char type, const std::string& nick, const std::string& text);
+        void flush();
+        size_t get_record_count() const;
+        bool get_record(size_t nbr, LogRecord& record);
+        size_t get_records(size_t nbr, size_t count, LogRecords& records);
+        size_t find(time_t when);
+
+    private:
+        static const size_t IndexStep = 64;
+        static const size_t FlushSize = 65536;
+
+        struct IndexEntry {
+            int64_t when;
+            uint64_t offset;
+        };
+        typedef std::vector<IndexEntry> Index;
+
+        std::string filename;
+        std::string index_filename;
+        bool read_only;
+        int fd;
+        int index_fd;
+        std::string buffer;
+        Index index;
+        size_t index_written;
+        uint64_t file_size;
+        size_t records;
+        size_t written_records;
+        const char *map;
+        size_t map_size;
+
+        void load_index();
+        void map_file();
+        void unmap_file();
+        bool seek(size_t nbr, uint64_t& offset);
+        bool parse(uint64_t offset, LogRecord *record, uint64_t *next);
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_LOGSTORE_HPP_ */
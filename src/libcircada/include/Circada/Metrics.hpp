@@ -0,0 +1,161 @@
+/*
+ *  Metrics.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_METRICS_HPP_
+#define _CIRCADA_METRICS_HPP_
+
+#include "Circada/Exception.hpp"
+#include "Circada/Types.hpp"
+#include "Circada/Mutex.hpp"
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+namespace Circada {
+
+    class MetricsException : public Exception {
+    public:
+        MetricsException(const char *msg) : Exception(msg) { }
+        MetricsException(std::string msg) : Exception(msg) { }
+    };
+
+    enum MetricType {
+        MetricTypeCounter,
+        MetricTypeGauge,
+        MetricTypeHistogram
+    };
+
+    /* metrics are updated without a lock, from any thread. */
+    class MetricCounter {
+    private:
+        MetricCounter(const MetricCounter& rhs);
+        MetricCounter& operator=(const MetricCounter& rhs);
+
+    public:
+        MetricCounter() : value(0) { }
+
+        void add(u64 n) { value.fetch_add(n, std::memory_order_relaxed); }
+        u64 get() const { return value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<u64> value;
+    };
+
+    class MetricGauge {
+    private:
+        MetricGauge(const MetricGauge& rhs);
+        MetricGauge& operator=(const MetricGauge& rhs);
+
+    public:
+        MetricGauge() : value(0) { }
+
+        void set(s64 n) { value.store(n, std::memory_order_relaxed); }
+        void add(s64 n) { value.fetch_add(n, std::memory_order_relaxed); }
+        s64 get() const { return value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<s64> value;
+    };
+
+    /* durations in microseconds, the bucket bounds run 1, 2, 5, 10 ... 10 s */
+    class MetricHistogram {
+    private:
+        MetricHistogram(const MetricHistogram& rhs);
+        MetricHistogram& operator=(const MetricHistogram& rhs);
+
+    public:
+        static const int BucketCount = 22;
+
+        MetricHistogram();
+
+        void observe(u64 us);
+        u64 get_count() const;
+        u64 get_sum() const;
+        u64 get_bucket(int index) const;    /* not cumulative, the last one is +Inf */
+        u64 get_quantile(double q) const;   /* upper bound of the bucket */
+        static u64 get_bound(int index);
+        static u64 get_now();               /* monotonic, in microseconds */
+
+    private:
+        static const u64 Bounds[BucketCount];
+
+        std::atomic<u64> buckets[BucketCount + 1];
+        std::atomic<u64> count;
+        std::atomic<u64> sum;
+    };
+
+    /* measures the scope */
+    class MetricTimer {
+    private:
+        MetricTimer(const MetricTimer& rhs);
+        MetricTimer& operator=(const MetricTimer& rhs);
+
+    public:
+        MetricTimer(MetricHistogram& histogram) : histogram(histogram), start(MetricHistogram::get_now()) { }
+        ~MetricTimer() { histogram.observe(MetricHistogram::get_now() - start); }
+
+    private:
+        MetricHistogram& histogram;
+        u64 start;
+    };
+
+    /* the registry owns all metrics until it is destroyed. registering */
+    /* the same name and labels again returns the existing metric, so   */
+    /* callers keep the reference and never look up on the hot path.   */
+    class Metrics {
+    private:
+        Metrics(const Metrics& rhs);
+        Metrics& operator=(const Metrics& rhs);
+
+    public:
+        struct Entry {
+            std::string name;
+            std::string labels;     /* in prometheus syntax without braces */
+            std::string help;
+            MetricType type;
+            MetricCounter *counter;
+            MetricGauge *gauge;
+            MetricHistogram *histogram;
+        };
+
+        typedef std::vector<Entry> Entries;
+
+        Metrics();
+        virtual ~Metrics();
+
+        MetricCounter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+        MetricGauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+        MetricHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+        Entries get_entries();
+        void write_prometheus(std::string& out);
+
+        static std::string label(const std::string& key, const std::string& value);
+
+    private:
+        Mutex mtx;
+        Entries entries;
+
+        Entry find_or_add(const std::string& name, const std::string& help, const std::string& labels, MetricType type);
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_METRICS_HPP_ */
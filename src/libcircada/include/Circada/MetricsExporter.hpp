@@ -0,0 +1,82 @@
+/*
+ *  MetricsExporter.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_METRICSEXPORTER_HPP_
+#define _CIRCADA_METRICSEXPORTER_HPP_
+
+#include "Circada/Exception.hpp"
+#include "Circada/Configuration.hpp"
+#include "Circada/Metrics.hpp"
+#include "Circada/Thread.hpp"
+#include "Circada/Mutex.hpp"
+
+#include <string>
+
+namespace Circada {
+
+    class MetricsExporterException : public Exception {
+    public:
+        MetricsExporterException(const char *msg) : Exception(msg) { }
+        MetricsExporterException(std::string msg) : Exception(msg) { }
+    };
+
+    /* serves the metrics in the prometheus text format on the unix     */
+    /* socket, that is set in metrics_socket. a http request is answered */
+    /* with a http response, any other client just gets the text.        */
+    class MetricsExporter : public Thread, public ConfigurationListener {
+    private:
+        MetricsExporter(const MetricsExporter& rhs);
+        MetricsExporter& operator=(const MetricsExporter& rhs);
+
+    public:
+        MetricsExporter(Configuration& config, Metrics& metrics);
+        virtual ~MetricsExporter();
+
+        void start(const std::string& path);
+        void stop();
+        const std::string& get_path() const;
+
+        /* why the socket of metrics_socket is not served, empty if it is */
+        std::string get_error();
+
+        /* ConfigurationListener */
+        virtual void configuration_changed(const std::string& category, const std::string& key, const std::string& value);
+
+    private:
+        static const int RequestTimeout = 100;
+        static const int SendTimeout = 1000;
+
+        Configuration& config;
+        Metrics& metrics;
+        Mutex mtx;
+        bool running;
+        bool started;
+        int listen_fd;
+        int wakeup_fds[2];
+        std::string path;
+        std::string error;
+
+        void serve(int fd);
+        virtual void thread();
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_METRICSEXPORTER_HPP_ */
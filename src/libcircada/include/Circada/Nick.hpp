@@ -44,7 +44,6 @@ namespace Circada {
     class Nick {
     public:
         typedef std::vector<Nick> List;
-        static bool is_nick_in_text(const std::string& nick, const std::string& text);
 
         Nick(const std::string& nick, ServerNickPrefix *snp);
         virtual ~Nick() { }
@@ -60,7 +59,9 @@ namespace Circada {
         Flags flags;
         ServerNickPrefix *snp;
         std::string sortnick;
+        char flag;
 
+        void set_flag();
         void set_sortnick();
     };
 
@@ -34,6 +34,8 @@
 #include "Circada/Recoder.hpp"
 #include "Circada/SessionOptions.hpp"
 #include "Circada/DCC.hpp"
+#include "Circada/Metrics.hpp"
+#include "Circada/Highlighter.hpp"
 
 #include <vector>
 #include <string>
@@ -53,7 +55,7 @@ namespace Circada {
         SenderThread& operator=(const SenderThread& rhs);
 
     public:
-        SenderThread(Socket *socket);
+        SenderThread(Socket *socket, Metrics& metrics, const std::string& labels);
         virtual ~SenderThread();
 
         void pump(const std::string& data);
@@ -66,6 +68,12 @@ namespace Circada {
         Mutex mtx;
         Queue queue;
 
+        MetricCounter& lines_sent;
+        MetricCounter& bytes_sent;
+        MetricGauge& queue_depth;
+
+        void clear_queue();
+
         void send(const std::string& data);
         virtual void thread();
     };
@@ -88,7 +96,7 @@ namespace Circada {
 
     class IrcServerSide;
 
-    class Session : private Thread, public ServerNickPrefix, private Joinable, public Suicidal {
+    class Session : private Thread, public ServerNickPrefix, private Joinable, public Suicidal, private ConfigurationListener {
         friend class SuicideThread;
 
     private:
@@ -105,11 +113,15 @@ namespace Circada {
         void connect();
         void disconnect();
 
+        /* never reused, unlike the address of a destroyed session           */
+        unsigned long get_id() const;
+
         /* runtime functions                                                  */
         /* use these to get some status, during an irc session                */
         void send(const std::string& data);
         bool is_that_me(const std::string& nick);
         bool is_channel(const std::string& name);
+        const std::string& get_channel_prefixes() const;
         std::string get_flags();
         const std::string& get_nick() const;
         const std::string& get_server() const;
@@ -122,6 +134,7 @@ namespace Circada {
         DCCChatHandle dcc_chat_offer(const std::string& nick);
         DCCXferHandle dcc_file_offer(const std::string& nick, const std::string& filename);
         DCCHandle::List get_dcc_list();
+        unsigned long get_dcc_address();
 
     protected:
         /* ServerNickPrefix */
@@ -157,6 +170,7 @@ namespace Circada {
         static Command commands[];
 
         /* session management */
+        const unsigned long id;
         Configuration& config;
         IrcServerSide& iss;
         bool running;
@@ -170,6 +184,12 @@ namespace Circada {
         ConnectionState connection_state;
         bool suiciding;
 
+        /* metrics, labeled with the session name */
+        MetricCounter& lines_received;
+        MetricCounter& bytes_received;
+        MetricHistogram& parse_time;
+        MetricHistogram& dispatch_time;
+
         /* server caps */
         std::string channel_prefixes;
         std::string nick_prefixes_chars;
@@ -190,8 +210,12 @@ namespace Circada {
         std::string nick;
         Flags flags;
         bool away;
+        Highlighter highlighter;
+
+        static std::string get_metrics_labels(const SessionOptions& options);
 
         virtual void thread();
+        virtual void configuration_changed(const std::string& category, const std::string& key, const std::string& value);
         void execute_injected();
         void execute(const Message& m);
         void inject(Message& m);
@@ -26,6 +26,7 @@
 #include <vector>
 #include <string>
 #include <sys/time.h>
+#include <sys/types.h>
 #include <gnutls/gnutls.h>
 #include <gnutls/gnutlsxx.h>
 
@@ -49,24 +50,34 @@ namespace Circada {
         void set_tls(const std::string& ca_file, const std::string& cert_file, const std::string& key_file, const std::string& priority);
         void reset_tls();
         void connect(const char *ip_address, unsigned short port);
+        bool connect_nonblocking(const char *ip_address, unsigned short port);
+        void finish_connect();
         bool activity(time_t sec, suseconds_t usec);
         void listen(const char *address, unsigned short port, int backlog);
         void listen(const char *address, unsigned short port);
         void listen(unsigned short port, int backlog);
         void listen(unsigned short port);
         void accept(const Socket& socket);
+        void attach(int fd);
         void close();
 
         size_t send(const char *buffer, size_t size);
         size_t send(const std::string& buffer);
+        size_t send_file(int fd, off_t& offset, size_t count);
         size_t receive(void *buffer, size_t size);
+        void set_buffer_sizes(int size);
+        void set_bulk(bool state);
+        void set_nonblocking(bool state);
+        int get_fd() const;
         bool get_error() const;
         bool is_connected() const;
+        bool is_tls() const;
         unsigned short get_port();
         unsigned long get_address();
 
     private:
         static const int DefaultBacklog;
+        static const size_t FileBufferLength;
 
         int socket;
         bool connected;
@@ -74,6 +85,8 @@ namespace Circada {
         bool error;
         bool tls;
         bool disconnecting;
+        bool connecting;
+        bool nonblocking;
         gnutls::client_session session;
         gnutls::certificate_credentials credentials;
 
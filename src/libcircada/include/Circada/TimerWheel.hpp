@@ -0,0 +1,79 @@
+/*
+ *  TimerWheel.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_TIMERWHEEL_HPP_
+#define _CIRCADA_TIMERWHEEL_HPP_
+
+#include "Circada/Types.hpp"
+
+#include <cstddef>
+#include <vector>
+#include <map>
+
+namespace Circada {
+
+    /* hashed timer wheel, times in ms. adding and cancelling is cheap, */
+    /* the owner advances the wheel and handles the expired ids.        */
+    class TimerWheel {
+    private:
+        TimerWheel(const TimerWheel& rhs);
+        TimerWheel& operator=(const TimerWheel& rhs);
+
+    public:
+        typedef u64 Id;
+        typedef std::vector<Id> Ids;
+
+        TimerWheel(long resolution = 10, size_t slot_count = 512);
+        virtual ~TimerWheel();
+
+        Id add(long now, long delay);
+        void rearm(Id id, long now, long delay);
+        bool cancel(Id id);
+        void clear();
+        size_t get_count() const;
+        long get_timeout(long now) const;
+        void advance(long now, Ids& expired);
+
+    private:
+        struct Entry {
+            Entry(Id id, u64 rounds) : id(id), rounds(rounds) { }
+
+            Id id;
+            u64 rounds;
+        };
+        typedef std::vector<Entry> Slot;
+        typedef std::vector<Slot> Slots;
+        typedef std::map<Id, size_t> Index;
+
+        long resolution;
+        Slots slots;
+        Index index;
+        Id last_id;
+        u64 current;
+        long origin;
+        bool started;
+
+        void insert(Id id, long now, long delay);
+        u64 get_tick(long now) const;
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_TIMERWHEEL_HPP_ */
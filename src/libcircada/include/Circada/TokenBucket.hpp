@@ -0,0 +1,56 @@
+/*
+ *  TokenBucket.hpp
+ *
+ *  Created by Circada Team on Oct 19, 2026
+ *  Copyright 2026 Circada Team. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CIRCADA_TOKENBUCKET_HPP_
+#define _CIRCADA_TOKENBUCKET_HPP_
+
+#include "Circada/Types.hpp"
+
+namespace Circada {
+
+    /* classic token bucket, rate in bytes per second, times in ms. */
+    /* a rate of 0 means unlimited.                                 */
+    class TokenBucket {
+    public:
+        TokenBucket();
+        virtual ~TokenBucket();
+
+        void set_rate(u64 rate);
+        u64 get_rate() const;
+        u64 get_burst() const;
+        bool is_limited() const;
+        u64 get_available(long now);
+        void consume(u64 bytes);
+        long get_ready_time(long now, u64 bytes);
+
+    private:
+        static const u64 MinimumBurst = 4096;
+
+        u64 rate;
+        u64 burst;
+        double tokens;
+        long last;
+
+        void refill(long now);
+    };
+
+} /* namespace Circada */
+
+#endif /* _CIRCADA_TOKENBUCKET_HPP_ */
@@ -26,6 +26,8 @@
 namespace Circada {
 
     typedef uint32_t u32;
+    typedef uint64_t u64;
+    typedef int64_t s64;
 
 } /* namespace Circada */
 
@@ -24,6 +24,7 @@
 #include "Circada/Flags.hpp"
 #include "Circada/Nick.hpp"
 #include "Circada/DCC.hpp"
+#include "Circada/Metrics.hpp"
 
 #include <vector>
 #include <map>
@@ -58,9 +59,12 @@ namespace Circada {
 
     class Window {
     public:
-        Window() { }
+        Window();
         virtual ~Window() { }
 
+        /* never reused, unlike the address of a closed window */
+        unsigned long get_id() const;
+
     public:
         virtual WindowType get_window_type() const = 0;
         virtual const std::string& get_name() const = 0;
@@ -74,6 +78,9 @@ namespace Circada {
         virtual Nick *get_nick(const std::string& nick) = 0;
         virtual char get_nick_flag(const std::string& nick) = 0;
         virtual const Netsplits& get_netsplits() = 0;
+
+    private:
+        const unsigned long id;
     };
 
     class Session;
@@ -90,7 +97,7 @@ namespace Circada {
         SessionWindow(const std::string& name, const std::string& topic);
         SessionWindow(Session *s, WindowType type, const std::string& name, ServerNickPrefix *snp);
         SessionWindow(Session *s, const DCC *dcc, const std::string& name, ServerNickPrefix *snp);
-        virtual ~SessionWindow() { }
+        virtual ~SessionWindow();
 
         Session *get_session();
         void set_name(const std::string& name);
@@ -102,6 +109,7 @@ namespace Circada {
         void change_nick(const std::string& old_nick, const std::string& new_nick);
         void remove_nick(const std::string& nick);
         void sort_nicks();
+        void set_nick_gauge(MetricGauge *gauge);
         bool print_netsplit(const std::string& quit_msg, struct timeval now);
         void add_netsplit_nick(const std::string& quit_msg, const std::string& nick);
         bool is_netsplit_over(const std::string& nick);
@@ -140,6 +148,7 @@ namespace Circada {
         WindowAction action;
 
         Nick::List nicks;
+        MetricGauge *nick_gauge;
         Netsplits netsplits;
 
         Netsplit& get_netsplit(const std::string& quit_msg);
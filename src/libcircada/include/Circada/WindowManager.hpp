@@ -25,12 +25,13 @@
 #include "Circada/Window.hpp"
 #include "Circada/Mutex.hpp"
 #include "Circada/Events.hpp"
+#include "Circada/Metrics.hpp"
 
 namespace Circada {
 
     class WindowManager {
     public:
-        WindowManager();
+        WindowManager(Metrics& metrics);
         virtual ~WindowManager();
 
         SessionWindow::List get_all_session_windows(Session *s);
@@ -49,6 +50,10 @@ namespace Circada {
     private:
         SessionWindow::List windows;
         Mutex mtx;
+        MetricGauge& windows_gauge;
+        MetricGauge& nicks_gauge;
+
+        void add_window_nolock(SessionWindow *w);
 
         void destroy_window_nolock(SessionWindow *w);
     };